@@ -85,8 +85,8 @@ namespace mopo {
         break;
       case kRandom:
         pattern = &ascending_;
-        note_index_ = rand() % ascending_.size();
-        current_octave_ = rand() % octaves;
+        note_index_ = random_.nextInt(ascending_.size());
+        current_octave_ = random_.nextInt(octaves);
         break;
       case kUpDown:
         if (note_index_ >= ascending_.size() - 1) {
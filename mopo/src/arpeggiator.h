@@ -21,6 +21,7 @@
 #include "circular_queue.h"
 #include "note_handler.h"
 #include "processor.h"
+#include "random_generator.h"
 #include "value.h"
 
 #include <list>
@@ -82,6 +83,7 @@ namespace mopo {
       int note_index_;
       int current_octave_;
       bool octave_up_;
+      RandomGenerator random_;
       mopo_float last_played_note_;
 
       std::vector<mopo_float> as_played_;
@@ -66,6 +66,7 @@ namespace mopo {
 
       virtual Processor* clone() const { return new BiquadFilter(*this); }
       virtual void process();
+      virtual bool rewritesOutputs() const { return true; }
 
       void computeCoefficients(Type type,
                                mopo_float cutoff,
@@ -0,0 +1,178 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * mopo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mopo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mopo.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "buffer_pool.h"
+
+#include "graph_edit.h"
+#include "processor_router.h"
+
+#include <algorithm>
+
+namespace mopo {
+
+  BufferPool::~BufferPool() {
+    for (mopo_float* buffer : buffers_)
+      ProcessorArena::freeBuffer(buffer);
+  }
+
+  void BufferPool::plan(ProcessorRouter* router,
+                        const std::set<const Output*>& pinned,
+                        const GraphEdit* edit) {
+    assignments_.clear();
+
+    // Find the last step reading each Output. Anything read after the
+    // steps, like through the router's own outputs, is treated like it's
+    // pinned.
+    std::vector<Step> steps;
+    std::map<const Output*, int> last_reads;
+    std::vector<const Output*> late_reads;
+    addSteps(router, edit, false, true, &steps, &last_reads, &late_reads);
+
+    int num_steps = steps.size();
+    for (const Output* output : *router->outputs_)
+      late_reads.push_back(output);
+    for (const Output* source : late_reads)
+      last_reads[source] = num_steps;
+
+    // Walk the steps in order, taking back buffers whose Output has been
+    // read for the last time and handing them to the Outputs written next.
+    std::vector<int> free_buffers;
+    std::multimap<int, int> live_buffers;
+    int num_used = 0;
+
+    for (int i = 0; i < num_steps; ++i) {
+      while (live_buffers.size() && live_buffers.begin()->first < i) {
+        free_buffers.push_back(live_buffers.begin()->second);
+        live_buffers.erase(live_buffers.begin());
+      }
+
+      Processor* processor = steps[i].processor;
+      if (!steps[i].enabled || !processor->isIsolated() || processor->isControlRate() ||
+          !processor->enabled() || !processor->rewritesOutputs()) {
+        continue;
+      }
+
+      int num_outputs = processor->isolated_outputs_.size();
+      for (int o = 0; o < num_outputs; ++o) {
+        Output* output = processor->isolated_outputs_[o];
+        if (pinned.count(output) || output->buffer_size != MAX_BUFFER_SIZE)
+          continue;
+
+        // Nothing in the graph reads it so something outside might.
+        auto read = last_reads.find(output);
+        if (read == last_reads.end())
+          continue;
+
+        int last_read = std::max(read->second, steps[i].end);
+        if (last_read >= num_steps)
+          continue;
+
+        int index = num_used;
+        if (free_buffers.size()) {
+          index = free_buffers.back();
+          free_buffers.pop_back();
+        }
+        else
+          num_used++;
+
+        if (index == (int)buffers_.size())
+          buffers_.push_back(ProcessorArena::allocateBuffer(MAX_BUFFER_SIZE));
+
+        assignments_.push_back({ output, processor->isolated_buffers_[o], index });
+        live_buffers.insert(std::pair<int, int>(last_read, index));
+      }
+    }
+  }
+
+  void BufferPool::addSteps(const ProcessorRouter* router, const GraphEdit* edit,
+                            bool nested, bool enabled, std::vector<Step>* steps,
+                            std::map<const Output*, int>* last_reads,
+                            std::vector<const Output*>* late_reads) {
+    const std::vector<Processor*>& order = edit ? edit->localOrder(router) : router->local_order_;
+    const std::vector<Feedback*>& feedbacks =
+        edit ? edit->localFeedbackOrder(router) : router->local_feedback_order_;
+    int start = steps->size();
+    std::vector<const Output*> sources;
+
+    for (Processor* processor : order) {
+      sources.clear();
+      ProcessorRouter* child = dynamic_cast<ProcessorRouter*>(processor);
+      if (child) {
+        addSteps(child, edit, true, enabled && child->enabled(), steps, last_reads, late_reads);
+
+        // Routers can read their own inputs once their children have run and
+        // anything reading their outputs isn't known here.
+        int end = steps->size() - 1;
+        child->Processor::collectSources(&sources, edit);
+        for (const Output* source : sources)
+          (*last_reads)[source] = std::max((*last_reads)[source], end);
+        for (const Output* output : *child->outputs_)
+          late_reads->push_back(output);
+        continue;
+      }
+
+      int step = steps->size();
+      steps->push_back({ processor, -1, enabled });
+      processor->collectSources(&sources, edit);
+      for (const Output* source : sources) {
+        if (processor->aliasesInputs())
+          late_reads->push_back(source);
+        else
+          (*last_reads)[source] = step;
+      }
+    }
+
+    // Feedbacks read their sources after the last child runs.
+    int end = steps->size() - 1;
+    sources.clear();
+    for (const Feedback* feedback : feedbacks)
+      feedback->collectSources(&sources, edit);
+    for (const Output* source : sources) {
+      if (nested)
+        (*last_reads)[source] = std::max((*last_reads)[source], end);
+      else
+        late_reads->push_back(source);
+    }
+
+    // Steps of routers nested deeper already end with their own router.
+    if (nested) {
+      for (int i = start; i < (int)steps->size(); ++i) {
+        if ((*steps)[i].end < 0)
+          (*steps)[i].end = end;
+      }
+    }
+  }
+
+  void BufferPool::apply() {
+    for (const Assignment& assignment : assignments_) {
+      assignment.output->buffer = buffers_[assignment.buffer];
+      assignment.output->pooled = true;
+    }
+  }
+
+  void BufferPool::release() {
+    for (const Assignment& assignment : assignments_) {
+      assignment.output->buffer = assignment.own_buffer;
+      assignment.output->pooled = false;
+    }
+  }
+
+  void BufferPool::swap(BufferPool& other) {
+    buffers_.swap(other.buffers_);
+    assignments_.swap(other.assignments_);
+  }
+} // namespace mopo
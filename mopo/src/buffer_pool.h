@@ -0,0 +1,88 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * mopo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mopo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mopo.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include "common.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+namespace mopo {
+
+  class GraphEdit;
+  struct Output;
+  class Processor;
+  class ProcessorRouter;
+
+  // Lets audio rate Outputs of an isolated ProcessorRouter share storage.
+  // Each Output is live from the step that writes it to the last step that
+  // reads it, and Outputs that are never live at the same time get the same
+  // buffer, like registers handed out by a compiler. Most of a voice ends up
+  // running out of a few dozen buffers that stay in cache.
+  class BufferPool {
+    public:
+      BufferPool() { }
+      ~BufferPool();
+
+      // Works out which Outputs written inside _router_ can share buffers, as
+      // _router_ will be once _edit_ is committed if there is one. Nested
+      // routers are walked in place. _pinned_ Outputs are read after _router_
+      // runs so they keep their own. Has to be planned again whenever
+      // connections change, so only call it where plans are compiled.
+      void plan(ProcessorRouter* router, const std::set<const Output*>& pinned,
+                const GraphEdit* edit = nullptr);
+
+      // Points the planned Outputs at their pooled buffers or back at their
+      // own. Neither allocates so they can run between audio blocks.
+      void apply();
+      void release();
+
+      void swap(BufferPool& other);
+      int getNumBuffers() const { return buffers_.size(); }
+      int getNumOutputs() const { return assignments_.size(); }
+
+    private:
+      // A processor that isn't a router, in the order they run. Outputs it
+      // writes stay live until _end_, where the router it's in may still
+      // read them after running its children.
+      struct Step {
+        Processor* processor;
+        int end;
+        bool enabled;
+      };
+
+      struct Assignment {
+        Output* output;
+        mopo_float* own_buffer;
+        int buffer;
+      };
+
+      void addSteps(const ProcessorRouter* router, const GraphEdit* edit,
+                    bool nested, bool enabled, std::vector<Step>* steps,
+                    std::map<const Output*, int>* last_reads,
+                    std::vector<const Output*>* late_reads);
+
+      std::vector<mopo_float*> buffers_;
+      std::vector<Assignment> assignments_;
+  };
+} // namespace mopo
+
+#endif // BUFFER_POOL_H
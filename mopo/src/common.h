@@ -37,9 +37,18 @@
 #define VECTORIZE_LOOP
 #endif
 
+// Build with MOPO_FLOAT=1 to process in single precision.
+#ifndef MOPO_FLOAT
+#define MOPO_FLOAT 0
+#endif
+
 namespace mopo {
 
+#if MOPO_FLOAT
+  typedef float mopo_float;
+#else
   typedef double mopo_float;
+#endif
 
   const mopo_float PI = 3.1415926535897932384626433832795;
   const int MAX_BUFFER_SIZE = 256;
@@ -0,0 +1,88 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * mopo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mopo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mopo.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cpu_features.h"
+
+#if MOPO_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#define SSE2_BIT (1 << 26)
+#define OSXSAVE_BIT (1 << 27)
+#define AVX_BIT (1 << 28)
+#define AVX2_BIT (1 << 5)
+#define AVX512F_BIT (1 << 16)
+#define XCR0_AVX_STATE 0x6
+#define XCR0_AVX512_STATE 0xe6
+
+namespace mopo {
+
+  namespace {
+#if MOPO_X86
+    void cpuid(int leaf, unsigned int* registers) {
+#ifdef _MSC_VER
+      int values[4];
+      __cpuidex(values, leaf, 0);
+      for (int i = 0; i < 4; ++i)
+        registers[i] = values[i];
+#else
+      __cpuid_count(leaf, 0, registers[0], registers[1], registers[2], registers[3]);
+#endif
+    }
+
+    unsigned long long xcr0() {
+#ifdef _MSC_VER
+      return _xgetbv(0);
+#else
+      unsigned int low, high;
+      __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+      return (static_cast<unsigned long long>(high) << 32) | low;
+#endif
+    }
+#endif
+  } // namespace
+
+  CpuFeatures::CpuFeatures() : sse2_(false), avx2_(false), avx512_(false) {
+#if MOPO_X86
+    unsigned int registers[4];
+    cpuid(0, registers);
+    unsigned int max_leaf = registers[0];
+
+    cpuid(1, registers);
+    sse2_ = registers[3] & SSE2_BIT;
+
+    // AVX registers are only usable if the OS saves them on context switch.
+    bool avx = (registers[2] & OSXSAVE_BIT) && (registers[2] & AVX_BIT) &&
+               (xcr0() & XCR0_AVX_STATE) == XCR0_AVX_STATE;
+
+    if (avx && max_leaf >= 7) {
+      cpuid(7, registers);
+      avx2_ = registers[1] & AVX2_BIT;
+      avx512_ = (registers[1] & AVX512F_BIT) &&
+                (xcr0() & XCR0_AVX512_STATE) == XCR0_AVX512_STATE;
+    }
+#endif
+  }
+
+  const CpuFeatures& CpuFeatures::instance() {
+    static const CpuFeatures features;
+    return features;
+  }
+} // namespace mopo
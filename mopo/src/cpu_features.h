@@ -0,0 +1,59 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * mopo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mopo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mopo.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define MOPO_X86 1
+#else
+#define MOPO_X86 0
+#endif
+
+// Lets a single function use a newer instruction set than the rest of the
+// build. Only call these functions after checking CpuFeatures.
+#if MOPO_X86 && (defined(__GNUC__) || defined(__clang__))
+#define MOPO_MULTI_TARGET 1
+#define MOPO_TARGET_AVX2 __attribute__((target("avx2")))
+#define MOPO_TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define MOPO_MULTI_TARGET 0
+#define MOPO_TARGET_AVX2
+#define MOPO_TARGET_AVX512
+#endif
+
+namespace mopo {
+
+  // Instruction sets supported by both the running CPU and the OS.
+  class CpuFeatures {
+    public:
+      static bool hasSse2() { return instance().sse2_; }
+      static bool hasAvx2() { return instance().avx2_; }
+      static bool hasAvx512() { return instance().avx512_; }
+
+    private:
+      CpuFeatures();
+
+      static const CpuFeatures& instance();
+
+      bool sse2_;
+      bool avx2_;
+      bool avx512_;
+  };
+} // namespace mopo
+
+#endif // CPU_FEATURES_H
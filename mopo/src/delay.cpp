@@ -20,24 +20,31 @@
 
 namespace mopo {
 
-  Delay::Delay(int size) : Processor(Delay::kNumInputs, 1) {
-    memory_ = new Memory(size);
+  Delay::Delay(mopo_float max_seconds, std::shared_ptr<LazyMemory::Registry> effect_memory) :
+      Processor(Delay::kNumInputs, 1), lazy_memory_(effect_memory) {
+    memory_ = nullptr;
+    max_seconds_ = max_seconds;
+    lazy_memory_.setSize(max_seconds_ * sample_rate_);
     current_feedback_ = 0.0;
     current_wet_ = 0.0;
     current_dry_ = 0.0;
     current_period_ = DEFAULT_PERIOD;
   }
 
-  Delay::Delay(const Delay& other) : Processor(other) {
-    this->memory_ = new Memory(*other.memory_);
+  Delay::Delay(const Delay& other) : Processor(other), lazy_memory_(other.lazy_memory_) {
+    this->memory_ = nullptr;
+    this->max_seconds_ = other.max_seconds_;
     this->current_feedback_ = 0.0;
     this->current_wet_ = 0.0;
     this->current_dry_ = 0.0;
     this->current_period_ = DEFAULT_PERIOD;
   }
 
-  Delay::~Delay() {
-    delete memory_;
+  Delay::~Delay() { }
+
+  void Delay::setSampleRate(int sample_rate) {
+    Processor::setSampleRate(sample_rate);
+    lazy_memory_.setSize(max_seconds_ * sample_rate_);
   }
 
   void Delay::process() {
@@ -55,9 +62,32 @@ namespace mopo {
     mopo_float new_feedback = input(kFeedback)->at(0);
     mopo_float feedback_inc = (new_feedback - current_feedback_) / buffer_size_;
 
+    // Memory can be freed once the tail has been silent for a while.
+    mopo_float sample_delay = input(kSampleDelay)->at(0);
+    if (tail_.update(audio, buffer_size_, new_feedback, sample_delay)) {
+      lazy_memory_.rest();
+      current_feedback_ = new_feedback;
+      current_wet_ = new_wet;
+      current_dry_ = new_dry;
+      utils::zeroBuffer(dest, buffer_size_);
+      return;
+    }
+
+    memory_ = lazy_memory_.get();
+    if (memory_ == nullptr) {
+      current_feedback_ = new_feedback;
+      processDry(audio, dest, wet_inc, dry_inc);
+      return;
+    }
+
     mopo_float new_period = utils::clamp(input(kSampleDelay)->at(0), 2.0, memory_->getSize() - 1.0);
     mopo_float period_inc = (new_period - current_period_) / buffer_size_;
 
+    if (period_inc == 0.0 && current_period_ >= buffer_size_) {
+      processBlock(audio, dest, feedback_inc, wet_inc, dry_inc);
+      return;
+    }
+
     for (int i = 0; i < buffer_size_; ++i) {
       current_feedback_ += feedback_inc;
       current_wet_ += wet_inc;
@@ -67,6 +97,38 @@ namespace mopo {
     }
   }
 
+  void Delay::processBlock(const mopo_float* audio, mopo_float* dest,
+                           mopo_float feedback_inc,
+                           mopo_float wet_inc, mopo_float dry_inc) {
+    // With a fixed period longer than the block nothing read this block is
+    // written this block, so all reads can happen up front.
+    mopo_float reads[MAX_BUFFER_SIZE];
+    memory_->readInterpolated(reads, current_period_, -1.0, buffer_size_);
+
+    for (int i = 0; i < buffer_size_; ++i) {
+      current_feedback_ += feedback_inc;
+      dest[i] = audio[i] + reads[i] * current_feedback_;
+    }
+    memory_->pushBlock(dest, buffer_size_);
+
+    for (int i = 0; i < buffer_size_; ++i) {
+      current_wet_ += wet_inc;
+      current_dry_ += dry_inc;
+      dest[i] = current_dry_ * audio[i] + current_wet_ * reads[i];
+      MOPO_ASSERT(std::isfinite(dest[i]));
+    }
+  }
+
+  void Delay::processDry(const mopo_float* audio, mopo_float* dest,
+                         mopo_float wet_inc, mopo_float dry_inc) {
+    // Until memory is handed over there is nothing to read back.
+    for (int i = 0; i < buffer_size_; ++i) {
+      current_wet_ += wet_inc;
+      current_dry_ += dry_inc;
+      dest[i] = current_dry_ * audio[i];
+    }
+  }
+
   inline void Delay::tick(int i, const mopo_float* audio, mopo_float* dest) {
     mopo_float read = memory_->get(current_period_);
     memory_->push(audio[i] + read * current_feedback_);
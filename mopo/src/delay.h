@@ -18,8 +18,10 @@
 #ifndef DELAY_H
 #define DELAY_H
 
+#include "lazy_memory.h"
 #include "memory.h"
 #include "processor.h"
+#include "tail_tracker.h"
 #include "utils.h"
 
 namespace mopo {
@@ -36,17 +38,30 @@ namespace mopo {
         kNumInputs
       };
 
-      Delay(int size);
+      Delay(mopo_float max_seconds, std::shared_ptr<LazyMemory::Registry> effect_memory = nullptr);
       Delay(const Delay& other);
       virtual ~Delay();
 
       virtual Processor* clone() const override { return new Delay(*this); }
       virtual void process() override;
+      virtual void setSampleRate(int sample_rate) override;
+
+      // True once the input is quiet and the echoes have died out.
+      bool isSilent() const { return tail_.isSilent(); }
 
       inline void tick(int i, const mopo_float* audio, mopo_float* dest);
 
     protected:
+      void processBlock(const mopo_float* audio, mopo_float* dest,
+                        mopo_float feedback_inc,
+                        mopo_float wet_inc, mopo_float dry_inc);
+      void processDry(const mopo_float* audio, mopo_float* dest,
+                      mopo_float wet_inc, mopo_float dry_inc);
+
+      LazyMemory lazy_memory_;
       Memory* memory_;
+      TailTracker tail_;
+      mopo_float max_seconds_;
       mopo_float current_feedback_;
       mopo_float current_wet_;
       mopo_float current_dry_;
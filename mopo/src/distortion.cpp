@@ -15,110 +15,61 @@
  */
 
 #include "distortion.h"
+#include "dsp_kernels.h"
 #include "utils.h"
 
 namespace mopo {
 
-  namespace {
-    inline mopo_float linearFold(mopo_float t) {
-      mopo_float adjust = 0.25 * t + 0.75;
-      mopo_float range = adjust - floor(adjust);
-      return fabs(2.0 - 4.0 * range) - 1.0;
-    }
-
-    inline mopo_float sinFold(mopo_float t) {
-      mopo_float adjust = -0.25 * t + 0.5;
-      mopo_float range = adjust - floor(adjust);
-      return utils::quickSin1(range);
-    }
-  } // namespace
-
-
   Distortion::Distortion() :
       Processor(Distortion::kNumInputs, 1), last_mix_(0.0), last_drive_(0.0) { }
 
   void Distortion::processSoftClip() {
-    const mopo_float* audio = input(kAudio)->source->buffer;
     mopo_float next_drive = input(kDrive)->at(0);
     mopo_float mult_drive = (next_drive - last_drive_) / buffer_size_;
     mopo_float next_mix = input(kMix)->at(0);
     mopo_float mult_mix = (next_mix - last_mix_) / buffer_size_;
 
-    mopo_float* dest = output()->buffer;
-    int buffer_size = buffer_size_;
-
-    VECTORIZE_LOOP
-    for (int i = 0; i < buffer_size; ++i) {
-      mopo_float mix = last_mix_ + i * mult_mix;
-      mopo_float drive = last_drive_ + i * mult_drive;
-      mopo_float distort = drive * audio[i];
-      dest[i] = utils::interpolate(audio[i], utils::quickTanh(distort), mix);
-    }
+    kernels::table().softClip(output()->buffer, input(kAudio)->source->buffer,
+                              last_drive_, mult_drive, last_mix_, mult_mix, buffer_size_);
 
     last_mix_ = next_mix;
     last_drive_ = next_drive;
   }
 
   void Distortion::processHardClip() {
-    const mopo_float* audio = input(kAudio)->source->buffer;
     mopo_float next_drive = input(kDrive)->at(0);
     mopo_float mult_drive = (next_drive - last_drive_) / buffer_size_;
     mopo_float next_mix = input(kMix)->at(0);
     mopo_float mult_mix = (next_mix - last_mix_) / buffer_size_;
 
-    mopo_float* dest = output()->buffer;
-    int buffer_size = buffer_size_;
-
-    for (int i = 0; i < buffer_size; ++i) {
-      mopo_float mix = last_mix_ + i * mult_mix;
-      mopo_float drive = last_drive_ + i * mult_drive;
-      mopo_float distort = utils::clamp(drive * audio[i], -1.0, 1.0);
-      dest[i] = utils::interpolate(audio[i], distort, mix);
-    }
+    kernels::table().hardClip(output()->buffer, input(kAudio)->source->buffer,
+                              last_drive_, mult_drive, last_mix_, mult_mix, buffer_size_);
 
     last_mix_ = next_mix;
     last_drive_ = next_drive;
   }
 
   void Distortion::processLinearFold() {
-    const mopo_float* audio = input(kAudio)->source->buffer;
     mopo_float next_drive = input(kDrive)->at(0);
     mopo_float mult_drive = (next_drive - last_drive_) / buffer_size_;
     mopo_float next_mix = input(kMix)->at(0);
     mopo_float mult_mix = (next_mix - last_mix_) / buffer_size_;
 
-    mopo_float* dest = output()->buffer;
-    int buffer_size = buffer_size_;
-
-    VECTORIZE_LOOP
-    for (int i = 0; i < buffer_size; ++i) {
-      mopo_float mix = last_mix_ + i * mult_mix;
-      mopo_float drive = last_drive_ + i * mult_drive;
-      mopo_float distort = linearFold(drive * audio[i]);
-      dest[i] = utils::interpolate(audio[i], distort, mix);
-    }
+    kernels::table().linearFold(output()->buffer, input(kAudio)->source->buffer,
+                                last_drive_, mult_drive, last_mix_, mult_mix, buffer_size_);
 
     last_mix_ = next_mix;
     last_drive_ = next_drive;
   }
 
   void Distortion::processSinFold() {
-    const mopo_float* audio = input(kAudio)->source->buffer;
     mopo_float next_drive = input(kDrive)->at(0);
     mopo_float mult_drive = (next_drive - last_drive_) / buffer_size_;
     mopo_float next_mix = input(kMix)->at(0);
     mopo_float mult_mix = (next_mix - last_mix_) / buffer_size_;
 
-    mopo_float* dest = output()->buffer;
-    int buffer_size = buffer_size_;
-
-    VECTORIZE_LOOP
-    for (int i = 0; i < buffer_size; ++i) {
-      mopo_float mix = last_mix_ + i * mult_mix;
-      mopo_float drive = last_drive_ + i * mult_drive;
-      mopo_float distort = sinFold(drive * audio[i]);
-      dest[i] = utils::interpolate(audio[i], distort, mix);
-    }
+    kernels::table().sinFold(output()->buffer, input(kAudio)->source->buffer,
+                             last_drive_, mult_drive, last_mix_, mult_mix, buffer_size_);
 
     last_mix_ = next_mix;
     last_drive_ = next_drive;
@@ -0,0 +1,177 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * mopo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mopo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mopo.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "dsp_kernels.h"
+
+#include "cpu_features.h"
+#include "utils.h"
+
+#include <cmath>
+
+#if MOPO_MULTI_TARGET
+#define KERNEL_INLINE inline __attribute__((always_inline))
+#else
+#define KERNEL_INLINE inline
+#endif
+
+namespace mopo {
+  namespace kernels {
+
+    namespace {
+      // Loop bodies shared by every variant. They are forced inline into each
+      // target function so the compiler vectorizes them for that target.
+      KERNEL_INLINE void addLoop(mopo_float* dest, const mopo_float* left,
+                                 const mopo_float* right, int size) {
+        for (int i = 0; i < size; ++i)
+          dest[i] = left[i] + right[i];
+      }
+
+      KERNEL_INLINE void multiplyLoop(mopo_float* dest, const mopo_float* left,
+                                      const mopo_float* right, int size) {
+        for (int i = 0; i < size; ++i)
+          dest[i] = left[i] * right[i];
+      }
+
+      KERNEL_INLINE void accumulateLoop(mopo_float* dest, const mopo_float* source, int size) {
+        for (int i = 0; i < size; ++i)
+          dest[i] += source[i];
+      }
+
+      KERNEL_INLINE void mixLoop(mopo_float* dest, const mopo_float* dry, const mopo_float* wet,
+                                 mopo_float dry_start, mopo_float dry_inc,
+                                 mopo_float wet_start, mopo_float wet_inc, int size) {
+        for (int i = 0; i < size; ++i) {
+          mopo_float dry_amount = dry_start + i * dry_inc;
+          mopo_float wet_amount = wet_start + i * wet_inc;
+          dest[i] = dry_amount * dry[i] + wet_amount * wet[i];
+        }
+      }
+
+      KERNEL_INLINE mopo_float softClip(mopo_float t) {
+        return utils::quickTanh(t);
+      }
+
+      KERNEL_INLINE mopo_float hardClip(mopo_float t) {
+        return utils::clamp(t, -1.0, 1.0);
+      }
+
+      KERNEL_INLINE mopo_float linearFold(mopo_float t) {
+        mopo_float adjust = 0.25 * t + 0.75;
+        mopo_float range = adjust - floor(adjust);
+        return fabs(2.0 - 4.0 * range) - 1.0;
+      }
+
+      KERNEL_INLINE mopo_float sinFold(mopo_float t) {
+        mopo_float adjust = -0.25 * t + 0.5;
+        mopo_float range = adjust - floor(adjust);
+        return utils::quickSin1(range);
+      }
+
+      template<mopo_float (*shape)(mopo_float)>
+      KERNEL_INLINE void distortLoop(mopo_float* dest, const mopo_float* audio,
+                                     mopo_float drive_start, mopo_float drive_inc,
+                                     mopo_float mix_start, mopo_float mix_inc, int size) {
+        for (int i = 0; i < size; ++i) {
+          mopo_float mix = mix_start + i * mix_inc;
+          mopo_float drive = drive_start + i * drive_inc;
+          dest[i] = utils::interpolate(audio[i], shape(drive * audio[i]), mix);
+        }
+      }
+
+      KERNEL_INLINE void interpolateWindowLoop(mopo_float* dest, const mopo_float* window,
+                                               mopo_float fraction, int size) {
+        for (int i = 0; i < size; ++i)
+          dest[i] = utils::interpolate(window[i + 1], window[i], fraction);
+      }
+
+// Defines every kernel for one instruction set and a table pointing at them.
+#define DEFINE_KERNELS(TARGET, SUFFIX)                                                        \
+      TARGET void add##SUFFIX(mopo_float* dest, const mopo_float* left,                       \
+                              const mopo_float* right, int size) {                            \
+        addLoop(dest, left, right, size);                                                     \
+      }                                                                                       \
+      TARGET void multiply##SUFFIX(mopo_float* dest, const mopo_float* left,                  \
+                                   const mopo_float* right, int size) {                       \
+        multiplyLoop(dest, left, right, size);                                                \
+      }                                                                                       \
+      TARGET void accumulate##SUFFIX(mopo_float* dest, const mopo_float* source, int size) {  \
+        accumulateLoop(dest, source, size);                                                   \
+      }                                                                                       \
+      TARGET void mix##SUFFIX(mopo_float* dest, const mopo_float* dry, const mopo_float* wet, \
+                              mopo_float dry_start, mopo_float dry_inc,                       \
+                              mopo_float wet_start, mopo_float wet_inc, int size) {           \
+        mixLoop(dest, dry, wet, dry_start, dry_inc, wet_start, wet_inc, size);                \
+      }                                                                                       \
+      TARGET void softClip##SUFFIX(mopo_float* dest, const mopo_float* audio,                 \
+                                   mopo_float drive_start, mopo_float drive_inc,              \
+                                   mopo_float mix_start, mopo_float mix_inc, int size) {      \
+        distortLoop<softClip>(dest, audio, drive_start, drive_inc, mix_start, mix_inc, size); \
+      }                                                                                       \
+      TARGET void hardClip##SUFFIX(mopo_float* dest, const mopo_float* audio,                 \
+                                   mopo_float drive_start, mopo_float drive_inc,              \
+                                   mopo_float mix_start, mopo_float mix_inc, int size) {      \
+        distortLoop<hardClip>(dest, audio, drive_start, drive_inc, mix_start, mix_inc, size); \
+      }                                                                                       \
+      TARGET void linearFold##SUFFIX(mopo_float* dest, const mopo_float* audio,               \
+                                     mopo_float drive_start, mopo_float drive_inc,            \
+                                     mopo_float mix_start, mopo_float mix_inc, int size) {    \
+        distortLoop<linearFold>(dest, audio, drive_start, drive_inc,                          \
+                                mix_start, mix_inc, size);                                    \
+      }                                                                                       \
+      TARGET void sinFold##SUFFIX(mopo_float* dest, const mopo_float* audio,                  \
+                                  mopo_float drive_start, mopo_float drive_inc,               \
+                                  mopo_float mix_start, mopo_float mix_inc, int size) {       \
+        distortLoop<sinFold>(dest, audio, drive_start, drive_inc, mix_start, mix_inc, size);  \
+      }                                                                                       \
+      TARGET void interpolateWindow##SUFFIX(mopo_float* dest, const mopo_float* window,       \
+                                            mopo_float fraction, int size) {                  \
+        interpolateWindowLoop(dest, window, fraction, size);                                  \
+      }                                                                                       \
+      const KernelTable kernels##SUFFIX = {                                                   \
+        add##SUFFIX, multiply##SUFFIX, accumulate##SUFFIX, mix##SUFFIX,                       \
+        softClip##SUFFIX, hardClip##SUFFIX, linearFold##SUFFIX, sinFold##SUFFIX,              \
+        interpolateWindow##SUFFIX                                                             \
+      };
+
+      DEFINE_KERNELS(, Default)
+#if MOPO_MULTI_TARGET
+      DEFINE_KERNELS(MOPO_TARGET_AVX2, Avx2)
+      DEFINE_KERNELS(MOPO_TARGET_AVX512, Avx512)
+#endif
+
+      const KernelTable& selectKernels() {
+#if MOPO_MULTI_TARGET
+        if (CpuFeatures::hasAvx512())
+          return kernelsAvx512;
+        if (CpuFeatures::hasAvx2())
+          return kernelsAvx2;
+#endif
+        return kernelsDefault;
+      }
+
+      struct KernelSelector {
+        KernelSelector() { selected = &selectKernels(); }
+      };
+    } // namespace
+
+    const KernelTable* selected = &kernelsDefault;
+
+    namespace {
+      const KernelSelector selector;
+    } // namespace
+  } // namespace kernels
+} // namespace mopo
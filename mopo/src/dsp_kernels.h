@@ -0,0 +1,96 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * mopo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mopo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mopo.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+#ifndef DSP_KERNELS_H
+#define DSP_KERNELS_H
+
+#include "common.h"
+
+namespace mopo {
+
+  // Hot inner loops built once for each instruction set the compiler can
+  // target. The variants for the running CPU are picked through CpuFeatures
+  // while mopo is loading, so a baseline build still gets the wider vectors
+  // on machines that have them.
+  namespace kernels {
+    typedef void (*BinaryKernel)(mopo_float* dest, const mopo_float* left,
+                                 const mopo_float* right, int size);
+    typedef void (*AccumulateKernel)(mopo_float* dest, const mopo_float* source, int size);
+    typedef void (*MixKernel)(mopo_float* dest, const mopo_float* dry, const mopo_float* wet,
+                              mopo_float dry_start, mopo_float dry_inc,
+                              mopo_float wet_start, mopo_float wet_inc, int size);
+    typedef void (*DistortKernel)(mopo_float* dest, const mopo_float* audio,
+                                  mopo_float drive_start, mopo_float drive_inc,
+                                  mopo_float mix_start, mopo_float mix_inc, int size);
+    typedef void (*WindowKernel)(mopo_float* dest, const mopo_float* window,
+                                 mopo_float fraction, int size);
+
+    struct KernelTable {
+      BinaryKernel add;
+      BinaryKernel multiply;
+      AccumulateKernel accumulate;
+      MixKernel mix;
+      DistortKernel softClip;
+      DistortKernel hardClip;
+      DistortKernel linearFold;
+      DistortKernel sinFold;
+      WindowKernel interpolateWindow;
+    };
+
+    // Starts out as the baseline table and is switched once at static
+    // initialization, so calls never go through a guard.
+    extern const KernelTable* selected;
+
+    inline const KernelTable& table() {
+      return *selected;
+    }
+
+    // dest[i] = left[i] + right[i]
+    inline void add(mopo_float* dest, const mopo_float* left,
+                    const mopo_float* right, int size) {
+      table().add(dest, left, right, size);
+    }
+
+    // dest[i] = left[i] * right[i]
+    inline void multiply(mopo_float* dest, const mopo_float* left,
+                         const mopo_float* right, int size) {
+      table().multiply(dest, left, right, size);
+    }
+
+    // dest[i] += source[i]
+    inline void accumulate(mopo_float* dest, const mopo_float* source, int size) {
+      table().accumulate(dest, source, size);
+    }
+
+    // Crossfades _dry_ and _wet_ with gains ramping linearly from their start
+    // values by their increments each sample.
+    inline void mix(mopo_float* dest, const mopo_float* dry, const mopo_float* wet,
+                    mopo_float dry_start, mopo_float dry_inc,
+                    mopo_float wet_start, mopo_float wet_inc, int size) {
+      table().mix(dest, dry, wet, dry_start, dry_inc, wet_start, wet_inc, size);
+    }
+
+    // dest[i] = interpolate(window[i + 1], window[i], fraction)
+    inline void interpolateWindow(mopo_float* dest, const mopo_float* window,
+                                  mopo_float fraction, int size) {
+      table().interpolateWindow(dest, window, fraction, size);
+    }
+  } // namespace kernels
+} // namespace mopo
+
+#endif // DSP_KERNELS_H
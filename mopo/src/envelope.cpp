@@ -68,11 +68,11 @@ namespace mopo {
       }
     }
     if (state_ == kDecaying) {
-      mopo_float decay_samples = sample_rate_ * input(kDecay)->at(0);
+      double decay_samples = sample_rate_ * input(kDecay)->at(0);
       mopo_float sustain = input(kSustain)->at(0);
 
-      mopo_float decay_decay_ = SampleDecayLookup::sampleDecayLookup(decay_samples);
-      mopo_float leftover_samples = samples_to_process_ - samples;
+      double decay_decay_ = SampleDecayLookup::sampleDecayLookup(decay_samples);
+      double leftover_samples = samples_to_process_ - samples;
       mopo_float delta = current_value_ - sustain;
       mopo_float end_delta = delta * pow(decay_decay_, leftover_samples);
 
@@ -80,10 +80,10 @@ namespace mopo {
       output(kValue)->buffer[0] = current_value_;
     }
     else if (state_ == kReleasing) {
-      mopo_float release_samples = sample_rate_ * input(kRelease)->at(0);
+      double release_samples = sample_rate_ * input(kRelease)->at(0);
 
-      mopo_float release_decay = SampleDecayLookup::sampleDecayLookup(release_samples);
-      mopo_float leftover_samples = samples_to_process_ - samples;
+      double release_decay = SampleDecayLookup::sampleDecayLookup(release_samples);
+      double leftover_samples = samples_to_process_ - samples;
       current_value_ = current_value_ * pow(release_decay, leftover_samples);
       output(kValue)->buffer[0] = current_value_;
     }
@@ -0,0 +1,286 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * mopo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mopo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mopo.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "execution_plan.h"
+
+#include "graph_edit.h"
+#include "magnitude_lookup.h"
+#include "midi_lookup.h"
+#include "processor.h"
+#include "resonance_lookup.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#define MAX_COMPARED_OUTPUTS 8
+
+namespace mopo {
+
+  ExecutionPlan::ExecutionPlan() : compiled_version_(-1) {
+#if MOPO_PROFILE
+    profiler_ = nullptr;
+#endif
+  }
+
+  void ExecutionPlan::swap(ExecutionPlan& other) {
+    steps_.swap(other.steps_);
+    step_index_.swap(other.step_index_);
+    sources_.swap(other.sources_);
+    watched_.swap(other.watched_);
+    seen_versions_.swap(other.seen_versions_);
+    std::swap(compiled_version_, other.compiled_version_);
+#if MOPO_PROFILE
+    std::swap(profiler_, other.profiler_);
+#endif
+  }
+
+  void ExecutionPlan::compile(const std::vector<Processor*>& order, int version) {
+    steps_.clear();
+    step_index_.clear();
+    sources_.clear();
+
+    for (Processor* processor : order)
+      addStep(processor, processor, nullptr);
+
+    watchSources(nullptr);
+    compiled_version_ = version;
+  }
+
+  void ExecutionPlan::compile(const std::vector<Processor*>& order,
+                              const std::vector<const Processor*>& originals,
+                              const GraphEdit* edit) {
+    MOPO_ASSERT(order.size() == originals.size());
+    steps_.clear();
+    step_index_.clear();
+    sources_.clear();
+
+    for (size_t i = 0; i < order.size(); ++i)
+      addStep(order[i], originals[i], edit);
+
+    watchSources(edit);
+    compiled_version_ = -1;
+  }
+
+#if MOPO_PROFILE
+  void ExecutionPlan::profile(Profiler* profiler) {
+    profiler_ = profiler;
+    for (PlanStep& step : steps_)
+      step.profile_key = profiler ? profiler->getTypeKey(step.processor) : -1;
+  }
+#endif
+
+  void ExecutionPlan::addStep(Processor* processor, const Processor* original,
+                              const GraphEdit* edit) {
+    PlanStep step;
+    step.op = PlanStep::kProcess;
+    step.processor = processor;
+    step.output = nullptr;
+    step.dest = nullptr;
+    step.first_source = sources_.size();
+    step.num_sources = 0;
+    step.first_watched = 0;
+    step.num_watched = 0;
+    step.versions_outputs = processor->versionsOutputs();
+    step.incremental = false;
+    step.stale = true;
+#if MOPO_PROFILE
+    step.profile_key = -1;
+#endif
+
+    bool compiled = processor->compile(&step);
+    if (compiled) {
+      step.output = processor->output();
+      step.dest = step.output->buffer;
+    }
+
+    if (compiled || (processor->isStateless() && step.versions_outputs)) {
+      if (edit) {
+        step.num_sources = edit->numInputs(original);
+        for (int i = 0; i < step.num_sources; ++i)
+          sources_.push_back(edit->source(original, i));
+      }
+      else {
+        step.num_sources = processor->numInputs();
+        for (int i = 0; i < step.num_sources; ++i)
+          sources_.push_back(processor->input(i)->source);
+      }
+    }
+
+    step_index_[processor] = steps_.size();
+    steps_.push_back(step);
+  }
+
+  void ExecutionPlan::watchSources(const GraphEdit* edit) {
+    watched_.clear();
+
+    for (PlanStep& step : steps_) {
+      step.stale = true;
+      step.incremental = step.versions_outputs &&
+                         (step.op != PlanStep::kProcess || step.processor->isStateless());
+
+      step.first_watched = watched_.size();
+      int end = step.first_source + step.num_sources;
+      for (int i = step.first_source; i < end; ++i)
+        watch(&step, sources_[i], edit);
+      step.num_watched = watched_.size() - step.first_watched;
+    }
+
+    seen_versions_.assign(watched_.size(), 0);
+  }
+
+  void ExecutionPlan::watch(PlanStep* step, const Output* source,
+                            const GraphEdit* edit) {
+    const Processor* owner = source->owner;
+
+    // Nobody versions this one so there's no telling when it changes.
+    if (owner == nullptr || !owner->versionsOutputs())
+      step->incremental = false;
+    watched_.push_back(source);
+
+    if (owner == nullptr || !owner->aliasesInputs())
+      return;
+
+    int num_inputs = edit ? edit->numInputs(owner) : owner->numInputs();
+    for (int i = 0; i < num_inputs; ++i)
+      watch(step, edit ? edit->source(owner, i) : owner->input(i)->source, edit);
+  }
+
+  inline bool ExecutionPlan::sourcesChanged(PlanStep& step) {
+    bool changed = step.stale;
+    step.stale = false;
+
+    int end = step.first_watched + step.num_watched;
+    for (int i = step.first_watched; i < end; ++i) {
+      unsigned int version = watched_[i]->version;
+      if (version != seen_versions_[i]) {
+        seen_versions_[i] = version;
+        changed = true;
+      }
+    }
+    return changed;
+  }
+
+  void ExecutionPlan::processVersioned(Processor* processor) {
+    mopo_float last_values[MAX_COMPARED_OUTPUTS];
+    int num_outputs = processor->numOutputs();
+    int num_compared = std::min(num_outputs, MAX_COMPARED_OUTPUTS);
+    for (int i = 0; i < num_compared; ++i)
+      last_values[i] = processor->output(i)->buffer[0];
+
+    processor->process();
+
+    for (int i = 0; i < num_compared; ++i) {
+      Output* output = processor->output(i);
+      if (output->buffer[0] != last_values[i])
+        output->markChanged();
+    }
+    for (int i = num_compared; i < num_outputs; ++i)
+      processor->output(i)->markChanged();
+  }
+
+  int ExecutionPlan::findStep(const Processor* processor) const {
+    auto step = step_index_.find(processor);
+    return step == step_index_.end() ? -1 : step->second;
+  }
+
+  void ExecutionPlan::markStale() {
+    for (PlanStep& step : steps_)
+      step.stale = true;
+  }
+
+  void ExecutionPlan::run(int start, int end) {
+#if MOPO_PROFILE
+    ProfileScope scope(profiler_, Profiler::kInlineOperators);
+#endif
+    const Output* const* all_sources = sources_.data();
+
+    for (int s = start; s < end; ++s) {
+      PlanStep& step = steps_[s];
+      if (!step.processor->enabled())
+        continue;
+      if (step.incremental && !sourcesChanged(step))
+        continue;
+
+      if (step.op == PlanStep::kProcess) {
+#if MOPO_PROFILE
+        ProfileScope scope(profiler_, step.profile_key);
+#endif
+        if (step.versions_outputs)
+          processVersioned(step.processor);
+        else
+          step.processor->process();
+        continue;
+      }
+
+      const Output* const* sources = all_sources + step.first_source;
+      mopo_float* dest = step.dest;
+      mopo_float last_value = dest[0];
+
+      switch (step.op) {
+        case PlanStep::kAdd:
+          dest[0] = sources[0]->buffer[0] + sources[1]->buffer[0];
+          break;
+        case PlanStep::kMultiply:
+          dest[0] = sources[0]->buffer[0] * sources[1]->buffer[0];
+          break;
+        case PlanStep::kVariableAdd: {
+          mopo_float value = 0.0;
+          for (int i = 0; i < step.num_sources; ++i)
+            value += sources[i]->buffer[0];
+          dest[0] = value;
+          break;
+        }
+        case PlanStep::kSquare:
+          dest[0] = sources[0]->buffer[0] * sources[0]->buffer[0];
+          break;
+        case PlanStep::kQuadratic:
+          dest[0] = sources[0]->buffer[0] * sources[0]->buffer[0] + step.constants[0];
+          break;
+        case PlanStep::kRoot:
+          dest[0] = sqrt(sources[0]->buffer[0]) + step.constants[0];
+          break;
+        case PlanStep::kExponentialScale:
+          dest[0] = std::pow(step.constants[0], sources[0]->buffer[0]) + step.constants[1];
+          break;
+        case PlanStep::kClamp:
+          dest[0] = utils::clamp(sources[0]->buffer[0], step.constants[0], step.constants[1]);
+          break;
+        case PlanStep::kLowerBound:
+          dest[0] = utils::max(sources[0]->buffer[0], step.constants[0]);
+          break;
+        case PlanStep::kUpperBound:
+          dest[0] = utils::min(sources[0]->buffer[0], step.constants[0]);
+          break;
+        case PlanStep::kMidiScale:
+          dest[0] = MidiLookup::centsLookup(CENTS_PER_NOTE * sources[0]->buffer[0]);
+          break;
+        case PlanStep::kMagnitudeScale:
+          dest[0] = MagnitudeLookup::magnitudeLookup(sources[0]->buffer[0]);
+          break;
+        case PlanStep::kResonanceScale:
+          dest[0] = ResonanceLookup::qLookup(sources[0]->buffer[0]);
+          break;
+        default:
+          MOPO_ASSERT(false);
+      }
+
+      if (dest[0] != last_value)
+        step.output->markChanged();
+    }
+  }
+} // namespace mopo
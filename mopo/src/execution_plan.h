@@ -0,0 +1,139 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * mopo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mopo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mopo.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef EXECUTION_PLAN_H
+#define EXECUTION_PLAN_H
+
+#include "common.h"
+#include "profiler.h"
+
+#include <map>
+#include <vector>
+
+namespace mopo {
+
+  class GraphEdit;
+  class Processor;
+  struct Output;
+
+  // One step of a compiled ProcessorRouter. Simple control rate operators
+  // describe themselves with an op code and constants so the router can run
+  // them inline. Everything else falls back to calling process().
+  // Incremental steps are skipped while none of their sources have a new
+  // version since they last ran.
+  struct PlanStep {
+    enum OpCode {
+      kProcess,
+      kAdd,
+      kMultiply,
+      kVariableAdd,
+      kSquare,
+      kQuadratic,
+      kRoot,
+      kExponentialScale,
+      kClamp,
+      kLowerBound,
+      kUpperBound,
+      kMidiScale,
+      kMagnitudeScale,
+      kResonanceScale,
+      kNumOpCodes
+    };
+
+    OpCode op;
+    Processor* processor;
+    Output* output;
+    mopo_float* dest;
+    int first_source;
+    int num_sources;
+    int first_watched;
+    int num_watched;
+    mopo_float constants[2];
+    bool versions_outputs;
+    bool incremental;
+    bool stale;
+#if MOPO_PROFILE
+    int profile_key;
+#endif
+  };
+
+  // A flat list of steps compiled from a topologically sorted order with
+  // inputs and outputs resolved ahead of time. Has to be recompiled when
+  // the topology version of the router running it changes.
+  class ExecutionPlan {
+    public:
+      ExecutionPlan();
+
+      void compile(const std::vector<Processor*>& order, int version);
+
+      // Compiles _order_ as it will be once _edit_ is committed. Each entry
+      // of _originals_ is what the matching entry of _order_ was cloned from.
+      // Stays invalid until validate() is called with the router's new
+      // version after the commit.
+      void compile(const std::vector<Processor*>& order,
+                   const std::vector<const Processor*>& originals,
+                   const GraphEdit* edit);
+
+#if MOPO_PROFILE
+      // Looks up every step's key in _profiler_ after compiling so running
+      // the plan never has to.
+      void profile(Profiler* profiler);
+#endif
+
+      void run() { run(0, numSteps()); }
+
+      // Runs steps [_start_, _end_) so a caller can split the plan around
+      // one of its steps.
+      void run(int start, int end);
+
+      // Returns the index of the step running _processor_ or -1.
+      int findStep(const Processor* processor) const;
+      int numSteps() const { return steps_.size(); }
+
+      // Makes every step run again next time without recompiling.
+      void markStale();
+      void invalidate() { compiled_version_ = -1; }
+      void validate(int version) { compiled_version_ = version; }
+      bool isCompiled(int version) const { return compiled_version_ == version; }
+      void swap(ExecutionPlan& other);
+
+    private:
+      void addStep(Processor* processor, const Processor* original,
+                   const GraphEdit* edit);
+
+      // Picks the steps that can run incrementally and the Outputs whose
+      // versions they wait on. Outputs that can point at any of their
+      // owner's inputs are watched along with all of those inputs so
+      // switching between them doesn't need a recompile.
+      void watchSources(const GraphEdit* edit);
+      void watch(PlanStep* step, const Output* source, const GraphEdit* edit);
+      bool sourcesChanged(PlanStep& step);
+      void processVersioned(Processor* processor);
+
+      std::vector<PlanStep> steps_;
+      std::map<const Processor*, int> step_index_;
+      std::vector<const Output*> sources_;
+      std::vector<const Output*> watched_;
+      std::vector<unsigned int> seen_versions_;
+      int compiled_version_;
+#if MOPO_PROFILE
+      Profiler* profiler_;
+#endif
+  };
+} // namespace mopo
+
+#endif // EXECUTION_PLAN_H
@@ -32,8 +32,11 @@ namespace mopo {
   }
 
   void Feedback::refreshOutput() {
-    if (control_rate_)
+    if (control_rate_) {
+      if (output(0)->buffer[0] != buffer_[0])
+        output(0)->markChanged();
       output(0)->buffer[0] = buffer_[0];
+    }
     else
       utils::copyBuffer(output(0)->buffer, buffer_, MAX_BUFFER_SIZE);
   }
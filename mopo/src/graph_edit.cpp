@@ -0,0 +1,728 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * mopo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mopo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mopo.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "graph_edit.h"
+
+#include "buffer_pool.h"
+#include "feedback.h"
+#include "processor_router.h"
+#include "value.h"
+
+#include <algorithm>
+
+namespace mopo {
+
+  GraphEdit::GraphEdit() :
+      isolated_outputs_(nullptr), prepared_(false), committed_(false) { }
+
+  GraphEdit::~GraphEdit() {
+    for (RouterInstance* instance : instances_)
+      delete instance;
+
+    for (auto& pool : pools_)
+      delete pool.second;
+
+    if (committed_)
+      return;
+
+    for (Processor* clone : created_clones_)
+      delete clone;
+
+    for (Processor* processor : created_processors_) {
+      processor->destroy();
+      delete processor;
+    }
+
+    for (Input* input : created_inputs_)
+      delete input;
+  }
+
+  void GraphEdit::plug(Processor* destination, const Output* source, int index) {
+    MOPO_ASSERT(index < numInputs(destination));
+    MOPO_ASSERT(source);
+
+    Input* input = getInputs(destination)[index];
+    MOPO_ASSERT(input);
+    sources_[input] = source;
+
+    if (destination->router())
+      connect(destination->router(), destination, source, index);
+  }
+
+  void GraphEdit::plugNext(Processor* destination, const Output* source) {
+    const std::vector<Input*>& inputs = getInputs(destination);
+    for (size_t i = 0; i < inputs.size(); ++i) {
+      Input* input = inputs[i];
+      if (input && getSource(input) == &Processor::null_source_) {
+        plug(destination, source, i);
+        return;
+      }
+    }
+
+    // If there are no empty inputs, create another.
+    Input* input = new Input();
+    input->source = source;
+    created_inputs_.push_back(input);
+
+    InputChanges& changes = getInputChanges(destination);
+    changes.inputs.push_back(input);
+    changes.owned_inputs.push_back(input);
+
+    if (destination->router() && source != &Processor::null_source_)
+      connect(destination->router(), destination, source, changes.inputs.size() - 1);
+  }
+
+  void GraphEdit::unplug(Processor* destination, const Processor* source) {
+    if (destination->router()) {
+      // Whoever holds _destination_ has to recompile with its new inputs.
+      getChanges(destination->router());
+      for (int i = 0; i < source->numOutputs(); ++i)
+        disconnect(destination->router(), destination, source->output(i));
+    }
+
+    const std::vector<Input*>& inputs = getInputs(destination);
+    for (Input* input : inputs) {
+      if (input && getSource(input)->owner == source)
+        sources_[input] = &Processor::null_source_;
+    }
+  }
+
+  void GraphEdit::addProcessor(ProcessorRouter* router, Processor* processor) {
+    MOPO_ASSERT(processor->router() == 0 || processor->router() == router);
+    RouterChanges& changes = getChanges(router);
+
+    processor->router(router);
+    processor->setBufferSize(router->getBufferSize());
+    changes.order.push_back(processor);
+    changes.local_order.push_back(processor);
+    changes.removed.erase(processor);
+    changes.added[processor] = processor;
+
+    for (int i = 0; i < numInputs(processor); ++i)
+      connect(router, processor, source(processor, i), i);
+  }
+
+  void GraphEdit::removeProcessor(ProcessorRouter* router,
+                                  const Processor* processor) {
+    for (int i = 0; i < numInputs(processor); ++i)
+      disconnect(router, processor, source(processor, i));
+
+    MOPO_ASSERT(processor->router() == router);
+    RouterChanges& changes = getChanges(router);
+    std::vector<const Processor*>::iterator pos =
+        std::find(changes.order.begin(), changes.order.end(), processor);
+    MOPO_ASSERT(pos != changes.order.end());
+    changes.order.erase(pos);
+
+    std::vector<Processor*>::iterator local_pos =
+        std::find(changes.local_order.begin(), changes.local_order.end(), processor);
+    MOPO_ASSERT(local_pos != changes.local_order.end());
+    changes.local_order.erase(local_pos);
+
+    changes.added.erase(processor);
+    changes.removed.insert(processor);
+  }
+
+  void GraphEdit::set(Value* value, mopo_float new_value) {
+    values_.push_back(std::pair<Value*, mopo_float>(value, new_value));
+  }
+
+  void GraphEdit::replaceList(std::vector<Processor*>* list,
+                              const std::vector<Processor*>& contents) {
+    lists_[list] = contents;
+  }
+
+  bool GraphEdit::contains(const ProcessorRouter* router,
+                           const Processor* processor) const {
+    auto changes = changes_.find(router);
+    if (changes != changes_.end()) {
+      if (changes->second.added.count(processor))
+        return true;
+      if (changes->second.removed.count(processor))
+        return false;
+    }
+    return router->processors_.count(processor);
+  }
+
+  int GraphEdit::numInputs(const Processor* processor) const {
+    return getInputs(processor).size();
+  }
+
+  const Output* GraphEdit::source(const Processor* processor, int index) const {
+    Input* input = getInputs(processor)[index];
+    MOPO_ASSERT(input);
+    return getSource(input);
+  }
+
+  int GraphEdit::connectedInputs(const Processor* processor) const {
+    int count = 0;
+    for (Input* input : getInputs(processor)) {
+      if (input && getSource(input) != &Processor::null_source_)
+        count++;
+    }
+
+    return count;
+  }
+
+  const std::vector<Processor*>& GraphEdit::localOrder(
+      const ProcessorRouter* router) const {
+    auto instance = router_instances_.find(router);
+    if (instance != router_instances_.end())
+      return instance->second->local_order;
+    return router->local_order_;
+  }
+
+  const std::vector<Feedback*>& GraphEdit::localFeedbackOrder(
+      const ProcessorRouter* router) const {
+    auto instance = router_instances_.find(router);
+    if (instance != router_instances_.end())
+      return instance->second->local_feedback_order;
+    return router->local_feedback_order_;
+  }
+
+  void GraphEdit::collectSources(const Processor* processor,
+                                 std::vector<const Output*>* sources) const {
+    for (Input* input : getInputs(processor)) {
+      if (input)
+        sources->push_back(getSource(input));
+    }
+  }
+
+  void GraphEdit::prepare() {
+    MOPO_ASSERT(!prepared_);
+
+    std::set<ProcessorRouter*> roots;
+    for (auto& changes : changes_) {
+      ProcessorRouter* router = changes.second.router;
+      families_[router->global_order_] = &changes.second;
+
+      ProcessorRouter* root = router->getTopLevelRouter();
+      roots.insert(root ? root : router);
+    }
+
+    // Isolated copies find their originals' inputs through the vector
+    // they used to share.
+    for (auto& inputs : inputs_)
+      shared_inputs_[inputs.second.processor->inputs_] = &inputs.second.inputs;
+
+    for (ProcessorRouter* root : roots)
+      root->prepareEdit(this);
+
+    // Nothing runs new processors yet so any routers among them compile
+    // their own plans.
+    for (auto& changes : changes_) {
+      for (auto& added : changes.second.added)
+        added.second->compilePlans();
+    }
+    for (Processor* clone : created_clones_)
+      clone->compilePlans();
+
+    // Isolated copies read their own inputs so their plans are compiled
+    // against them once they're all staged.
+    for (RouterInstance* instance : instances_) {
+      if (instance->compiled)
+        continue;
+
+      std::vector<const Processor*> copies(instance->local_order.begin(),
+                                           instance->local_order.end());
+      instance->plan.compile(instance->local_order, copies, this);
+#if MOPO_PROFILE
+      instance->plan.profile(instance->router->getProfiler());
+#endif
+      instance->compiled = true;
+    }
+
+    prepared_ = true;
+  }
+
+  void GraphEdit::prepareRouter(ProcessorRouter* router) {
+    auto family = families_.find(router->global_order_);
+    if (family == families_.end())
+      return;
+
+    RouterChanges* changes = family->second;
+    RouterInstance* instance = new RouterInstance();
+    instance->router = router;
+    instance->processors = router->processors_;
+    instance->feedback_processors = router->feedback_processors_;
+
+    std::vector<const Processor*> originals;
+
+    if (router == changes->router) {
+      // Copies hold on to processors that were removed like
+      // updateAllProcessors does, only the original forgets them.
+      for (const Processor* processor : changes->removed)
+        instance->processors.erase(processor);
+      for (auto& processor : changes->added)
+        instance->processors[processor.first] = processor.second;
+
+      for (const Processor* feedback : changes->removed_feedbacks)
+        instance->feedback_processors.erase(feedback);
+      for (auto& feedback : changes->added_feedbacks)
+        instance->feedback_processors[feedback.first] = feedback.second;
+
+      instance->local_order = changes->local_order;
+      instance->local_feedback_order = changes->local_feedback_order;
+      originals.assign(instance->local_order.begin(), instance->local_order.end());
+    }
+    else {
+      instance->local_order.reserve(changes->order.size());
+      for (const Processor* next : changes->order) {
+        auto found = instance->processors.find(next);
+        if (found == instance->processors.end()) {
+          Processor* clone = next->clone();
+          created_clones_.push_back(clone);
+          if (isolated_outputs_ && router->isIsolated()) {
+            clone->isolateOutputs(*isolated_outputs_);
+            isolated_clones_.insert(clone);
+          }
+          found = instance->processors.insert(
+              std::pair<const Processor*, Processor*>(next, clone)).first;
+        }
+        instance->local_order.push_back(found->second);
+      }
+
+      instance->local_feedback_order.reserve(changes->feedback_order.size());
+      for (const Feedback* next : changes->feedback_order) {
+        auto found = instance->feedback_processors.find(next);
+        if (found == instance->feedback_processors.end()) {
+          Feedback* clone = new Feedback(*next);
+          created_clones_.push_back(clone);
+          if (isolated_outputs_ && router->isIsolated()) {
+            clone->isolateOutputs(*isolated_outputs_);
+            isolated_clones_.insert(clone);
+          }
+          found = instance->feedback_processors.insert(
+              std::pair<const Processor*, Feedback*>(next, clone)).first;
+        }
+        instance->local_feedback_order.push_back(found->second);
+      }
+      originals = changes->order;
+    }
+
+    // Isolated copies read their own inputs, not their originals', so they
+    // wait until prepare() has staged those.
+    instance->compiled = !router->isIsolated();
+    if (instance->compiled) {
+      instance->plan.compile(instance->local_order, originals, this);
+#if MOPO_PROFILE
+      instance->plan.profile(router->getProfiler());
+#endif
+    }
+
+    instances_.push_back(instance);
+    router_instances_[router] = instance;
+  }
+
+  void GraphEdit::stageIsolatedInputs(Processor* processor,
+                                      const output_remap& outputs) {
+    MOPO_ASSERT(processor->isIsolated());
+    const std::vector<Input*>& shared = getSharedInputs(processor);
+    size_t num_inputs = shared.size();
+
+    if (isolated_clones_.count(processor)) {
+      // Nothing runs new copies yet so they are linked up in place.
+      while (processor->isolated_inputs_.size() < num_inputs)
+        processor->isolated_inputs_.push_back(new Input());
+
+      processor->inputs_->assign(num_inputs, nullptr);
+      for (size_t i = 0; i < num_inputs; ++i) {
+        if (shared[i] == nullptr)
+          continue;
+
+        processor->isolated_inputs_[i]->source = getIsolatedSource(shared[i], outputs);
+        processor->inputs_->at(i) = processor->isolated_inputs_[i];
+      }
+
+      size_t num_outputs = processor->shared_outputs_->size();
+      processor->outputs_->assign(num_outputs, nullptr);
+      for (size_t i = 0; i < num_outputs; ++i) {
+        Output* output = processor->shared_outputs_->at(i);
+        auto mapped = outputs.find(output);
+        processor->outputs_->at(i) = mapped == outputs.end() ? output : mapped->second;
+      }
+      return;
+    }
+
+    const std::vector<Input*>& current = *processor->inputs_;
+    bool changed = current.size() != num_inputs;
+    for (size_t i = 0; i < num_inputs && !changed; ++i) {
+      if (shared[i] == nullptr)
+        changed = current[i] != nullptr;
+      else
+        changed = current[i] == nullptr ||
+                  current[i]->source != getIsolatedSource(shared[i], outputs);
+    }
+
+    if (!changed)
+      return;
+
+    IsolatedInputs& staged = isolated_inputs_[processor];
+    staged.processor = processor;
+    staged.isolated_inputs = processor->isolated_inputs_;
+    while (staged.isolated_inputs.size() < num_inputs) {
+      Input* input = new Input();
+      created_inputs_.push_back(input);
+      staged.isolated_inputs.push_back(input);
+    }
+
+    staged.inputs.assign(num_inputs, nullptr);
+    for (size_t i = 0; i < num_inputs; ++i) {
+      if (shared[i] == nullptr)
+        continue;
+
+      Input* input = staged.isolated_inputs[i];
+      sources_[input] = getIsolatedSource(shared[i], outputs);
+      staged.inputs[i] = input;
+    }
+  }
+
+  void GraphEdit::prepareIsolatedRouter(ProcessorRouter* router,
+                                        const output_remap& outputs) {
+    stageIsolatedInputs(router, outputs);
+
+    // Everything inside a new copy is new too.
+    bool created = isolated_clones_.count(router);
+    bool changed = false;
+    for (Processor* processor : localOrder(router)) {
+      if (created)
+        isolated_clones_.insert(processor);
+      processor->prepareIsolatedInputs(this, outputs);
+      changed = changed || isolated_clones_.count(processor) ||
+                isolated_inputs_.count(processor);
+    }
+
+    for (Feedback* feedback : localFeedbackOrder(router)) {
+      if (created)
+        isolated_clones_.insert(feedback);
+      feedback->prepareIsolatedInputs(this, outputs);
+      changed = changed || isolated_clones_.count(feedback) ||
+                isolated_inputs_.count(feedback);
+    }
+
+    // The plan resolved the old inputs so it has to be compiled again.
+    if (created || !changed || router_instances_.count(router))
+      return;
+
+    RouterInstance* instance = new RouterInstance();
+    instance->router = router;
+    instance->local_order = router->local_order_;
+    instance->processors = router->processors_;
+    instance->local_feedback_order = router->local_feedback_order_;
+    instance->feedback_processors = router->feedback_processors_;
+    instance->compiled = false;
+    instances_.push_back(instance);
+    router_instances_[router] = instance;
+  }
+
+  void GraphEdit::replacePool(BufferPool* pool, ProcessorRouter* router,
+                              const std::set<const Output*>& pinned) {
+    BufferPool* staged = new BufferPool();
+    staged->plan(router, pinned, this);
+    pools_.push_back(std::pair<BufferPool*, BufferPool*>(pool, staged));
+  }
+
+  void GraphEdit::replaceRemap(output_remap* remap, const output_remap& contents) {
+    remaps_[remap] = contents;
+  }
+
+  void GraphEdit::commit() {
+    MOPO_ASSERT(prepared_ && !committed_);
+
+    for (auto& source : sources_)
+      source.first->source = source.second;
+
+    for (auto& inputs : inputs_) {
+      Processor* processor = inputs.second.processor;
+      processor->inputs_->swap(inputs.second.inputs);
+      processor->owned_inputs_.swap(inputs.second.owned_inputs);
+    }
+
+    for (auto& isolated : isolated_inputs_) {
+      Processor* processor = isolated.second.processor;
+      processor->inputs_->swap(isolated.second.inputs);
+      processor->isolated_inputs_.swap(isolated.second.isolated_inputs);
+    }
+
+    for (auto& changes : changes_) {
+      ProcessorRouter* router = changes.second.router;
+      router->global_order_->swap(changes.second.order);
+      router->global_feedback_order_->swap(changes.second.feedback_order);
+      (*router->global_changes_)++;
+    }
+
+    for (RouterInstance* instance : instances_) {
+      ProcessorRouter* router = instance->router;
+      router->local_order_.swap(instance->local_order);
+      router->processors_.swap(instance->processors);
+      router->local_feedback_order_.swap(instance->local_feedback_order);
+      router->feedback_processors_.swap(instance->feedback_processors);
+      router->plan_.swap(instance->plan);
+      router->local_changes_ = *router->global_changes_;
+    }
+
+    for (auto& list : lists_)
+      list.first->swap(list.second);
+
+    for (auto& remap : remaps_)
+      remap.first->swap(remap.second);
+
+    for (auto& pool : pools_) {
+      pool.first->release();
+      pool.first->swap(*pool.second);
+      pool.first->apply();
+    }
+
+    for (auto& value : values_)
+      value.first->set(value.second);
+
+    for (RouterInstance* instance : instances_)
+      instance->router->plan_.validate(*instance->router->global_changes_);
+
+    committed_ = true;
+  }
+
+  GraphEdit::RouterChanges& GraphEdit::getChanges(ProcessorRouter* router) {
+    auto found = changes_.find(router);
+    if (found != changes_.end())
+      return found->second;
+
+    RouterChanges& changes = changes_[router];
+    changes.router = router;
+    changes.order = *router->global_order_;
+    changes.feedback_order = *router->global_feedback_order_;
+    changes.local_order = router->local_order_;
+    changes.local_feedback_order = router->local_feedback_order_;
+    return changes;
+  }
+
+  GraphEdit::InputChanges& GraphEdit::getInputChanges(Processor* processor) {
+    auto found = inputs_.find(processor);
+    if (found != inputs_.end())
+      return found->second;
+
+    InputChanges& changes = inputs_[processor];
+    changes.processor = processor;
+    changes.inputs = *processor->inputs_;
+    changes.owned_inputs = processor->owned_inputs_;
+
+    // The plans of the router holding _processor_ read its inputs.
+    if (processor->router())
+      getChanges(processor->router());
+    return changes;
+  }
+
+  const std::vector<Input*>& GraphEdit::getInputs(const Processor* processor) const {
+    auto isolated = isolated_inputs_.find(processor);
+    if (isolated != isolated_inputs_.end())
+      return isolated->second.inputs;
+
+    auto changes = inputs_.find(processor);
+    if (changes != inputs_.end())
+      return changes->second.inputs;
+    return *processor->inputs_;
+  }
+
+  const std::vector<Input*>& GraphEdit::getSharedInputs(
+      const Processor* processor) const {
+    auto staged = shared_inputs_.find(processor->shared_inputs_);
+    if (staged != shared_inputs_.end())
+      return *staged->second;
+    return *processor->shared_inputs_;
+  }
+
+  const Output* GraphEdit::getIsolatedSource(Input* shared,
+                                             const output_remap& outputs) const {
+    const Output* source = getSource(shared);
+    auto mapped = outputs.find(source);
+    return mapped == outputs.end() ? source : mapped->second;
+  }
+
+  const Output* GraphEdit::getSource(Input* input) const {
+    auto source = sources_.find(input);
+    if (source != sources_.end())
+      return source->second;
+    return input->source;
+  }
+
+  Feedback* GraphEdit::getFeedback(const ProcessorRouter* router,
+                                   const Processor* processor) const {
+    auto changes = changes_.find(router);
+    if (changes != changes_.end()) {
+      auto added = changes->second.added_feedbacks.find(processor);
+      if (added != changes->second.added_feedbacks.end())
+        return added->second;
+      if (changes->second.removed_feedbacks.count(processor))
+        return nullptr;
+    }
+
+    auto found = router->feedback_processors_.find(processor);
+    if (found != router->feedback_processors_.end())
+      return found->second;
+    return nullptr;
+  }
+
+  void GraphEdit::connect(ProcessorRouter* router, Processor* destination,
+                          const Output* source, int index) {
+    if (isDownstream(router, destination, source->owner)) {
+      // We are introducing a cycle so insert a Feedback node.
+      Feedback* feedback = nullptr;
+      if (source->owner->isControlRate() || destination->isControlRate())
+        feedback = new cr::Feedback();
+      else
+        feedback = new Feedback();
+      created_processors_.push_back(feedback);
+
+      plug(feedback, source, 0);
+      plug(destination, feedback->output(), index);
+      addFeedback(router, feedback);
+    }
+    else {
+      // Not introducing a cycle so just make sure _destination_ is in order.
+      reorder(router, destination);
+    }
+  }
+
+  void GraphEdit::disconnect(ProcessorRouter* router,
+                             const Processor* destination,
+                             const Output* source) {
+    if (!isDownstream(router, destination, source->owner))
+      return;
+
+    // We're fine unless there is a cycle and need to delete a Feedback node.
+    for (Input* input : getInputs(destination)) {
+      if (input == nullptr)
+        continue;
+
+      const Processor* owner = getSource(input)->owner;
+      Feedback* feedback = getFeedback(router, owner);
+
+      if (feedback) {
+        if (this->source(feedback, 0) == source)
+          removeFeedback(router, feedback);
+        sources_[input] = &Processor::null_source_;
+      }
+    }
+  }
+
+  void GraphEdit::reorder(ProcessorRouter* router, const Processor* processor) {
+    RouterChanges& changes = getChanges(router);
+
+    // Get all the dependencies inside this router.
+    std::set<const Processor*> dependencies = getDependencies(router, processor);
+
+    // Stably reorder putting dependencies first.
+    std::vector<const Processor*> new_order;
+    new_order.reserve(changes.order.size());
+
+    for (const Processor* next : changes.order) {
+      if (next != processor && dependencies.count(next))
+        new_order.push_back(next);
+    }
+
+    if (contains(router, processor))
+      new_order.push_back(processor);
+
+    for (const Processor* next : changes.order) {
+      if (next != processor && dependencies.count(next) == 0)
+        new_order.push_back(next);
+    }
+
+    MOPO_ASSERT(new_order.size() == changes.order.size());
+    changes.order.swap(new_order);
+
+    // Make sure our parent is ordered as well.
+    if (router->router())
+      reorder(router->router(), processor);
+  }
+
+  void GraphEdit::addFeedback(ProcessorRouter* router, Feedback* feedback) {
+    RouterChanges& changes = getChanges(router);
+
+    feedback->router(router);
+    changes.feedback_order.push_back(feedback);
+    changes.local_feedback_order.push_back(feedback);
+    changes.removed_feedbacks.erase(feedback);
+    changes.added_feedbacks[feedback] = feedback;
+  }
+
+  void GraphEdit::removeFeedback(ProcessorRouter* router,
+                                 const Feedback* feedback) {
+    RouterChanges& changes = getChanges(router);
+
+    std::vector<const Feedback*>::iterator pos =
+        std::find(changes.feedback_order.begin(),
+                  changes.feedback_order.end(), feedback);
+    MOPO_ASSERT(pos != changes.feedback_order.end());
+    changes.feedback_order.erase(pos);
+
+    std::vector<Feedback*>::iterator local_pos =
+        std::find(changes.local_feedback_order.begin(),
+                  changes.local_feedback_order.end(), feedback);
+    MOPO_ASSERT(local_pos != changes.local_feedback_order.end());
+    changes.local_feedback_order.erase(local_pos);
+
+    changes.added_feedbacks.erase(feedback);
+    changes.removed_feedbacks.insert(feedback);
+  }
+
+  bool GraphEdit::isDownstream(const ProcessorRouter* router,
+                               const Processor* first,
+                               const Processor* second) const {
+    std::set<const Processor*> dependencies = getDependencies(router, second);
+    return dependencies.find(first) != dependencies.end();
+  }
+
+  const Processor* GraphEdit::getContext(const ProcessorRouter* router,
+                                         const Processor* processor) const {
+    const Processor* context = processor;
+    while (context && !contains(router, context))
+      context = context->router();
+
+    return context;
+  }
+
+  std::set<const Processor*> GraphEdit::getDependencies(
+      const ProcessorRouter* router, const Processor* processor) const {
+    std::vector<const Processor*> inputs;
+    std::set<const Processor*> visited;
+    std::set<const Processor*> dependencies;
+    const Processor* context = getContext(router, processor);
+
+    inputs.push_back(processor);
+    for (size_t i = 0; i < inputs.size(); ++i) {
+      const Processor* dependency = getContext(router, inputs[i]);
+
+      if (dependency) {
+        dependencies.insert(dependency);
+
+        for (Input* input : getInputs(inputs[i])) {
+          const Output* source = input ? getSource(input) : nullptr;
+          if (source && source->owner &&
+              visited.find(source->owner) == visited.end()) {
+            inputs.push_back(source->owner);
+            visited.insert(source->owner);
+          }
+        }
+      }
+    }
+
+    // Make sure our context isn't listed as a dependency.
+    dependencies.erase(context);
+
+    return dependencies;
+  }
+} // namespace mopo
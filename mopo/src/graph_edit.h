@@ -0,0 +1,188 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * mopo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mopo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mopo.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef GRAPH_EDIT_H
+#define GRAPH_EDIT_H
+
+#include "common.h"
+#include "execution_plan.h"
+#include "processor.h"
+
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace mopo {
+
+  class BufferPool;
+  class Feedback;
+  class ProcessorRouter;
+  class Value;
+
+  // A batch of connection changes worked out away from the audio thread.
+  // The staging calls mirror the ones on Processor and ProcessorRouter but
+  // only touch a shadow of the graph. prepare() then builds every voice's
+  // copy of the changed routers and compiles their plans so commit() is just
+  // a handful of swaps that can run between audio blocks without allocating.
+  // Whatever commit() swaps out is freed when the GraphEdit is deleted.
+  class GraphEdit {
+    public:
+      GraphEdit();
+      ~GraphEdit();
+
+      void plug(Processor* destination, const Output* source, int index);
+      void plugNext(Processor* destination, const Output* source);
+      void unplug(Processor* destination, const Processor* source);
+      void addProcessor(ProcessorRouter* router, Processor* processor);
+      void removeProcessor(ProcessorRouter* router, const Processor* processor);
+
+      // Value changes and processor lists the audio thread walks outside of
+      // any ProcessorRouter are applied along with the connections.
+      void set(Value* value, mopo_float new_value);
+      void replaceList(std::vector<Processor*>* list,
+                       const std::vector<Processor*>& contents);
+
+      // The graph as it will look once this is committed.
+      bool contains(const ProcessorRouter* router,
+                    const Processor* processor) const;
+      int numInputs(const Processor* processor) const;
+      const Output* source(const Processor* processor, int index) const;
+      int connectedInputs(const Processor* processor) const;
+      const std::vector<Processor*>& localOrder(const ProcessorRouter* router) const;
+      const std::vector<Feedback*>& localFeedbackOrder(const ProcessorRouter* router) const;
+      void collectSources(const Processor* processor,
+                          std::vector<const Output*>* sources) const;
+
+      // Called off the audio thread once everything is staged.
+      void prepare();
+
+      // ProcessorRouter::prepareEdit calls this for every copy of itself.
+      void prepareRouter(ProcessorRouter* router);
+
+      // Isolated copies of routers are brought up to date in two passes like
+      // Processor::isolateOutputs and isolateInputs. While _outputs_ is set,
+      // new copies made inside isolated routers get their own outputs added
+      // to it. Then every isolated processor stages inputs reading from
+      // _outputs_, and routers whose children changed get a new plan.
+      void isolateCopies(output_remap* outputs) { isolated_outputs_ = outputs; }
+      void stageIsolatedInputs(Processor* processor, const output_remap& outputs);
+      void prepareIsolatedRouter(ProcessorRouter* router, const output_remap& outputs);
+
+      // Swaps in _pool_ planned for _router_ as it will be after the commit.
+      void replacePool(BufferPool* pool, ProcessorRouter* router,
+                       const std::set<const Output*>& pinned);
+      void replaceRemap(output_remap* remap, const output_remap& contents);
+
+      // Called between audio blocks. Never allocates or frees.
+      void commit();
+
+      bool isPrepared() const { return prepared_; }
+      bool isCommitted() const { return committed_; }
+
+    private:
+      struct RouterChanges {
+        ProcessorRouter* router;
+        std::vector<const Processor*> order;
+        std::vector<const Feedback*> feedback_order;
+
+        // The router that was edited keeps running in the order things were
+        // added to it. Only its copies follow the sorted order.
+        std::vector<Processor*> local_order;
+        std::vector<Feedback*> local_feedback_order;
+
+        std::map<const Processor*, Processor*> added;
+        std::set<const Processor*> removed;
+        std::map<const Processor*, Feedback*> added_feedbacks;
+        std::set<const Processor*> removed_feedbacks;
+      };
+
+      // Replacement state for one copy of a changed router.
+      struct RouterInstance {
+        ProcessorRouter* router;
+        std::vector<Processor*> local_order;
+        std::map<const Processor*, Processor*> processors;
+        std::vector<Feedback*> local_feedback_order;
+        std::map<const Processor*, Feedback*> feedback_processors;
+        ExecutionPlan plan;
+        bool compiled;
+      };
+
+      struct InputChanges {
+        Processor* processor;
+        std::vector<Input*> inputs;
+        std::vector<Input*> owned_inputs;
+      };
+
+      // Only grows isolated_inputs so nothing swapped out needs freeing.
+      struct IsolatedInputs {
+        Processor* processor;
+        std::vector<Input*> inputs;
+        std::vector<Input*> isolated_inputs;
+      };
+
+      RouterChanges& getChanges(ProcessorRouter* router);
+      InputChanges& getInputChanges(Processor* processor);
+      const std::vector<Input*>& getInputs(const Processor* processor) const;
+      const std::vector<Input*>& getSharedInputs(const Processor* processor) const;
+      const Output* getIsolatedSource(Input* shared, const output_remap& outputs) const;
+      const Output* getSource(Input* input) const;
+      Feedback* getFeedback(const ProcessorRouter* router,
+                            const Processor* processor) const;
+
+      // Shadow versions of the ProcessorRouter graph algorithms.
+      void connect(ProcessorRouter* router, Processor* destination,
+                   const Output* source, int index);
+      void disconnect(ProcessorRouter* router, const Processor* destination,
+                      const Output* source);
+      void reorder(ProcessorRouter* router, const Processor* processor);
+      void addFeedback(ProcessorRouter* router, Feedback* feedback);
+      void removeFeedback(ProcessorRouter* router, const Feedback* feedback);
+      bool isDownstream(const ProcessorRouter* router, const Processor* first,
+                        const Processor* second) const;
+      const Processor* getContext(const ProcessorRouter* router,
+                                  const Processor* processor) const;
+      std::set<const Processor*> getDependencies(const ProcessorRouter* router,
+                                                 const Processor* processor) const;
+
+      std::map<const ProcessorRouter*, RouterChanges> changes_;
+      std::map<const std::vector<const Processor*>*, RouterChanges*> families_;
+      std::vector<RouterInstance*> instances_;
+      std::map<const ProcessorRouter*, RouterInstance*> router_instances_;
+
+      std::map<Input*, const Output*> sources_;
+      std::map<const Processor*, InputChanges> inputs_;
+      std::map<const std::vector<Input*>*, const std::vector<Input*>*> shared_inputs_;
+      std::map<const Processor*, IsolatedInputs> isolated_inputs_;
+      std::set<const Processor*> isolated_clones_;
+      output_remap* isolated_outputs_;
+      std::vector<std::pair<BufferPool*, BufferPool*> > pools_;
+      std::map<output_remap*, output_remap> remaps_;
+      std::vector<std::pair<Value*, mopo_float> > values_;
+      std::map<std::vector<Processor*>*, std::vector<Processor*> > lists_;
+
+      // Owned by the edit until it is committed.
+      std::vector<Processor*> created_processors_;
+      std::vector<Processor*> created_clones_;
+      std::vector<Input*> created_inputs_;
+
+      bool prepared_;
+      bool committed_;
+  };
+} // namespace mopo
+
+#endif // GRAPH_EDIT_H
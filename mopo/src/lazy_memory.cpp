@@ -0,0 +1,170 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * mopo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mopo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mopo.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "lazy_memory.h"
+
+#include <utility>
+
+namespace mopo {
+
+  namespace {
+    struct Registries {
+      std::mutex mutex;
+      std::set<LazyMemory::Registry*> registries;
+    };
+
+    Registries& getRegistries() {
+      static Registries registries;
+      return registries;
+    }
+
+    std::shared_ptr<LazyMemory::Registry> getDefaultRegistry() {
+      static std::shared_ptr<LazyMemory::Registry> registry =
+          std::make_shared<LazyMemory::Registry>();
+      return registry;
+    }
+  } // namespace
+
+  LazyMemory::Registry::Registry() : update_number_(0), clock_(0) {
+    Registries& registries = getRegistries();
+    std::lock_guard<std::mutex> lock(registries.mutex);
+    registries.registries.insert(this);
+  }
+
+  LazyMemory::Registry::~Registry() {
+    Registries& registries = getRegistries();
+    std::lock_guard<std::mutex> lock(registries.mutex);
+    registries.registries.erase(this);
+  }
+
+  // Memory is only allocated and freed outside of mutex_ so making copies of
+  // effects never waits on it.
+  void LazyMemory::Registry::update() {
+    std::vector<std::pair<LazyMemory*, int> > sizes;
+    std::vector<Memory*> retired;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      update_number_++;
+      for (LazyMemory* memory : memories_) {
+        int size = memory->update(update_number_, &retired);
+        if (size)
+          sizes.push_back(std::make_pair(memory, size));
+      }
+    }
+
+    for (Memory* memory : retired)
+      delete memory;
+    retired.clear();
+    if (sizes.empty())
+      return;
+
+    std::vector<Memory*> allocated;
+    for (auto& size : sizes)
+      allocated.push_back(new Memory(size.second));
+
+    {
+      // Anything destroyed or resized in the meantime doesn't get its memory.
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (size_t i = 0; i < sizes.size(); ++i) {
+        LazyMemory* memory = sizes[i].first;
+        if (memories_.count(memory) && memory->allocated_size_ == sizes[i].second)
+          memory->handOver(allocated[i]);
+        else
+          retired.push_back(allocated[i]);
+      }
+    }
+
+    for (Memory* memory : retired)
+      delete memory;
+  }
+
+  LazyMemory::LazyMemory(std::shared_ptr<Registry> registry) :
+      registry_(registry ? registry : getDefaultRegistry()),
+      memory_(nullptr), allocated_size_(0), size_(0),
+      incoming_(nullptr), retired_(nullptr), release_(false) {
+    usage_ = new Usage();
+    std::lock_guard<std::mutex> lock(registry_->mutex_);
+    registry_->memories_.insert(this);
+  }
+
+  LazyMemory::LazyMemory(const LazyMemory& other) :
+      registry_(other.registry_), memory_(nullptr), allocated_size_(0),
+      size_(other.size_.load()), incoming_(nullptr), retired_(nullptr), release_(false) {
+    std::lock_guard<std::mutex> lock(registry_->mutex_);
+    usage_ = other.usage_;
+    usage_->references++;
+    registry_->memories_.insert(this);
+  }
+
+  LazyMemory::~LazyMemory() {
+    {
+      std::lock_guard<std::mutex> lock(registry_->mutex_);
+      registry_->memories_.erase(this);
+      if (--usage_->references == 0)
+        delete usage_;
+    }
+
+    delete memory_;
+    delete incoming_.load();
+    delete retired_.load();
+  }
+
+  void LazyMemory::updateAll() {
+    Registries& registries = getRegistries();
+    std::lock_guard<std::mutex> lock(registries.mutex);
+    for (Registry* registry : registries.registries)
+      registry->update();
+  }
+
+  int LazyMemory::update(int update_number, std::vector<Memory*>* retired) {
+    // Copies share usage so only the first of them to update checks it.
+    if (usage_->last_update != update_number) {
+      usage_->last_update = update_number;
+      unsigned int silent_samples = registry_->clock_.load(std::memory_order_relaxed) -
+                                    usage_->audible_sample.load(std::memory_order_relaxed);
+      if (usage_->used.exchange(false, std::memory_order_relaxed))
+        usage_->active = true;
+      else if (usage_->silent.load(std::memory_order_relaxed) &&
+               silent_samples >= LAZY_MEMORY_RELEASE_SAMPLES)
+        usage_->active = false;
+    }
+
+    // Wait for the audio thread to pick up the last hand over. Once it has,
+    // whatever it handed back can be freed.
+    if (incoming_.load(std::memory_order_acquire) || release_.load(std::memory_order_acquire))
+      return 0;
+
+    Memory* old_memory = retired_.exchange(nullptr, std::memory_order_relaxed);
+    if (old_memory)
+      retired->push_back(old_memory);
+
+    int wanted_size = 0;
+    if (usage_->active)
+      wanted_size = size_.load(std::memory_order_relaxed);
+
+    if (wanted_size == allocated_size_)
+      return 0;
+
+    allocated_size_ = wanted_size;
+    if (wanted_size == 0)
+      release_.store(true, std::memory_order_release);
+    return wanted_size;
+  }
+
+  void LazyMemory::handOver(Memory* memory) {
+    incoming_.store(memory, std::memory_order_release);
+  }
+} // namespace mopo
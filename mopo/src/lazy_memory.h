@@ -0,0 +1,144 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * mopo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mopo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mopo.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef LAZY_MEMORY_H
+#define LAZY_MEMORY_H
+
+#include "common.h"
+#include "memory.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace mopo {
+
+  // Samples that have to be processed after an effect goes silent before its
+  // memory is freed.
+  const unsigned int LAZY_MEMORY_RELEASE_SAMPLES = 1 << 18;
+
+  // Memory for an effect that is only allocated once the effect is processed
+  // and freed again once it has been silent for a while.
+  //
+  // The audio thread only ever picks up or hands back Memory through atomic
+  // slots. Allocating and freeing happens in updateAll() which has to be
+  // called regularly from a thread that isn't processing audio. How long an
+  // effect has been silent is counted in samples its engine processed, so it
+  // doesn't matter how fast blocks render, when updateAll() runs or how many
+  // other engines are running. Copies share their usage with the original so
+  // every voice of a cloned effect gets its memory as soon as any one of them
+  // is used.
+  class LazyMemory {
+    public:
+      // Every engine owns one and hands it to its effects. It holds their
+      // LazyMemory and counts the samples the engine processed.
+      class Registry {
+        public:
+          Registry();
+          ~Registry();
+
+          // Engines call this once a block from the audio thread.
+          void advance(int samples) {
+            clock_.fetch_add(samples, std::memory_order_relaxed);
+          }
+
+        private:
+          void update();
+
+          std::mutex mutex_;
+          std::set<LazyMemory*> memories_;
+          int update_number_;
+          std::atomic<unsigned int> clock_;
+
+          friend class LazyMemory;
+      };
+
+      // Without a _registry_ the memory goes in a default one that never
+      // counts samples, so it's never released while the effect exists.
+      LazyMemory(std::shared_ptr<Registry> registry = nullptr);
+      LazyMemory(const LazyMemory& other);
+      ~LazyMemory();
+
+      // Sets the number of samples to allocate. Not for the audio thread.
+      void setSize(int size) { size_.store(size, std::memory_order_relaxed); }
+
+      // Returns the current memory or nullptr if it isn't allocated yet and
+      // marks the effect as audible. Audio thread only.
+      Memory* get() {
+        usage_->audible_sample.store(registry_->clock_.load(std::memory_order_relaxed),
+                                     std::memory_order_relaxed);
+        usage_->silent.store(false, std::memory_order_relaxed);
+        usage_->used.store(true, std::memory_order_relaxed);
+        pickUp();
+        return memory_;
+      }
+
+      // Call instead of get() while the effect's tail tracker reports it's
+      // silent. This is where released memory is handed back, so the effect
+      // can't hold on to anything it got from get() before. Effects that stop
+      // being processed before then keep their memory so their tail is still
+      // there if they come back. Audio thread only.
+      void rest() {
+        usage_->silent.store(true, std::memory_order_relaxed);
+        pickUp();
+      }
+
+      // Allocates, swaps and frees memory for every LazyMemory of every
+      // registry.
+      static void updateAll();
+
+    protected:
+      struct Usage {
+        Usage() : used(false), silent(true), audible_sample(0), active(false),
+                  last_update(0), references(1) { }
+
+        std::atomic<bool> used;
+        std::atomic<bool> silent;
+        std::atomic<unsigned int> audible_sample;
+        bool active;
+        int last_update;
+        int references;
+      };
+
+      // Works out what to hand over without allocating so it can run under the
+      // registry's lock. Returns the size of Memory to allocate or 0.
+      int update(int update_number, std::vector<Memory*>* retired);
+      void handOver(Memory* memory);
+
+      void pickUp() {
+        if (incoming_.load(std::memory_order_relaxed) ||
+            release_.load(std::memory_order_relaxed)) {
+          retired_.store(memory_, std::memory_order_release);
+          memory_ = incoming_.exchange(nullptr, std::memory_order_acq_rel);
+          release_.store(false, std::memory_order_release);
+        }
+      }
+
+      std::shared_ptr<Registry> registry_;
+      Usage* usage_;
+      Memory* memory_;
+      int allocated_size_;
+      std::atomic<int> size_;
+      std::atomic<Memory*> incoming_;
+      std::atomic<Memory*> retired_;
+      std::atomic<bool> release_;
+  };
+} // namespace mopo
+
+#endif // LAZY_MEMORY_H
@@ -15,6 +15,7 @@
  */
 
 #include "memory.h"
+#include "dsp_kernels.h"
 #include "utils.h"
 
 #include <cmath>
@@ -25,19 +26,55 @@ namespace mopo {
   Memory::Memory(int size) : offset_(0) {
     size_ = utils::nextPowerOfTwo(size);
     bitmask_ = size_ - 1;
-    memory_ = new mopo_float[size_];
-    utils::zeroBuffer(memory_, size_);
+    memory_ = new mopo_float[size_ + MEMORY_GUARD_SIZE];
+    utils::zeroBuffer(memory_, size_ + MEMORY_GUARD_SIZE);
   }
 
   Memory::Memory(const Memory& other) {
-    this->memory_ = new mopo_float[other.size_];
-    utils::zeroBuffer(this->memory_, other.size_);
+    this->memory_ = new mopo_float[other.size_ + MEMORY_GUARD_SIZE];
+    utils::zeroBuffer(this->memory_, other.size_ + MEMORY_GUARD_SIZE);
     this->size_ = other.size_;
     this->bitmask_ = other.bitmask_;
     this->offset_ = other.offset_;
   }
 
   Memory::~Memory() {
-    delete memory_;
+    delete[] memory_;
+  }
+
+  void Memory::readInterpolated(mopo_float* dest, mopo_float past_start,
+                                mopo_float past_inc, int num) const {
+    MOPO_ASSERT(num <= MAX_BUFFER_SIZE);
+
+    // Reading a fixed delay while writing moves one sample forward per read.
+    // Every read then shares one fraction and both taps are contiguous.
+    if (past_inc == -1.0 && past_start - (num - 1) >= 1.0) {
+      int index = past_start;
+      mopo_float sample_fraction = past_start - index;
+      kernels::interpolateWindow(dest, getPointer(index), sample_fraction, num);
+      return;
+    }
+
+    mopo_float past_end = past_start + (num - 1) * past_inc;
+    int oldest = utils::imax(utils::max(past_start, past_end), 1);
+    int newest = utils::imax(utils::min(past_start, past_end), 1) - 1;
+    if (oldest - newest > MEMORY_GUARD_SIZE) {
+      for (int i = 0; i < num; ++i)
+        dest[i] = get(past_start + i * past_inc);
+      return;
+    }
+
+    // The whole window is contiguous so no read needs wrapping.
+    const mopo_float* window = getPointer(oldest);
+    VECTORIZE_LOOP
+    for (int i = 0; i < num; ++i) {
+      mopo_float past = past_start + i * past_inc;
+      int index = utils::imax(past, 1);
+      mopo_float sample_fraction = past - index;
+
+      mopo_float from = window[oldest - index + 1];
+      mopo_float to = window[oldest - index];
+      dest[i] = utils::interpolate(from, to, sample_fraction);
+    }
   }
 } // namespace mopo
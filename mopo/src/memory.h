@@ -22,11 +22,16 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 
 #include "utils.h"
 
 namespace mopo {
 
+  // Samples at the start of the ring are mirrored after its end so any window
+  // of up to this many samples can be read without wrapping.
+  const int MEMORY_GUARD_SIZE = 2 * MAX_BUFFER_SIZE;
+
   // A processor utility to store a stream of data for later lookup.
   class Memory {
     public:
@@ -37,30 +42,42 @@ namespace mopo {
       void push(mopo_float sample) {
         offset_ = (offset_ + 1) & bitmask_;
         memory_[offset_] = sample;
+        if (static_cast<int>(offset_) < MEMORY_GUARD_SIZE)
+          memory_[size_ + offset_] = sample;
       }
 
       void pushBlock(const mopo_float* samples, int num) {
+        MOPO_ASSERT(num <= static_cast<int>(size_));
         int next_offset = (offset_ + num) & bitmask_;
-        if (next_offset < offset_) {
+        if (offset_ + num >= size_) {
           int block1 = num - next_offset - 1;
           memcpy(memory_ + offset_ + 1, samples, sizeof(mopo_float) * block1);
-          memcpy(memory_, samples + block1, sizeof(mopo_float) * next_offset);
+          memcpy(memory_, samples + block1, sizeof(mopo_float) * (next_offset + 1));
+          mirror(offset_ + 1, size_);
+          mirror(0, next_offset + 1);
         }
-        else
+        else {
           memcpy(memory_ + offset_ + 1, samples, sizeof(mopo_float) * num);
+          mirror(offset_ + 1, next_offset + 1);
+        }
 
         offset_ = next_offset;
       }
 
       void pushZero(int num) {
+        MOPO_ASSERT(num <= static_cast<int>(size_));
         int next_offset = (offset_ + num) & bitmask_;
-        if (next_offset < offset_) {
+        if (offset_ + num >= size_) {
           int block1 = num - next_offset - 1;
           memset(memory_ + offset_ + 1, 0, sizeof(mopo_float) * block1);
-          memset(memory_, 0, sizeof(mopo_float) * next_offset);
+          memset(memory_, 0, sizeof(mopo_float) * (next_offset + 1));
+          mirror(offset_ + 1, size_);
+          mirror(0, next_offset + 1);
         }
-        else
+        else {
           memset(memory_ + offset_ + 1, 0, sizeof(mopo_float) * num);
+          mirror(offset_ + 1, next_offset + 1);
+        }
 
         offset_ = next_offset;
       }
@@ -81,6 +98,18 @@ namespace mopo {
         return utils::interpolate(from, to, sample_fraction);
       }
 
+      // Copies the _num_ samples starting _past_ samples ago into _dest_,
+      // oldest first. _num_ can't be more than _past_ + 1.
+      void readBlock(mopo_float* dest, int past, int num) const {
+        MOPO_ASSERT(num <= MEMORY_GUARD_SIZE);
+        MOPO_ASSERT(num <= past + 1);
+        utils::copyBuffer(dest, getPointer(past), num);
+      }
+
+      // Fills _dest_ with get(_past_start_ + i * _past_inc_) for each i.
+      void readInterpolated(mopo_float* dest, mopo_float past_start,
+                            mopo_float past_inc, int num) const;
+
       unsigned int getOffset() const { return offset_; }
 
       void setOffset(int offset) { offset_ = offset; }
@@ -93,11 +122,23 @@ namespace mopo {
         return memory_;
       }
 
+      mopo_float* getBuffer() {
+        return memory_;
+      }
+
       int getSize() const {
         return size_;
       }
 
     protected:
+      // Copies ring samples in [_start_, _end_) to the guard. Only the first
+      // min(size, MEMORY_GUARD_SIZE) samples of the ring have a copy there.
+      void mirror(int start, int end) {
+        end = std::min<int>(end, MEMORY_GUARD_SIZE);
+        if (start < end)
+          memcpy(memory_ + size_ + start, memory_ + start, sizeof(mopo_float) * (end - start));
+      }
+
       mopo_float* memory_;
       unsigned int size_;
       unsigned int bitmask_;
@@ -22,14 +22,20 @@
 #include "arpeggiator.h"
 #include "bit_crush.h"
 #include "biquad_filter.h"
+#include "buffer_pool.h"
 #include "bypass_router.h"
 #include "circular_queue.h"
 #include "common.h"
+#include "cpu_features.h"
 #include "delay.h"
+#include "dsp_kernels.h"
 #include "distortion.h"
 #include "envelope.h"
+#include "execution_plan.h"
 #include "feedback.h"
 #include "formant_manager.h"
+#include "graph_edit.h"
+#include "lazy_memory.h"
 #include "linear_slope.h"
 #include "magnitude_lookup.h"
 #include "memory.h"
@@ -38,12 +44,17 @@
 #include "note_handler.h"
 #include "operators.h"
 #include "oscillator.h"
+#include "pipeline_router.h"
 #include "portamento_slope.h"
 #include "processor.h"
+#include "processor_arena.h"
 #include "processor_router.h"
+#include "profiler.h"
+#include "random_generator.h"
 #include "resonance_lookup.h"
 #include "reverb.h"
 #include "reverb_all_pass.h"
+#include "reverb_bank.h"
 #include "reverb_comb.h"
 #include "simple_delay.h"
 #include "smooth_filter.h"
@@ -51,11 +62,13 @@
 #include "state_variable_filter.h"
 #include "step_generator.h"
 #include "stutter.h"
+#include "tail_tracker.h"
 #include "tick_router.h"
 #include "trigger_operators.h"
 #include "utils.h"
 #include "value.h"
 #include "voice_handler.h"
 #include "wave.h"
+#include "worker_pool.h"
 
 #endif // MOPO_H
@@ -15,10 +15,18 @@
  */
 
 #include "operators.h"
+#include "dsp_kernels.h"
 
 #if defined (__APPLE__)
   #include <Accelerate/Accelerate.h>
   #define USE_APPLE_ACCELERATE
+
+  // vDSP ends the names of its double precision functions with a D.
+  #if MOPO_FLOAT
+    #define VDSP(function) vDSP_##function
+  #else
+    #define VDSP(function) vDSP_##function##D
+  #endif
 #endif
 
 #include <iostream>
@@ -44,7 +52,7 @@ namespace mopo {
     MOPO_ASSERT(inputMatchesBufferSize());
 
 #ifdef USE_APPLE_ACCELERATE
-    vDSP_vclipD(input()->source->buffer, 1,
+    VDSP(vclip)(input()->source->buffer, 1,
                 &min_, &max_,
                 output()->buffer, 1, buffer_size_);
 #else
@@ -61,7 +69,7 @@ namespace mopo {
     MOPO_ASSERT(inputMatchesBufferSize());
 
 #ifdef USE_APPLE_ACCELERATE
-    vDSP_vnegD(input()->source->buffer, 1,
+    VDSP(vneg)(input()->source->buffer, 1,
                output()->buffer, 1, buffer_size_);
 #else
     for (int i = 0; i < buffer_size_; ++i)
@@ -74,7 +82,7 @@ namespace mopo {
     MOPO_ASSERT(inputMatchesBufferSize());
 
 #ifdef USE_APPLE_ACCELERATE
-    vDSP_vsmulD(input()->source->buffer, 1, &scale_,
+    VDSP(vsmul)(input()->source->buffer, 1, &scale_,
                 output()->buffer, 1, buffer_size_);
 #else
     for (int i = 0; i < buffer_size_; ++i)
@@ -87,13 +95,14 @@ namespace mopo {
     MOPO_ASSERT(inputMatchesBufferSize(0));
     MOPO_ASSERT(inputMatchesBufferSize(1));
 
-    mopo_float* dest = output()->buffer;
-    const mopo_float* source_left = input(0)->source->buffer;
-    const mopo_float* source_right = input(1)->source->buffer;
-
-    VECTORIZE_LOOP
-    for (int i = 0; i < buffer_size_; ++i)
-      bufferTick(dest, source_left, source_right, i);
+#ifdef USE_APPLE_ACCELERATE
+    VDSP(vadd)(input(0)->source->buffer, 1,
+               input(1)->source->buffer, 1,
+               output()->buffer, 1, buffer_size_);
+#else
+    kernels::add(output()->buffer, input(0)->source->buffer,
+                input(1)->source->buffer, buffer_size_);
+#endif
 
     processTriggers();
   }
@@ -103,7 +112,7 @@ namespace mopo {
     MOPO_ASSERT(inputMatchesBufferSize(1));
 
 #ifdef USE_APPLE_ACCELERATE
-    vDSP_vsubD(input(0)->source->buffer, 1,
+    VDSP(vsub)(input(0)->source->buffer, 1,
                input(1)->source->buffer, 1,
                output()->buffer, 1, buffer_size_);
 #else
@@ -117,13 +126,14 @@ namespace mopo {
     MOPO_ASSERT(inputMatchesBufferSize(0));
     MOPO_ASSERT(inputMatchesBufferSize(1));
 
-    mopo_float* dest = output()->buffer;
-    const mopo_float* source_left = input(0)->source->buffer;
-    const mopo_float* source_right = input(1)->source->buffer;
-
-    VECTORIZE_LOOP
-    for (int i = 0; i < buffer_size_; ++i)
-      bufferTick(dest, source_left, source_right, i);
+#ifdef USE_APPLE_ACCELERATE
+    VDSP(vmul)(input(0)->source->buffer, 1,
+               input(1)->source->buffer, 1,
+               output()->buffer, 1, buffer_size_);
+#else
+    kernels::multiply(output()->buffer, input(0)->source->buffer,
+                     input(1)->source->buffer, buffer_size_);
+#endif
 
     processTriggers();
   }
@@ -173,7 +183,7 @@ namespace mopo {
       for (int i = 0; i < num_inputs; ++i) {
         if (input(i)->source != &Processor::null_source_) {
 #ifdef USE_APPLE_ACCELERATE
-          vDSP_vaddD(input(i)->source->buffer, 1,
+          VDSP(vadd)(input(i)->source->buffer, 1,
                      output()->buffer, 1,
                      output()->buffer, 1, buffer_size_);
 #else
@@ -192,7 +202,7 @@ namespace mopo {
   void FrequencyToPhase::process() {
 #ifdef USE_APPLE_ACCELERATE
     mopo_float sample_rate = sample_rate_;
-    vDSP_vsdivD(input()->source->buffer, 1, &sample_rate,
+    VDSP(vsdiv)(input()->source->buffer, 1, &sample_rate,
                 output()->buffer, 1, buffer_size_);
 #else
     for (int i = 0; i < buffer_size_; ++i)
@@ -206,7 +216,7 @@ namespace mopo {
 
 #ifdef USE_APPLE_ACCELERATE
     mopo_float sample_rate = sample_rate_;
-    vDSP_svdivD(&sample_rate, input()->source->buffer, 1,
+    VDSP(svdiv)(&sample_rate, input()->source->buffer, 1,
                 output()->buffer, 1, buffer_size_);
 #else
     for (int i = 0; i < buffer_size_; ++i)
@@ -220,7 +230,7 @@ namespace mopo {
 
 #ifdef USE_APPLE_ACCELERATE
     mopo_float sample_rate = sample_rate_;
-    vDSP_vsmulD(input()->source->buffer, 1, &sample_rate,
+    VDSP(vsmul)(input()->source->buffer, 1, &sample_rate,
                 output()->buffer, 1, buffer_size_);
 #else
     for (int i = 0; i < buffer_size_; ++i)
@@ -232,7 +242,7 @@ namespace mopo {
   void SampleAndHoldBuffer::process() {
     mopo_float value = input()->source->buffer[0];
     mopo_float* dest = output()->buffer;
-    if (value == dest[0])
+    if (value == dest[0] && !output()->pooled)
       return;
 
     VECTORIZE_LOOP
@@ -260,7 +270,7 @@ namespace mopo {
       for (; i < buffer_size_; ++i)
         dest[i] = val;
     }
-    else if (last_value_ == new_value &&
+    else if (!output()->pooled && last_value_ == new_value &&
              new_value == output()->buffer[0] &&
              new_value == output()->buffer[buffer_size_ - 1] &&
              (buffer_size_ <= 1 || new_value == output()->buffer[buffer_size_ - 2])) {
@@ -18,6 +18,7 @@
 #ifndef OPERATORS_H
 #define OPERATORS_H
 
+#include "execution_plan.h"
 #include "magnitude_lookup.h"
 #include "midi_lookup.h"
 #include "resonance_lookup.h"
@@ -40,6 +41,7 @@ namespace mopo {
 
       virtual void process() override;
       virtual void tick(int i) = 0;
+      virtual bool rewritesOutputs() const override { return !control_rate_; }
       inline void processTriggers() {
         output()->clearTrigger();
         int num_inputs = numInputs();
@@ -512,6 +514,8 @@ namespace mopo {
         Bypass() : Operator(1, 1) { }
 
         virtual Processor* clone() const override { return new Bypass(*this); }
+        // Only ever writes the first sample.
+        bool rewritesOutputs() const override { return false; }
 
         void process() override {
           output()->buffer[0] = input()->at(0);
@@ -537,6 +541,14 @@ namespace mopo {
                                                          min_(min), max_(max) { }
 
         virtual Processor* clone() const override { return new Clamp(*this); }
+        bool rewritesOutputs() const override { return false; }
+
+        bool compile(PlanStep* step) const override {
+          step->op = PlanStep::kClamp;
+          step->constants[0] = min_;
+          step->constants[1] = max_;
+          return true;
+        }
 
         void process() override {
           tick(0);
@@ -560,6 +572,13 @@ namespace mopo {
         LowerBound(mopo_float min = 0.0) : Operator(1, 1), min_(min) { }
 
         virtual Processor* clone() const override { return new LowerBound(*this); }
+        bool rewritesOutputs() const override { return false; }
+
+        bool compile(PlanStep* step) const override {
+          step->op = PlanStep::kLowerBound;
+          step->constants[0] = min_;
+          return true;
+        }
 
         void process() override {
           tick(0);
@@ -583,6 +602,13 @@ namespace mopo {
         UpperBound(mopo_float max = 0.0) : Operator(1, 1), max_(max) { }
 
         virtual Processor* clone() const override { return new UpperBound(*this); }
+        bool rewritesOutputs() const override { return false; }
+
+        bool compile(PlanStep* step) const override {
+          step->op = PlanStep::kUpperBound;
+          step->constants[0] = max_;
+          return true;
+        }
 
         void process() override {
           tick(0);
@@ -607,6 +633,11 @@ namespace mopo {
 
         virtual Processor* clone() const override { return new Add(*this); }
 
+        bool compile(PlanStep* step) const override {
+          step->op = PlanStep::kAdd;
+          return true;
+        }
+
         inline void tick(int i) override {
           output()->buffer[0] = input(0)->at(0) + input(1)->at(0);
         }
@@ -623,6 +654,11 @@ namespace mopo {
 
         virtual Processor* clone() const override { return new Multiply(*this); }
 
+        bool compile(PlanStep* step) const override {
+          step->op = PlanStep::kMultiply;
+          return true;
+        }
+
         inline void tick(int i) override {
           output()->buffer[0] = input(0)->at(0) * input(1)->at(0);
         }
@@ -647,6 +683,7 @@ namespace mopo {
       virtual Processor* clone() const override {
         return new Interpolate(*this);
       }
+      bool rewritesOutputs() const override { return false; }
 
       void process() override {
         tick(0);
@@ -672,6 +709,11 @@ namespace mopo {
       Square() : Operator(1, 1, true) { }
       virtual Processor* clone() const override { return new Square(*this); }
 
+      bool compile(PlanStep* step) const override {
+        step->op = PlanStep::kSquare;
+        return true;
+      }
+
       void process() override {
         tick(0);
       }
@@ -691,6 +733,12 @@ namespace mopo {
         Quadratic(mopo_float offset) : Operator(1, 1, true), offset_(offset) { }
         virtual Processor* clone() const override { return new Quadratic(*this); }
 
+        bool compile(PlanStep* step) const override {
+          step->op = PlanStep::kQuadratic;
+          step->constants[0] = offset_;
+          return true;
+        }
+
         void process() override {
           tick(0);
         }
@@ -714,6 +762,12 @@ namespace mopo {
         Root(mopo_float offset) : Operator(1, 1, true), offset_(offset) { }
         virtual Processor* clone() const override { return new Root(*this); }
 
+        bool compile(PlanStep* step) const override {
+          step->op = PlanStep::kRoot;
+          step->constants[0] = offset_;
+          return true;
+        }
+
         void process() override {
           tick(0);
         }
@@ -740,6 +794,13 @@ namespace mopo {
           return new ExponentialScale(*this);
         }
 
+        bool compile(PlanStep* step) const override {
+          step->op = PlanStep::kExponentialScale;
+          step->constants[0] = scale_;
+          step->constants[1] = offset_;
+          return true;
+        }
+
         void process() override {
           tick(0);
         }
@@ -766,6 +827,11 @@ namespace mopo {
           return new VariableAdd(*this);
         }
 
+        bool compile(PlanStep* step) const override {
+          step->op = PlanStep::kVariableAdd;
+          return true;
+        }
+
         void process() override {
           size_t num_inputs = inputs_->size();
           mopo_float value = 0.0;
@@ -795,6 +861,8 @@ namespace mopo {
           return new FrequencyToPhase(*this);
         }
 
+        bool isStateless() const override { return true; }
+
         void process() override {
           tick(0);
         }
@@ -816,6 +884,8 @@ namespace mopo {
           return new FrequencyToSamples(*this);
         }
 
+        bool isStateless() const override { return true; }
+
         void process() override {
           tick(0);
         }
@@ -837,6 +907,8 @@ namespace mopo {
           return new TimeToSamples(*this);
         }
 
+        bool isStateless() const override { return true; }
+
         void process() override {
           tick(0);
         }
@@ -860,6 +932,11 @@ namespace mopo {
           return new MagnitudeScale(*this);
         }
 
+        bool compile(PlanStep* step) const override {
+          step->op = PlanStep::kMagnitudeScale;
+          return true;
+        }
+
         void process() override {
           tick(0);
         }
@@ -882,6 +959,11 @@ namespace mopo {
           return new MidiScale(*this);
         }
 
+        bool compile(PlanStep* step) const override {
+          step->op = PlanStep::kMidiScale;
+          return true;
+        }
+
         void process() override {
           tick(0);
         }
@@ -905,6 +987,11 @@ namespace mopo {
           return new ResonanceScale(*this);
         }
 
+        bool compile(PlanStep* step) const override {
+          step->op = PlanStep::kResonanceScale;
+          return true;
+        }
+
         void process() override {
           tick(0);
         }
@@ -56,7 +56,7 @@ namespace mopo {
         mopo_float phase = input(kPhase)->at(i);
 
         offset_ += frequency / sample_rate_;
-        mopo_float integral;
+        double integral;
         offset_ = utils::mod(offset_, &integral);
         output(kOscPhase)->buffer[i] = offset_;
         output(kAudio)->buffer[i] =
@@ -64,7 +64,7 @@ namespace mopo {
       }
 
     protected:
-      mopo_float offset_;
+      double offset_;
       Wave::Type waveform_;
   };
 } // namespace mopo
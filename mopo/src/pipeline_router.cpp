@@ -0,0 +1,159 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * mopo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mopo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mopo.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pipeline_router.h"
+
+#include "utils.h"
+
+namespace mopo {
+
+  PipelineRouter::PipelineRouter(int num_outputs) :
+      ProcessorRouter(0, num_outputs), chain_outputs_(num_outputs, nullptr),
+      workers_(nullptr), chain_task_(this), block_size_(0),
+      last_block_size_(0), chain_size_(0), latency_(0), delay_size_(0),
+      write_position_(0), read_position_(0) { }
+
+  PipelineRouter::~PipelineRouter() {
+    delete workers_;
+    for (Output* latch : latches_)
+      delete latch;
+  }
+
+  const Output* PipelineRouter::latch(const Output* source) {
+    Output* latched = new Output(source->buffer_size);
+    latched->owner = this;
+    latches_.push_back(latched);
+
+    addInput();
+    plug(source, numInputs() - 1);
+    return latched;
+  }
+
+  void PipelineRouter::setChainOutput(const Output* source, int index) {
+    MOPO_ASSERT(index < numOutputs());
+    chain_outputs_[index] = source;
+  }
+
+  void PipelineRouter::process() {
+    MOPO_ASSERT(!isPipelined());
+
+    latchInputs(buffer_size_);
+    ProcessorRouter::process();
+
+    for (int i = 0; i < numOutputs(); ++i)
+      utils::copyBuffer(output(i)->buffer, chain_outputs_[i]->buffer, buffer_size_);
+  }
+
+  void PipelineRouter::setBufferSize(int buffer_size) {
+    // While pipelined the chain is a block behind, so it gets its size when
+    // that block is started.
+    block_size_ = buffer_size;
+    if (!isPipelined())
+      ProcessorRouter::setBufferSize(buffer_size);
+  }
+
+  void PipelineRouter::setPipelined(bool pipelined, int latency) {
+    delete workers_;
+    workers_ = nullptr;
+    last_block_size_ = 0;
+    chain_size_ = 0;
+
+    if (!pipelined) {
+      latency_ = 0;
+      delay_lines_.clear();
+      if (block_size_)
+        ProcessorRouter::setBufferSize(block_size_);
+      return;
+    }
+
+    // The delay lines hold the latency plus a block written ahead of it.
+    latency_ = latency;
+    delay_size_ = 1;
+    while (delay_size_ < 2 * latency)
+      delay_size_ *= 2;
+
+    delay_lines_.assign(numOutputs() * delay_size_, 0.0);
+    write_position_ = latency;
+    read_position_ = 0;
+    workers_ = new WorkerPool(2);
+  }
+
+  void PipelineRouter::startPipeline() {
+    MOPO_ASSERT(isPipelined());
+    MOPO_ASSERT(block_size_ <= latency_);
+
+    // The inputs still hold last block so render that one.
+    chain_size_ = last_block_size_;
+    last_block_size_ = block_size_;
+    if (chain_size_ == 0)
+      return;
+
+    ProcessorRouter::setBufferSize(chain_size_);
+    latchInputs(chain_size_);
+    workers_->begin(&chain_task_, 1);
+  }
+
+  void PipelineRouter::finishPipeline() {
+    MOPO_ASSERT(isPipelined());
+
+    if (chain_size_) {
+      workers_->finish();
+      writeDelayLines(chain_size_);
+    }
+    readDelayLines(block_size_);
+  }
+
+  void PipelineRouter::ChainTask::runTask(int index) {
+    router_->ProcessorRouter::process();
+  }
+
+  void PipelineRouter::latchInputs(int samples) {
+    int num_latches = latches_.size();
+    for (int i = 0; i < num_latches; ++i) {
+      const Output* source = input(i)->source;
+      Output* latched = latches_[i];
+      int latch_samples = std::min(samples, latched->buffer_size);
+      latch_samples = std::min(latch_samples, source->buffer_size);
+      utils::copyBuffer(latched->buffer, source->buffer, latch_samples);
+
+      latched->triggered = source->triggered;
+      latched->trigger_offset = source->trigger_offset;
+      latched->trigger_value = source->trigger_value;
+    }
+  }
+
+  void PipelineRouter::writeDelayLines(int samples) {
+    int mask = delay_size_ - 1;
+    for (int i = 0; i < numOutputs(); ++i) {
+      mopo_float* line = delay_lines_.data() + i * delay_size_;
+      const mopo_float* source = chain_outputs_[i]->buffer;
+      for (int s = 0; s < samples; ++s)
+        line[(write_position_ + s) & mask] = source[s];
+    }
+    write_position_ = (write_position_ + samples) & mask;
+  }
+
+  void PipelineRouter::readDelayLines(int samples) {
+    int mask = delay_size_ - 1;
+    for (int i = 0; i < numOutputs(); ++i) {
+      const mopo_float* line = delay_lines_.data() + i * delay_size_;
+      mopo_float* dest = output(i)->buffer;
+      for (int s = 0; s < samples; ++s)
+        dest[s] = line[(read_position_ + s) & mask];
+    }
+    read_position_ = (read_position_ + samples) & mask;
+  }
+} // namespace mopo
@@ -0,0 +1,96 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * mopo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mopo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mopo.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef PIPELINE_ROUTER_H
+#define PIPELINE_ROUTER_H
+
+#include "processor_router.h"
+#include "worker_pool.h"
+
+#include <vector>
+
+namespace mopo {
+
+  // Runs a chain of processors that only reads the rest of the graph through
+  // latches. In pipelined mode the chain renders the previous block on a
+  // worker thread while the parent router renders the current one, and its
+  // outputs are delayed by a fixed latency so blocks of any size line up.
+  class PipelineRouter : public ProcessorRouter {
+    public:
+      PipelineRouter(int num_outputs);
+      virtual ~PipelineRouter();
+
+      virtual Processor* clone() const override {
+        MOPO_ASSERT(false);
+        return 0;
+      }
+
+      // Serial mode. Latches this block's inputs and runs the chain in place.
+      void process() override;
+      void setBufferSize(int buffer_size) override;
+
+      // Returns an Output processors in the chain read instead of _source_.
+      // _source_ becomes an input of this router so it is ordered before it.
+      const Output* latch(const Output* source);
+
+      // The chain's Output this router passes on as its output _index_.
+      void setChainOutput(const Output* source, int index);
+
+      // Call while audio isn't running. _latency_ has to be at least the
+      // largest block the router will be given.
+      void setPipelined(bool pipelined, int latency);
+      bool isPipelined() const { return workers_ != nullptr; }
+      int getLatency() const { return isPipelined() ? latency_ : 0; }
+
+      // Pipelined mode. The parent calls startPipeline() before anything
+      // overwrites last block's inputs, renders everything this doesn't
+      // feed, then calls finishPipeline() before reading the outputs.
+      void startPipeline();
+      void finishPipeline();
+
+    private:
+      class ChainTask : public WorkerPool::Task {
+        public:
+          ChainTask(PipelineRouter* router) : router_(router) { }
+          void runTask(int index) override;
+
+        private:
+          PipelineRouter* router_;
+      };
+
+      void latchInputs(int samples);
+      void writeDelayLines(int samples);
+      void readDelayLines(int samples);
+
+      std::vector<Output*> latches_;
+      std::vector<const Output*> chain_outputs_;
+
+      WorkerPool* workers_;
+      ChainTask chain_task_;
+      int block_size_;
+      int last_block_size_;
+      int chain_size_;
+
+      int latency_;
+      int delay_size_;
+      int write_position_;
+      int read_position_;
+      std::vector<mopo_float> delay_lines_;
+  };
+} // namespace mopo
+
+#endif // PIPELINE_ROUTER_H
@@ -17,6 +17,7 @@
 #include "processor.h"
 
 #include "feedback.h"
+#include "graph_edit.h"
 #include "processor_router.h"
 
 namespace mopo {
@@ -28,7 +29,7 @@ namespace mopo {
       samples_to_process_(DEFAULT_BUFFER_SIZE),
       control_rate_(control_rate), enabled_(new bool(true)),
       inputs_(new std::vector<Input*>()), outputs_(new std::vector<Output*>()),
-      router_(0) {
+      router_(0), shared_inputs_(nullptr), shared_outputs_(nullptr) {
         
     setControlRate(control_rate);
     for (int i = 0; i < num_inputs; ++i)
@@ -38,6 +39,23 @@ namespace mopo {
       addOutput();
   }
 
+  Processor::~Processor() {
+    if (!isIsolated())
+      return;
+
+    for (Input* input : isolated_inputs_)
+      delete input;
+
+    // Some processors point their output at another buffer so restore ours.
+    for (size_t i = 0; i < isolated_outputs_.size(); ++i) {
+      isolated_outputs_[i]->buffer = isolated_buffers_[i];
+      delete isolated_outputs_[i];
+    }
+
+    delete inputs_;
+    delete outputs_;
+  }
+
   void Processor::destroy() {
     for (Input* input : owned_inputs_)
       delete input;
@@ -117,9 +135,29 @@ namespace mopo {
     return count;
   }
 
+  void Processor::collectSources(std::vector<const Output*>* sources,
+                                 const GraphEdit* edit) const {
+    if (edit) {
+      edit->collectSources(this, sources);
+      return;
+    }
+
+    for (const Input* input : *inputs_) {
+      if (input)
+        sources->push_back(input->source);
+    }
+  }
+
+  void Processor::prepareIsolatedInputs(GraphEdit* edit, const output_remap& outputs) {
+    edit->stageIsolatedInputs(this, outputs);
+  }
+
   void Processor::unplugIndex(unsigned int input_index) {
     if (inputs_->at(input_index))
       inputs_->at(input_index)->source = &Processor::null_source_;
+
+    if (router_)
+      router_->connectionsChanged();
   }
 
   void Processor::unplug(const Output* source) {
@@ -159,10 +197,14 @@ namespace mopo {
 
     if (router_ && input->source != &Processor::null_source_)
       router_->connect(this, input->source, inputs_->size() - 1);
+    else if (router_)
+      router_->connectionsChanged();
   }
 
   Output* Processor::registerOutput(Output* output) {
     outputs_->push_back(output);
+    if (router_)
+      router_->connectionsChanged();
     return output;
   }
 
@@ -174,6 +216,8 @@ namespace mopo {
 
     if (router_ && input->source != &Processor::null_source_)
       router_->connect(this, input->source, index);
+    else if (router_)
+      router_->connectionsChanged();
   }
 
   Output* Processor::registerOutput(Output* output, int index) {
@@ -181,6 +225,8 @@ namespace mopo {
       outputs_->push_back(0);
 
     outputs_->at(index) = output;
+    if (router_)
+      router_->connectionsChanged();
     return output;
   }
 
@@ -208,4 +254,57 @@ namespace mopo {
     registerInput(input);
     return input;
   }
+
+  void Processor::isolateOutputs(output_remap& outputs) {
+    if (!isIsolated()) {
+      shared_inputs_ = inputs_;
+      shared_outputs_ = outputs_;
+      inputs_ = new std::vector<Input*>();
+      outputs_ = new std::vector<Output*>();
+    }
+
+    for (size_t i = isolated_outputs_.size(); i < owned_outputs_.size(); ++i) {
+      const Output* original = owned_outputs_[i];
+      Output* output = new Output(original->buffer_size);
+      output->owner = this;
+      memcpy(output->buffer, original->buffer, original->buffer_size * sizeof(mopo_float));
+      isolated_outputs_.push_back(output);
+      isolated_buffers_.push_back(output->buffer);
+    }
+
+    for (size_t i = 0; i < owned_outputs_.size(); ++i)
+      outputs[owned_outputs_[i]] = isolated_outputs_[i];
+  }
+
+  void Processor::isolateInputs(const output_remap& outputs) {
+    MOPO_ASSERT(isIsolated());
+
+    size_t num_inputs = shared_inputs_->size();
+    while (isolated_inputs_.size() < num_inputs)
+      isolated_inputs_.push_back(new Input());
+
+    inputs_->assign(num_inputs, nullptr);
+    for (size_t i = 0; i < num_inputs; ++i) {
+      const Input* shared = shared_inputs_->at(i);
+      if (shared == nullptr)
+        continue;
+
+      auto mapped = outputs.find(shared->source);
+      if (mapped == outputs.end())
+        isolated_inputs_[i]->source = shared->source;
+      else
+        isolated_inputs_[i]->source = mapped->second;
+      inputs_->at(i) = isolated_inputs_[i];
+    }
+
+    size_t num_outputs = shared_outputs_->size();
+    outputs_->assign(num_outputs, nullptr);
+    for (size_t i = 0; i < num_outputs; ++i) {
+      auto mapped = outputs.find(shared_outputs_->at(i));
+      if (mapped == outputs.end())
+        outputs_->at(i) = shared_outputs_->at(i);
+      else
+        outputs_->at(i) = mapped->second;
+    }
+  }
 } // namespace mopo
@@ -19,35 +19,53 @@
 #define PROCESSOR_H
 
 #include "common.h"
+#include "processor_arena.h"
 
 #include <cstring>
+#include <map>
 #include <vector>
 
 namespace mopo {
 
+  class GraphEdit;
   class Processor;
   class ProcessorRouter;
+  struct Output;
+  struct PlanStep;
+
+  typedef std::map<const Output*, Output*> output_remap;
 
   // An output port from the Processor.
   struct Output {
     Output(int size = MAX_BUFFER_SIZE) {
       owner = 0;
-      buffer = new mopo_float[size];
+      buffer = ProcessorArena::allocateBuffer(size);
       buffer_size = size;
+      version = 0;
+      pooled = false;
       clearBuffer();
       clearTrigger();
     }
 
     virtual ~Output() {
-      delete[] buffer;
+      ProcessorArena::freeBuffer(buffer);
     }
 
+    static void* operator new(size_t bytes) { return ProcessorArena::allocateObject(bytes); }
+    static void operator delete(void* output) { ProcessorArena::freeObject(output); }
+
     void trigger(mopo_float value, int offset = 0) {
       triggered = true;
       trigger_offset = offset;
       trigger_value = value;
     }
 
+    // Anything writing buffer[0] outside of a compiled plan calls this when
+    // the value changes so control rate readers know to recompute.
+    void markChanged() {
+      version++;
+    }
+
     void clearTrigger() {
       triggered = false;
       trigger_offset = 0;
@@ -67,6 +85,13 @@ namespace mopo {
     bool triggered;
     int trigger_offset;
     mopo_float trigger_value;
+
+    // Changes whenever buffer[0] does if the owner versions its outputs.
+    unsigned int version;
+
+    // Set while buffer belongs to a BufferPool. Other Outputs write to it in
+    // between runs so the owner can't count on last block still being there.
+    bool pooled;
   };
 
   // An input port to the Processor. You can plug an Output into one of
@@ -74,6 +99,9 @@ namespace mopo {
   struct Input {
     Input() { source = 0; }
 
+    static void* operator new(size_t bytes) { return ProcessorArena::allocateObject(bytes); }
+    static void operator delete(void* input) { ProcessorArena::freeObject(input); }
+
     const Output* source;
 
     inline mopo_float at(int i) const { return source->buffer[i]; }
@@ -92,7 +120,16 @@ namespace mopo {
     public:
       Processor(int num_inputs, int num_outputs, bool control_rate = false);
 
-      virtual ~Processor() { }
+      virtual ~Processor();
+
+      // Clones made inside a ProcessorArena::Scope are placed in that arena.
+      static void* operator new(size_t bytes) {
+        return ProcessorArena::allocateObject(bytes);
+      }
+
+      static void operator delete(void* processor) {
+        ProcessorArena::freeObject(processor);
+      }
 
       // Currently need to override this boiler plate clone.
       // TODO(mtytel): Should probably make a macro for this.
@@ -104,6 +141,44 @@ namespace mopo {
       // Subclasses override this for main processing code.
       virtual void process() = 0;
 
+      // Simple control rate processors can describe themselves as a single
+      // step of a compiled ProcessorRouter. Returns false if they can't.
+      virtual bool compile(PlanStep* step) const { return false; }
+
+      // Outputs of processors returning true here get a new version every
+      // time buffer[0] changes so control rate readers can skip work while
+      // nothing they read has changed.
+      virtual bool versionsOutputs() const { return control_rate_; }
+
+      // Control rate processors whose outputs only depend on the current
+      // values of their inputs return true so they can be skipped too.
+      virtual bool isStateless() const { return false; }
+
+      // Processors that write every sample of their outputs each time they
+      // run return true so their buffers can come from a BufferPool.
+      virtual bool rewritesOutputs() const { return false; }
+
+      // Processors that point their outputs at their inputs' buffers return
+      // true so those buffers are never pooled.
+      virtual bool aliasesInputs() const { return false; }
+
+      // Adds every Output read while this runs to _sources_, as it will be
+      // once _edit_ is committed if there is one.
+      virtual void collectSources(std::vector<const Output*>* sources,
+                                  const GraphEdit* edit = nullptr) const;
+
+      // Routers hand every copy of themselves to _edit_ so it can build
+      // their replacement state. Plain processors have nothing to add.
+      virtual void prepareEdit(GraphEdit* edit) { }
+
+      // Isolated copies stage the private inputs they'll have once _edit_ is
+      // committed. Routers do the same for everything they'll hold by then.
+      virtual void prepareIsolatedInputs(GraphEdit* edit, const output_remap& outputs);
+
+      // Routers bring their copies of processors and their plans up to date.
+      // Call off the audio thread after changing connections directly.
+      virtual void compilePlans() { }
+
       // Subclasses should override this if they need to adjust for change in
       // sample rate.
       virtual void setSampleRate(int sample_rate) {
@@ -211,6 +286,13 @@ namespace mopo {
         return outputs_->operator[](index);
       }
 
+      // Gives a clone its own Output buffers and Input ports so it can run
+      // at the same time as other clones of the same original. The first
+      // pass maps original outputs to private ones, the second relinks.
+      virtual void isolateOutputs(output_remap& outputs);
+      virtual void isolateInputs(const output_remap& outputs);
+      bool isIsolated() const { return shared_inputs_ != nullptr; }
+
     protected:
       Output* addOutput();
       Input* addInput();
@@ -229,7 +311,16 @@ namespace mopo {
 
       ProcessorRouter* router_;
 
+      std::vector<Input*>* shared_inputs_;
+      std::vector<Output*>* shared_outputs_;
+      std::vector<Input*> isolated_inputs_;
+      std::vector<Output*> isolated_outputs_;
+      std::vector<mopo_float*> isolated_buffers_;
+
       static const Output null_source_;
+
+      friend class BufferPool;
+      friend class GraphEdit;
   };
 } // namespace mopo
 
@@ -0,0 +1,121 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * mopo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mopo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mopo.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "processor_arena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+namespace mopo {
+
+  namespace {
+    // Every object and buffer is preceded by the heap allocation it came
+    // from, or nullptr if it's in an arena. Keeps objects 16 byte aligned.
+    const size_t HEADER_SIZE = 16;
+    const size_t OBJECT_ALIGNMENT = 16;
+    const size_t MIN_BLOCK_SIZE = 64 * 1024;
+
+    inline char* alignAfterHeader(char* position, size_t alignment, size_t header) {
+      uintptr_t start = reinterpret_cast<uintptr_t>(position) + header;
+      start = (start + alignment - 1) & ~(alignment - 1);
+      return reinterpret_cast<char*>(start - header);
+    }
+
+    inline void*& heapBase(void* object) {
+      return *reinterpret_cast<void**>(static_cast<char*>(object) - HEADER_SIZE);
+    }
+  } // namespace
+
+  thread_local ProcessorArena* ProcessorArena::current_ = nullptr;
+
+  ProcessorArena::ProcessorArena(size_t reserve) :
+      position_(nullptr), end_(nullptr), used_(0) {
+    if (reserve)
+      addBlock(reserve);
+  }
+
+  ProcessorArena::~ProcessorArena() {
+    for (char* block : blocks_)
+      delete[] block;
+  }
+
+  void* ProcessorArena::allocate(size_t bytes, size_t alignment, size_t header) {
+    char* start = alignAfterHeader(position_, alignment, header);
+    if (position_ == nullptr || start + bytes > end_) {
+      // Grow geometrically so a big graph spans only a few blocks.
+      size_t block_size = std::max(bytes + header + alignment, MIN_BLOCK_SIZE);
+      addBlock(std::max(block_size, used_));
+      start = alignAfterHeader(position_, alignment, header);
+    }
+
+    used_ += (start + bytes) - position_;
+    position_ = start + bytes;
+    return start;
+  }
+
+  void ProcessorArena::alignToCacheLine() {
+    allocate(0, CACHE_LINE_SIZE);
+  }
+
+  void ProcessorArena::addBlock(size_t bytes) {
+    char* block = new char[bytes + CACHE_LINE_SIZE];
+    blocks_.push_back(block);
+    position_ = alignAfterHeader(block, CACHE_LINE_SIZE, 0);
+    end_ = position_ + bytes;
+  }
+
+  void* ProcessorArena::allocateObject(size_t bytes) {
+    char* object = nullptr;
+    if (current_) {
+      object = static_cast<char*>(current_->allocate(bytes + HEADER_SIZE, OBJECT_ALIGNMENT,
+                                                     HEADER_SIZE)) + HEADER_SIZE;
+      heapBase(object) = nullptr;
+    }
+    else {
+      char* base = static_cast<char*>(::operator new(bytes + HEADER_SIZE));
+      object = base + HEADER_SIZE;
+      heapBase(object) = base;
+    }
+    return object;
+  }
+
+  void ProcessorArena::freeObject(void* object) {
+    if (object)
+      ::operator delete(heapBase(object));
+  }
+
+  mopo_float* ProcessorArena::allocateBuffer(int size) {
+    size_t bytes = size * sizeof(mopo_float);
+    char* buffer = nullptr;
+    if (current_) {
+      buffer = static_cast<char*>(current_->allocate(bytes + HEADER_SIZE, CACHE_LINE_SIZE,
+                                                     HEADER_SIZE)) + HEADER_SIZE;
+      heapBase(buffer) = nullptr;
+    }
+    else {
+      char* base = static_cast<char*>(::operator new(bytes + HEADER_SIZE + CACHE_LINE_SIZE));
+      buffer = alignAfterHeader(base, CACHE_LINE_SIZE, HEADER_SIZE) + HEADER_SIZE;
+      heapBase(buffer) = base;
+    }
+    return reinterpret_cast<mopo_float*>(buffer);
+  }
+
+  void ProcessorArena::freeBuffer(mopo_float* buffer) {
+    if (buffer)
+      ::operator delete(heapBase(buffer));
+  }
+} // namespace mopo
@@ -0,0 +1,84 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * mopo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mopo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mopo.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef PROCESSOR_ARENA_H
+#define PROCESSOR_ARENA_H
+
+#include "common.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace mopo {
+
+  const size_t CACHE_LINE_SIZE = 64;
+
+  // Hands out memory for Processors, their ports and Output buffers in the
+  // order they're created so a graph cloned inside a Scope sits in one
+  // contiguous block instead of thousands of separate allocations.
+  //
+  // Nothing allocated here is freed on its own. Deleting those objects only
+  // runs their destructors and the memory goes back all at once when the
+  // arena is deleted, so the arena has to outlive everything put in it.
+  class ProcessorArena {
+    public:
+      // Makes _arena_ the place Processors, ports and buffers created on
+      // this thread go until the Scope ends.
+      class Scope {
+        public:
+          Scope(ProcessorArena* arena) : previous_(current_) { current_ = arena; }
+          ~Scope() { current_ = previous_; }
+
+        private:
+          ProcessorArena* previous_;
+      };
+
+      ProcessorArena(size_t reserve = 0);
+      ~ProcessorArena();
+
+      // Returns _bytes_ bytes where the first byte after _header_ bytes is
+      // aligned to _alignment_.
+      void* allocate(size_t bytes, size_t alignment, size_t header = 0);
+
+      // Starts whatever is allocated next on a new cache line.
+      void alignToCacheLine();
+
+      size_t getUsed() const { return used_; }
+      int getNumBlocks() const { return blocks_.size(); }
+
+      static ProcessorArena* getCurrent() { return current_; }
+
+      // Used by Processor, Input and Output. These go to the current arena
+      // if there is one and to the heap otherwise.
+      static void* allocateObject(size_t bytes);
+      static void freeObject(void* object);
+      static mopo_float* allocateBuffer(int size);
+      static void freeBuffer(mopo_float* buffer);
+
+    protected:
+      void addBlock(size_t bytes);
+
+      std::vector<char*> blocks_;
+      char* position_;
+      char* end_;
+      size_t used_;
+
+      static thread_local ProcessorArena* current_;
+  };
+} // namespace mopo
+
+#endif // PROCESSOR_ARENA_H
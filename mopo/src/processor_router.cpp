@@ -17,6 +17,7 @@
 #include "processor_router.h"
 
 #include "feedback.h"
+#include "graph_edit.h"
 
 #include <algorithm>
 #include <vector>
@@ -27,14 +28,26 @@ namespace mopo {
       Processor(num_inputs, num_outputs),
       global_order_(new std::vector<const Processor*>()),
       global_feedback_order_(new std::vector<const Feedback*>()),
-      global_changes_(new int(0)), local_changes_(0) {
+      global_changes_(new int(0)), local_changes_(0), arena_(nullptr) {
+#if MOPO_PROFILE
+    profiler_ = nullptr;
+    profile_target_ = nullptr;
+    profile_key_ = -1;
+#endif
   }
 
   ProcessorRouter::ProcessorRouter(const ProcessorRouter& original) :
       Processor(original), global_order_(original.global_order_),
       global_feedback_order_(original.global_feedback_order_),
       global_changes_(original.global_changes_),
-      local_changes_(original.local_changes_) {
+      local_changes_(original.local_changes_),
+      arena_(ProcessorArena::getCurrent()) {
+#if MOPO_PROFILE
+    profiler_ = nullptr;
+    profile_target_ = original.profile_target_;
+    profile_name_ = original.profile_name_;
+    profile_key_ = original.profile_key_;
+#endif
     local_order_.assign(global_order_->size(), 0);
     local_feedback_order_.assign(global_feedback_order_->size(), 0);
 
@@ -68,29 +81,93 @@ namespace mopo {
   }
 
   void ProcessorRouter::process() {
-    updateAllProcessors();
+#if MOPO_PROFILE
+    ProfileScope scope(profile_target_, profile_key_, true);
+#endif
+    startProcess();
+    plan_.run();
+    finishProcess();
+  }
+
+  void ProcessorRouter::processBefore(const Processor* processor) {
+#if MOPO_PROFILE
+    ProfileScope scope(profile_target_, profile_key_, true);
+#endif
+    startProcess();
+    int step = plan_.findStep(getLocalProcessor(processor));
+    MOPO_ASSERT(step >= 0);
+    plan_.run(0, step);
+  }
+
+  void ProcessorRouter::processAfter(const Processor* processor) {
+#if MOPO_PROFILE
+    ProfileScope scope(profile_target_, profile_key_, true);
+#endif
+    int step = plan_.findStep(getLocalProcessor(processor));
+    MOPO_ASSERT(step >= 0);
+    plan_.run(step + 1, plan_.numSteps());
+    finishProcess();
+  }
+
+  Processor* ProcessorRouter::getLocalProcessor(const Processor* processor) {
+    auto local = processors_.find(processor);
+    return local == processors_.end() ? nullptr : local->second;
+  }
+
+  void ProcessorRouter::startProcess() {
+    // Plans are compiled by compilePlans() or a GraphEdit. A router that
+    // missed both still has to run the graph it has now, so it catches up
+    // here even though that allocates.
+    MOPO_ASSERT(local_changes_ == *global_changes_);
+    MOPO_ASSERT(plan_.isCompiled(*global_changes_));
+    if (local_changes_ != *global_changes_ || !plan_.isCompiled(*global_changes_)) {
+      updateAllProcessors();
+      plan_.compile(local_order_, *global_changes_);
+#if MOPO_PROFILE
+      plan_.profile(profile_target_);
+#endif
+    }
 
     // First make sure all the Feedback loops are ready to be read.
     int num_feedbacks = local_feedback_order_.size();
     for (int i = 0; i < num_feedbacks; ++i)
       local_feedback_order_[i]->refreshOutput();
+  }
 
-    // Run all the main processors.
-    int num_processors = local_order_.size();
-    for (int i = 0; i < num_processors; ++i) {
-      if (local_order_[i]->enabled())
-        local_order_[i]->process();
-    }
-
+  void ProcessorRouter::finishProcess() {
     // Store the outputs into the Feedback objects for next time.
+    int num_feedbacks = local_feedback_order_.size();
     for (int i = 0; i < num_feedbacks; ++i) {
       if (global_feedback_order_->at(i)->enabled())
         local_feedback_order_[i]->process();
     }
 
-    MOPO_ASSERT(num_processors != 0);
+    MOPO_ASSERT(local_order_.size() != 0);
+  }
+
+  void ProcessorRouter::connectionsChanged() {
+    (*global_changes_)++;
+    local_changes_++;
   }
 
+  void ProcessorRouter::setProfileName(const std::string& name) {
+#if MOPO_PROFILE
+    profile_name_ = name;
+#else
+    UNUSED(name);
+#endif
+  }
+
+#if MOPO_PROFILE
+  Profiler* ProcessorRouter::getProfiler() const {
+    for (const ProcessorRouter* router = this; router; router = router->router()) {
+      if (router->profiler_)
+        return router->profiler_;
+    }
+    return nullptr;
+  }
+#endif
+
   void ProcessorRouter::destroy() {
     for (Processor* processor : local_order_)
       processor->destroy();
@@ -112,6 +189,9 @@ namespace mopo {
     int num_feedbacks = local_feedback_order_.size();
     for (int i = 0; i < num_feedbacks; ++i)
       local_feedback_order_[i]->setSampleRate(sample_rate);
+
+    // Stateless steps may depend on the sample rate so run them all again.
+    plan_.markStale();
   }
 
   void ProcessorRouter::setBufferSize(int buffer_size) {
@@ -127,6 +207,68 @@ namespace mopo {
       local_feedback_order_[i]->setBufferSize(buffer_size);
   }
 
+  void ProcessorRouter::isolateOutputs(output_remap& outputs) {
+    Processor::isolateOutputs(outputs);
+    updateAllProcessors();
+
+    for (Processor* processor : local_order_)
+      processor->isolateOutputs(outputs);
+    for (Feedback* feedback : local_feedback_order_)
+      feedback->isolateOutputs(outputs);
+  }
+
+  void ProcessorRouter::collectSources(std::vector<const Output*>* sources,
+                                       const GraphEdit* edit) const {
+    Processor::collectSources(sources, edit);
+
+    const std::vector<Processor*>& order = edit ? edit->localOrder(this) : local_order_;
+    const std::vector<Feedback*>& feedbacks =
+        edit ? edit->localFeedbackOrder(this) : local_feedback_order_;
+    for (const Processor* processor : order)
+      processor->collectSources(sources, edit);
+    for (const Feedback* feedback : feedbacks)
+      feedback->collectSources(sources, edit);
+  }
+
+  void ProcessorRouter::isolateInputs(const output_remap& outputs) {
+    Processor::isolateInputs(outputs);
+    plan_.invalidate();
+
+    for (Processor* processor : local_order_)
+      processor->isolateInputs(outputs);
+    for (Feedback* feedback : local_feedback_order_)
+      feedback->isolateInputs(outputs);
+  }
+
+  void ProcessorRouter::prepareEdit(GraphEdit* edit) {
+    edit->prepareRouter(this);
+
+    for (Processor* processor : local_order_)
+      processor->prepareEdit(edit);
+  }
+
+  void ProcessorRouter::prepareIsolatedInputs(GraphEdit* edit,
+                                              const output_remap& outputs) {
+    edit->prepareIsolatedRouter(this, outputs);
+  }
+
+  void ProcessorRouter::compilePlans() {
+    updateAllProcessors();
+    if (!plan_.isCompiled(*global_changes_))
+      plan_.compile(local_order_, *global_changes_);
+
+#if MOPO_PROFILE
+    profile_target_ = getProfiler();
+    profile_key_ = -1;
+    if (profile_target_ && !profile_name_.empty())
+      profile_key_ = profile_target_->getModuleKey(profile_name_);
+    plan_.profile(profile_target_);
+#endif
+
+    for (Processor* processor : local_order_)
+      processor->compilePlans();
+  }
+
   void ProcessorRouter::addProcessor(Processor* processor) {
     MOPO_ASSERT(processor->router() == 0 || processor->router() == this);
     (*global_changes_)++;
@@ -187,6 +329,7 @@ namespace mopo {
 
   void ProcessorRouter::disconnect(const Processor* destination,
                                    const Output* source) {
+    connectionsChanged();
     if (isDownstream(destination, source->owner)) {
       // We're fine unless there is a cycle and need to delete a Feedback node.
       for (int i = 0; i < destination->numInputs(); ++i) {
@@ -285,6 +428,7 @@ namespace mopo {
   }
 
   void ProcessorRouter::addFeedback(Feedback* feedback) {
+    connectionsChanged();
     feedback->router(this);
     global_feedback_order_->push_back(feedback);
     local_feedback_order_.push_back(feedback);
@@ -292,6 +436,7 @@ namespace mopo {
   }
 
   void ProcessorRouter::removeFeedback(Feedback* feedback) {
+    connectionsChanged();
     std::vector<const Feedback*>::iterator pos =
         std::find(global_feedback_order_->begin(),
                   global_feedback_order_->end(), feedback);
@@ -311,6 +456,10 @@ namespace mopo {
     if (local_changes_ == *global_changes_)
       return;
 
+    ProcessorArena::Scope scope(arena_);
+    if (arena_)
+      arena_->alignToCacheLine();
+
     local_order_.assign(global_order_->size(), 0);
     local_feedback_order_.assign(global_feedback_order_->size(), 0);
 
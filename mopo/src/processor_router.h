@@ -18,11 +18,14 @@
 #ifndef PROCESSOR_ROUTER_H
 #define PROCESSOR_ROUTER_H
 
+#include "execution_plan.h"
 #include "feedback.h"
 #include "processor.h"
+#include "profiler.h"
 
 #include <map>
 #include <set>
+#include <string>
 #include <vector>
 
 namespace mopo {
@@ -40,9 +43,24 @@ namespace mopo {
 
       virtual void destroy() override;
       virtual void process() override;
+
+      // Splits process() around _processor_ so the copies of it in several
+      // clones of this router can run together in between. _processor_ is
+      // the original the local copies were cloned from.
+      void processBefore(const Processor* processor);
+      void processAfter(const Processor* processor);
+      Processor* getLocalProcessor(const Processor* processor);
       virtual void setSampleRate(int sample_rate) override;
       virtual void setBufferSize(int buffer_size) override;
 
+      virtual void isolateOutputs(output_remap& outputs) override;
+      virtual void isolateInputs(const output_remap& outputs) override;
+      virtual void collectSources(std::vector<const Output*>* sources,
+                                  const GraphEdit* edit = nullptr) const override;
+      virtual void prepareEdit(GraphEdit* edit) override;
+      virtual void prepareIsolatedInputs(GraphEdit* edit, const output_remap& outputs) override;
+      virtual void compilePlans() override;
+
       virtual void addProcessor(Processor* processor);
       virtual void addIdleProcessor(Processor* processor);
       virtual void removeProcessor(const Processor* processor);
@@ -52,6 +70,11 @@ namespace mopo {
       void connect(Processor* destination, const Output* source, int index);
       void disconnect(const Processor* destination, const Output* source);
       bool isDownstream(const Processor* first, const Processor* second) const;
+
+      // Processors call this when their inputs or outputs change so every
+      // copy of this router knows its plan is out of date.
+      void connectionsChanged();
+
       bool areOrdered(const Processor* first, const Processor* second) const;
 
       virtual bool isPolyphonic(const Processor* processor) const;
@@ -59,6 +82,15 @@ namespace mopo {
       virtual ProcessorRouter* getMonoRouter();
       virtual ProcessorRouter* getPolyRouter();
 
+      // Profiling builds report everything this runs under _name_ to the
+      // profiler of the closest router above it that has one. Keys are
+      // looked up when plans compile.
+      void setProfileName(const std::string& name);
+#if MOPO_PROFILE
+      void setProfiler(Profiler* profiler) { profiler_ = profiler; }
+      Profiler* getProfiler() const;
+#endif
+
     protected:
       // When we create a cycle into the ProcessorRouter graph, we must insert
       // a Feedback node and add it here.
@@ -72,6 +104,9 @@ namespace mopo {
       // Ensures we have all copies of all processors and feedback processors.
       virtual void updateAllProcessors();
 
+      void startProcess();
+      void finishProcess();
+
       // Returns the ancestor of _processor_ which is a child of _this_.
       // Returns null if _processor_ is not a descendant of _this_.
       const Processor* getContext(const Processor* processor) const;
@@ -89,6 +124,24 @@ namespace mopo {
 
       int* global_changes_;
       int local_changes_;
+
+      // Where copies of processors are placed, if this router was cloned
+      // into a ProcessorArena.
+      ProcessorArena* arena_;
+
+      // Flattened local_order_. Recompiled by compilePlans() or swapped in by
+      // GraphEdit::commit() whenever connections change.
+      ExecutionPlan plan_;
+
+#if MOPO_PROFILE
+      Profiler* profiler_;
+      Profiler* profile_target_;
+      std::string profile_name_;
+      int profile_key_;
+#endif
+
+      friend class BufferPool;
+      friend class GraphEdit;
   };
 } // namespace mopo
 
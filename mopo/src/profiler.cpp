@@ -0,0 +1,150 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * mopo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mopo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mopo.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "profiler.h"
+
+#if MOPO_PROFILE
+
+#include "processor.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <typeinfo>
+
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
+
+namespace mopo {
+
+  namespace {
+    std::string getTypeName(const Processor* processor) {
+      const char* name = typeid(*processor).name();
+#ifdef __GNUG__
+      int status = 0;
+      char* demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+      if (status == 0 && demangled) {
+        std::string result = demangled;
+        free(demangled);
+        return result;
+      }
+#endif
+      return name;
+    }
+  } // namespace
+
+  thread_local unsigned long long ProfileScope::children_ = 0;
+
+  Profiler::Profiler() : blocks_written_(0), blocks_read_(0), num_keys_(0) {
+    for (int i = 0; i < MAX_KEYS; ++i) {
+      cycles_[i] = 0;
+      calls_[i] = 0;
+      modules_[i] = false;
+    }
+
+    getKey("inline operators", false);
+  }
+
+  int Profiler::getTypeKey(const Processor* processor) {
+    return getKey(getTypeName(processor), false);
+  }
+
+  int Profiler::getModuleKey(const std::string& name) {
+    return getKey(name, true);
+  }
+
+  int Profiler::getKey(const std::string& name, bool module) {
+    std::lock_guard<std::mutex> lock(key_mutex_);
+
+    int num_keys = num_keys_.load();
+    for (int i = 0; i < num_keys; ++i) {
+      if (names_[i] == name && modules_[i] == module)
+        return i;
+    }
+
+    // Out of keys so this one won't be recorded.
+    if (num_keys == MAX_KEYS)
+      return -1;
+
+    names_[num_keys] = name;
+    modules_[num_keys] = module;
+    num_keys_.store(num_keys + 1);
+    return num_keys;
+  }
+
+  void Profiler::endBlock() {
+    long long written = blocks_written_.load(std::memory_order_relaxed);
+    Block& block = blocks_[written % MAX_BLOCKS];
+
+    int num_keys = num_keys_.load();
+    for (int i = 0; i < num_keys; ++i) {
+      block.cycles[i] = cycles_[i].exchange(0, std::memory_order_relaxed);
+      block.calls[i] = calls_[i].exchange(0, std::memory_order_relaxed);
+    }
+    for (int i = num_keys; i < MAX_KEYS; ++i) {
+      block.cycles[i] = 0;
+      block.calls[i] = 0;
+    }
+
+    blocks_written_.store(written + 1, std::memory_order_release);
+  }
+
+  void Profiler::collect(std::vector<Stats>& stats) {
+    stats.clear();
+
+    long long written = blocks_written_.load(std::memory_order_acquire);
+    long long start = std::max(blocks_read_, written - MAX_BLOCKS + 1);
+    int num_keys = num_keys_.load();
+
+    std::vector<double> cycles(num_keys, 0.0);
+    std::vector<double> calls(num_keys, 0.0);
+    std::vector<Block> copies(std::max<long long>(written - start, 0));
+    for (long long b = start; b < written; ++b)
+      copies[b - start] = blocks_[b % MAX_BLOCKS];
+
+    // Skip any block the audio thread wrote over while we were copying.
+    long long written_after = blocks_written_.load(std::memory_order_acquire);
+    long long first_valid = std::max(start, written_after - MAX_BLOCKS + 1);
+    int num_blocks = std::max<long long>(written - first_valid, 0);
+
+    for (long long b = first_valid; b < written; ++b) {
+      const Block& block = copies[b - start];
+      for (int i = 0; i < num_keys; ++i) {
+        cycles[i] += block.cycles[i];
+        calls[i] += block.calls[i];
+      }
+    }
+    blocks_read_ = written;
+
+    if (num_blocks == 0)
+      return;
+
+    std::lock_guard<std::mutex> lock(key_mutex_);
+    for (int i = 0; i < num_keys; ++i) {
+      if (calls[i] == 0.0)
+        continue;
+
+      Stats stat;
+      stat.name = names_[i];
+      stat.module = modules_[i];
+      stat.cycles = cycles[i] / num_blocks;
+      stat.calls = calls[i] / num_blocks;
+      stats.push_back(stat);
+    }
+  }
+} // namespace mopo
+
+#endif // MOPO_PROFILE
@@ -0,0 +1,151 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * mopo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mopo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mopo.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "common.h"
+#include "cpu_features.h"
+
+// Build with MOPO_PROFILE=1 to time the graph. Otherwise none of this is
+// compiled into the processing code.
+#ifndef MOPO_PROFILE
+#define MOPO_PROFILE 0
+#endif
+
+#if MOPO_PROFILE
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if MOPO_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#else
+#include <chrono>
+#endif
+
+namespace mopo {
+
+  class Processor;
+
+  // Collects cycle counts for every processor type and every named router of
+  // one engine. The audio threads add into per key counters and the engine
+  // closes each block into a ring buffer that a reader can average without
+  // locking. Cycles come from the time stamp counter on x86 and are
+  // nanoseconds everywhere else.
+  class Profiler {
+    public:
+      static const int MAX_KEYS = 256;
+      static const int MAX_BLOCKS = 64;
+
+      // Time spent in plan steps that run inline instead of calling process().
+      static const int kInlineOperators = 0;
+
+      struct Stats {
+        std::string name;
+        bool module;
+        double cycles;
+        double calls;
+      };
+
+      Profiler();
+
+      static inline unsigned long long getCycles() {
+#if MOPO_X86
+        return __rdtsc();
+#else
+        return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+      }
+
+      // Keys are handed out when plans compile off the audio thread, never
+      // while they run.
+      int getTypeKey(const Processor* processor);
+      int getModuleKey(const std::string& name);
+
+      inline void record(int key, unsigned long long cycles) {
+        cycles_[key].fetch_add(cycles, std::memory_order_relaxed);
+        calls_[key].fetch_add(1, std::memory_order_relaxed);
+      }
+
+      // Called by the engine at the end of every block.
+      void endBlock();
+
+      // Averages per block over every block finished since the last call.
+      // Only one thread should read.
+      void collect(std::vector<Stats>& stats);
+
+    private:
+      struct Block {
+        unsigned long long cycles[MAX_KEYS];
+        unsigned int calls[MAX_KEYS];
+      };
+
+      int getKey(const std::string& name, bool module);
+
+      std::atomic<unsigned long long> cycles_[MAX_KEYS];
+      std::atomic<unsigned int> calls_[MAX_KEYS];
+
+      Block blocks_[MAX_BLOCKS];
+      std::atomic<long long> blocks_written_;
+      long long blocks_read_;
+
+      std::mutex key_mutex_;
+      std::atomic<int> num_keys_;
+      std::string names_[MAX_KEYS];
+      bool modules_[MAX_KEYS];
+  };
+
+  // Times the enclosing scope into _profiler_ if there is one. Nested scopes
+  // are taken out of the type totals so each processor type only counts its
+  // own work. Module scopes include everything they run.
+  class ProfileScope {
+    public:
+      ProfileScope(Profiler* profiler, int key, bool module = false) :
+          profiler_(profiler), key_(key), module_(module) {
+        parent_children_ = children_;
+        children_ = 0;
+        start_ = Profiler::getCycles();
+      }
+
+      ~ProfileScope() {
+        unsigned long long total = Profiler::getCycles() - start_;
+        if (profiler_ && key_ >= 0)
+          profiler_->record(key_, module_ ? total : total - children_);
+        children_ = parent_children_ + total;
+      }
+
+    private:
+      static thread_local unsigned long long children_;
+
+      Profiler* profiler_;
+      int key_;
+      bool module_;
+      unsigned long long start_;
+      unsigned long long parent_children_;
+  };
+} // namespace mopo
+
+#endif // MOPO_PROFILE
+
+#endif // PROFILER_H
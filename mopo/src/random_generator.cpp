@@ -0,0 +1,78 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * mopo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mopo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mopo.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "random_generator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+namespace mopo {
+
+  namespace {
+    uint32_t getClockSeed() {
+      auto now = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+      return static_cast<uint32_t>(now ^ (now >> 32));
+    }
+
+    // Spreads consecutive seeds out so neighboring generators don't start
+    // out correlated.
+    uint32_t mix(uint32_t value) {
+      value = (value ^ (value >> 16)) * 0x7feb352d;
+      value = (value ^ (value >> 15)) * 0x846ca68b;
+      return value ^ (value >> 16);
+    }
+
+    std::atomic<uint32_t> base_seed(getClockSeed());
+    std::atomic<uint32_t> num_seeded(0);
+  } // namespace
+
+  const int RandomGenerator::NUM_LANES;
+
+  void RandomGenerator::seedAll(uint32_t seed) {
+    base_seed = seed;
+    num_seeded = 0;
+  }
+
+  void RandomGenerator::seed() {
+    uint32_t index = num_seeded.fetch_add(1, std::memory_order_relaxed);
+    uint32_t seed = base_seed.load(std::memory_order_relaxed) + 0x9e3779b9 * (index + 1);
+
+    // xorshift gets stuck on zero.
+    state_ = std::max<uint32_t>(mix(seed), 1);
+    for (int l = 0; l < NUM_LANES; ++l)
+      lanes_[l] = std::max<uint32_t>(mix(next()), 1);
+  }
+
+  void RandomGenerator::fillBipolar(mopo_float* dest, int num, mopo_float scale) {
+    mopo_float mult = scale * (1.0 / 2147483648.0);
+    mopo_float values[NUM_LANES];
+
+    int i = 0;
+    while (i < num) {
+      VECTORIZE_LOOP
+      for (int l = 0; l < NUM_LANES; ++l) {
+        lanes_[l] = step(lanes_[l]);
+        values[l] = mult * static_cast<int32_t>(lanes_[l]);
+      }
+
+      int samples = std::min(NUM_LANES, num - i);
+      for (int l = 0; l < samples; ++l)
+        dest[i + l] = values[l];
+      i += samples;
+    }
+  }
+} // namespace mopo
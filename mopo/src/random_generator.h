@@ -0,0 +1,81 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * mopo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mopo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mopo.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef RANDOM_GENERATOR_H
+#define RANDOM_GENERATOR_H
+
+#include "common.h"
+
+#include <cstdint>
+
+namespace mopo {
+
+  // A small xorshift random number generator for the audio thread.
+  // Every generator, including every copy made when a voice is cloned, gets
+  // its own seed so nothing is shared between voices or synth instances.
+  class RandomGenerator {
+    public:
+      static const int NUM_LANES = 8;
+
+      RandomGenerator() { seed(); }
+      RandomGenerator(const RandomGenerator& other) { seed(); }
+      RandomGenerator& operator=(const RandomGenerator& other) { return *this; }
+
+      // Generators made after this are seeded in a fixed sequence starting
+      // from _seed_ so renders can be repeated.
+      static void seedAll(uint32_t seed);
+
+      uint32_t next() {
+        state_ = step(state_);
+        return state_;
+      }
+
+      // In [0, 1).
+      mopo_float nextUnipolar() {
+        return next() * (1.0 / 4294967296.0);
+      }
+
+      // In [-1, 1).
+      mopo_float nextBipolar() {
+        return static_cast<int32_t>(next()) * (1.0 / 2147483648.0);
+      }
+
+      // In [0, _max_).
+      int nextInt(int max) {
+        return (static_cast<uint64_t>(next()) * max) >> 32;
+      }
+
+      // Fills _dest_ with bipolar noise times _scale_. Runs several
+      // generators side by side so the loop vectorizes.
+      void fillBipolar(mopo_float* dest, int num, mopo_float scale);
+
+    private:
+      static inline uint32_t step(uint32_t value) {
+        value ^= value << 13;
+        value ^= value >> 17;
+        value ^= value << 5;
+        return value;
+      }
+
+      void seed();
+
+      uint32_t state_;
+      uint32_t lanes_[NUM_LANES];
+  };
+} // namespace mopo
+
+#endif // RANDOM_GENERATOR_H
@@ -16,14 +16,15 @@
 
 #include "reverb.h"
 
+#include "dsp_kernels.h"
 #include "operators.h"
-#include "reverb_all_pass.h"
-#include "reverb_comb.h"
+#include "reverb_bank.h"
 #include "reverb_tuning.h"
 
 namespace mopo {
 
-  Reverb::Reverb() : ProcessorRouter(kNumInputs, 2), current_dry_(0.0), current_wet_(0.0) {
+  Reverb::Reverb(std::shared_ptr<LazyMemory::Registry> effect_memory) :
+      ProcessorRouter(kNumInputs, 2), current_dry_(0.0), current_wet_(0.0) {
     static const Value gain(FIXED_GAIN);
     
     Bypass* audio_input = new Bypass();
@@ -46,103 +47,47 @@ namespace mopo {
     addProcessor(damping_clamp);
     addProcessor(damping_input);
 
-    VariableAdd* left_comb_total = new VariableAdd(NUM_COMB);
-    for (int i = 0; i < NUM_COMB; ++i) {
-      ReverbComb* comb = new ReverbComb(1 + mopo::MAX_SAMPLE_RATE * COMB_TUNINGS[i]);
-      Value* time = new cr::Value(COMB_TUNINGS[i]);
-      addIdleProcessor(time);
-      cr::TimeToSamples* samples = new cr::TimeToSamples();
-      samples->plug(time);
-
-      comb->plug(gained_input, ReverbComb::kAudio);
-      comb->plug(samples, ReverbComb::kSampleDelay);
-      comb->plug(feedback_input, ReverbComb::kFeedback);
-      comb->plug(damping_input, ReverbComb::kDamping);
-      left_comb_total->plugNext(comb);
-      addProcessor(samples);
-      addProcessor(comb);
-    }
-
-    VariableAdd* right_comb_total = new VariableAdd(NUM_COMB);
-    for (int i = 0; i < NUM_COMB; ++i) {
-      mopo_float tuning = COMB_TUNINGS[i] + STEREO_SPREAD;
-      ReverbComb* comb = new ReverbComb(1 + mopo::MAX_SAMPLE_RATE * tuning);
-      Value* time = new cr::Value(tuning);
-      addIdleProcessor(time);
-      cr::TimeToSamples* samples = new cr::TimeToSamples();
-      samples->plug(time);
-
-      comb->plug(gained_input, ReverbComb::kAudio);
-      comb->plug(samples, ReverbComb::kSampleDelay);
-      comb->plug(feedback_input, ReverbComb::kFeedback);
-      comb->plug(damping_input, ReverbComb::kDamping);
-      right_comb_total->plugNext(comb);
-      addProcessor(samples);
-      addProcessor(comb);
-    }
-
-    addProcessor(left_comb_total);
-    addProcessor(right_comb_total);
-
-    reverb_wet_left_ = left_comb_total;
-    for (int i = 0; i < NUM_ALL_PASS; ++i) {
-      ReverbAllPass* all_pass = new ReverbAllPass(1 + mopo::MAX_SAMPLE_RATE * ALL_PASS_TUNINGS[i]);
-      Value* time = new cr::Value(ALL_PASS_TUNINGS[i]);
-      addIdleProcessor(time);
-      cr::TimeToSamples* samples = new cr::TimeToSamples();
-      samples->plug(time);
-
-      all_pass->plug(reverb_wet_left_, ReverbAllPass::kAudio);
-      all_pass->plug(samples, ReverbAllPass::kSampleDelay);
-      all_pass->plug(&utils::value_half, ReverbAllPass::kFeedback);
-
-      addProcessor(all_pass);
-      addProcessor(samples);
-      reverb_wet_left_ = all_pass;
-    }
-
-    reverb_wet_right_ = right_comb_total;
-    for (int i = 0; i < NUM_ALL_PASS; ++i) {
-      mopo_float tuning = ALL_PASS_TUNINGS[i] + STEREO_SPREAD;
-      ReverbAllPass* all_pass = new ReverbAllPass(1 + mopo::MAX_SAMPLE_RATE * tuning);
-      Value* time = new cr::Value(tuning);
-      addIdleProcessor(time);
-      cr::TimeToSamples* samples = new cr::TimeToSamples();
-      samples->plug(time);
-
-      all_pass->plug(reverb_wet_right_, ReverbAllPass::kAudio);
-      all_pass->plug(samples, ReverbAllPass::kSampleDelay);
-      all_pass->plug(&utils::value_half, ReverbAllPass::kFeedback);
-
-      addProcessor(all_pass);
-      addProcessor(samples);
-      reverb_wet_right_ = all_pass;
-    }
+    reverb_bank_ = new ReverbBank(effect_memory);
+    reverb_bank_->plug(gained_input, ReverbBank::kAudio);
+    reverb_bank_->plug(feedback_input, ReverbBank::kFeedback);
+    reverb_bank_->plug(damping_input, ReverbBank::kDamping);
+    addProcessor(reverb_bank_);
   }
 
   void Reverb::process() {
     MOPO_ASSERT(inputMatchesBufferSize(kAudio));
 
-    ProcessorRouter::process();
     const mopo_float* audio = input(kAudio)->source->buffer;
-    const mopo_float* left_wet_audio = reverb_wet_left_->output()->buffer;
-    const mopo_float* right_wet_audio = reverb_wet_right_->output()->buffer;
     mopo_float* dest_left = output(0)->buffer;
     mopo_float* dest_right = output(1)->buffer;
 
     mopo_float wet_in = utils::clamp(input(kWet)->at(0), 0.0, 1.0);
     mopo_float next_wet = sqrt(wet_in);
     mopo_float next_dry = sqrt(1.0 - wet_in);
+
+    // The longest comb rings out slowest, then the all-passes smear it.
+    mopo_float comb_period = sample_rate_ * (COMB_TUNINGS[NUM_COMB - 1] + STEREO_SPREAD);
+    mopo_float all_pass_period = sample_rate_ * (ALL_PASS_TUNINGS[0] + STEREO_SPREAD);
+    mopo_float all_pass_tail = TailTracker::tailSamples(1.0, ALL_PASS_FEEDBACK, all_pass_period);
+    if (tail_.update(audio, buffer_size_, input(kFeedback)->at(0), comb_period, all_pass_tail)) {
+      reverb_bank_->rest();
+      current_dry_ = next_dry;
+      current_wet_ = next_wet;
+      utils::zeroBuffer(dest_left, buffer_size_);
+      utils::zeroBuffer(dest_right, buffer_size_);
+      return;
+    }
+
+    ProcessorRouter::process();
+    const mopo_float* left_wet_audio = reverb_bank_->output(0)->buffer;
+    const mopo_float* right_wet_audio = reverb_bank_->output(1)->buffer;
     mopo_float wet_inc = (next_wet - current_wet_) / buffer_size_;
     mopo_float dry_inc = (next_dry - current_dry_) / buffer_size_;
 
-    VECTORIZE_LOOP
-    for (int i = 0; i < buffer_size_; ++i) {
-      mopo_float dry = current_dry_ + i * dry_inc;
-      mopo_float wet = current_wet_ + i * wet_inc;
-      dest_left[i] = dry * audio[i] + wet * left_wet_audio[i];
-      dest_right[i] = dry * audio[i] + wet * right_wet_audio[i];
-    }
+    kernels::mix(dest_left, audio, left_wet_audio,
+                 current_dry_, dry_inc, current_wet_, wet_inc, buffer_size_);
+    kernels::mix(dest_right, audio, right_wet_audio,
+                 current_dry_, dry_inc, current_wet_, wet_inc, buffer_size_);
 
     current_dry_ = next_dry;
     current_wet_ = next_wet;
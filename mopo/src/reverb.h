@@ -18,10 +18,14 @@
 #ifndef REVERB_H
 #define REVERB_H
 
+#include "lazy_memory.h"
 #include "processor_router.h"
+#include "tail_tracker.h"
 
 namespace mopo {
 
+  class ReverbBank;
+
   // A comb filter with low pass filtering useful in a reverb processor.
   class Reverb : public ProcessorRouter {
     public:
@@ -34,16 +38,19 @@ namespace mopo {
         kNumInputs
       };
 
-      Reverb();
+      Reverb(std::shared_ptr<LazyMemory::Registry> effect_memory = nullptr);
       virtual ~Reverb() { }
 
       void process() override;
 
       virtual Processor* clone() const override { return new Reverb(*this); }
 
+      // True once the input is quiet and the combs have rung out.
+      bool isSilent() const { return tail_.isSilent(); }
+
     protected:
-      Processor* reverb_wet_left_;
-      Processor* reverb_wet_right_;
+      ReverbBank* reverb_bank_;
+      TailTracker tail_;
 
       mopo_float current_dry_;
       mopo_float current_wet_;
@@ -40,7 +40,20 @@ namespace mopo {
     const mopo_float* feedback_buffer = input(kFeedback)->source->buffer;
     int period = input(kSampleDelay)->at(0);
 
-    for (int i = 0; i < buffer_size_; ++i)
-      tick(i, dest, period, audio_buffer, feedback_buffer);
+    if (period + 1 < buffer_size_) {
+      for (int i = 0; i < buffer_size_; ++i)
+        tick(i, dest, period, audio_buffer, feedback_buffer);
+      return;
+    }
+
+    // The delay is longer than the block so read it all before writing.
+    mopo_float values[MAX_BUFFER_SIZE];
+    memory_->readBlock(dest, period, buffer_size_);
+    VECTORIZE_LOOP
+    for (int i = 0; i < buffer_size_; ++i) {
+      values[i] = audio_buffer[i] + dest[i] * feedback_buffer[i];
+      dest[i] -= audio_buffer[i];
+    }
+    memory_->pushBlock(values, buffer_size_);
   }
 } // namespace mopo
@@ -0,0 +1,171 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * mopo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mopo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mopo.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "reverb_bank.h"
+
+#include "utils.h"
+
+namespace mopo {
+
+  namespace {
+    // Rows of the delay lines start on cache line boundaries.
+    const int ALIGNMENT = 64 / sizeof(mopo_float);
+
+    inline int getPeriod(mopo_float sample_rate, mopo_float time) {
+      return sample_rate * time;
+    }
+  } // namespace
+
+  ReverbBank::ReverbBank(std::shared_ptr<LazyMemory::Registry> effect_memory) :
+      Processor(ReverbBank::kNumInputs, 2), lazy_memory_(effect_memory),
+      memory_(nullptr), comb_memory_(nullptr), all_pass_memory_(nullptr), offset_(0) {
+    computeSizes();
+  }
+
+  ReverbBank::ReverbBank(const ReverbBank& other) :
+      Processor(other), lazy_memory_(other.lazy_memory_),
+      memory_(nullptr), comb_memory_(nullptr), all_pass_memory_(nullptr), offset_(0) {
+    computeSizes();
+  }
+
+  ReverbBank::~ReverbBank() { }
+
+  void ReverbBank::setSampleRate(int sample_rate) {
+    Processor::setSampleRate(sample_rate);
+    unsigned int old_comb_size = comb_size_;
+    unsigned int old_all_pass_size = all_pass_size_;
+    computeSizes();
+
+    // Samples written with the old strides would come back as noise.
+    bool resized = comb_size_ != old_comb_size || all_pass_size_ != old_all_pass_size;
+    if (resized && memory_)
+      utils::zeroBuffer(memory_->getBuffer(), memory_->getSize());
+    setMemory(memory_);
+  }
+
+  void ReverbBank::computeSizes() {
+    mopo_float longest_comb = COMB_TUNINGS[NUM_COMB - 1] + STEREO_SPREAD;
+    mopo_float longest_all_pass = ALL_PASS_TUNINGS[0] + STEREO_SPREAD;
+    comb_size_ = utils::nextPowerOfTwo(1 + sample_rate_ * longest_comb);
+    all_pass_size_ = utils::nextPowerOfTwo(1 + sample_rate_ * longest_all_pass);
+    comb_bitmask_ = comb_size_ - 1;
+    all_pass_bitmask_ = all_pass_size_ - 1;
+
+    required_size_ = COMB_LANES * comb_size_ + 2 * NUM_ALL_PASS * all_pass_size_ + ALIGNMENT;
+    lazy_memory_.setSize(required_size_);
+  }
+
+  void ReverbBank::setMemory(Memory* memory) {
+    memory_ = memory;
+    offset_ = 0;
+    for (int i = 0; i < COMB_LANES; ++i)
+      filtered_samples_[i] = 0.0;
+
+    if (memory_ == nullptr)
+      return;
+
+    mopo_float* buffer = memory_->getBuffer();
+    size_t misalignment = reinterpret_cast<size_t>(buffer) % (ALIGNMENT * sizeof(mopo_float));
+    comb_memory_ = buffer + (ALIGNMENT - misalignment / sizeof(mopo_float)) % ALIGNMENT;
+    all_pass_memory_ = comb_memory_ + COMB_LANES * comb_size_;
+  }
+
+  void ReverbBank::computePeriods() {
+    for (int i = 0; i < NUM_COMB; ++i) {
+      comb_periods_[i] = getPeriod(sample_rate_, COMB_TUNINGS[i]);
+      comb_periods_[i + NUM_COMB] = getPeriod(sample_rate_, COMB_TUNINGS[i] + STEREO_SPREAD);
+    }
+
+    for (int i = 0; i < NUM_ALL_PASS; ++i) {
+      all_pass_periods_[i][0] = getPeriod(sample_rate_, ALL_PASS_TUNINGS[i]);
+      all_pass_periods_[i][1] = getPeriod(sample_rate_, ALL_PASS_TUNINGS[i] + STEREO_SPREAD);
+    }
+  }
+
+  void ReverbBank::process() {
+    MOPO_ASSERT(inputMatchesBufferSize(kAudio));
+    MOPO_ASSERT(inputMatchesBufferSize(kFeedback));
+    MOPO_ASSERT(inputMatchesBufferSize(kDamping));
+
+    const mopo_float* audio_buffer = input(kAudio)->source->buffer;
+    const mopo_float* feedback_buffer = input(kFeedback)->source->buffer;
+    const mopo_float* damping_buffer = input(kDamping)->source->buffer;
+    mopo_float* dest_left = output(0)->buffer;
+    mopo_float* dest_right = output(1)->buffer;
+
+    Memory* memory = lazy_memory_.get();
+    if (memory != memory_)
+      setMemory(memory);
+
+    // Stay silent until memory big enough for this sample rate is handed over.
+    if (memory_ == nullptr || memory_->getSize() < required_size_) {
+      utils::zeroBuffer(dest_left, buffer_size_);
+      utils::zeroBuffer(dest_right, buffer_size_);
+      return;
+    }
+
+    computePeriods();
+
+    mopo_float reads[COMB_LANES];
+    mopo_float filtered[COMB_LANES];
+    for (int c = 0; c < COMB_LANES; ++c)
+      filtered[c] = filtered_samples_[c];
+
+    for (int i = 0; i < buffer_size_; ++i) {
+      mopo_float audio = audio_buffer[i];
+      mopo_float feedback = feedback_buffer[i];
+      mopo_float damping = damping_buffer[i];
+      unsigned int write = (offset_ + 1) & comb_bitmask_;
+
+      for (int c = 0; c < COMB_LANES; ++c)
+        reads[c] = comb_memory_[((offset_ - comb_periods_[c]) & comb_bitmask_) * COMB_LANES + c];
+
+      mopo_float* comb_row = comb_memory_ + write * COMB_LANES;
+      VECTORIZE_LOOP
+      for (int c = 0; c < COMB_LANES; ++c) {
+        filtered[c] = utils::interpolate(reads[c], filtered[c], damping);
+        comb_row[c] = audio + filtered[c] * feedback;
+      }
+
+      // Sum in comb order like the VariableAdd this replaces.
+      mopo_float wet[2] = { 0.0, 0.0 };
+      for (int c = 0; c < NUM_COMB; ++c) {
+        wet[0] += reads[c];
+        wet[1] += reads[c + NUM_COMB];
+      }
+
+      unsigned int all_pass_write = (offset_ + 1) & all_pass_bitmask_;
+      for (int a = 0; a < NUM_ALL_PASS; ++a) {
+        mopo_float* all_pass = all_pass_memory_ + 2 * a * all_pass_size_;
+        mopo_float* all_pass_row = all_pass + 2 * all_pass_write;
+
+        for (int s = 0; s < 2; ++s) {
+          unsigned int spot = (offset_ - all_pass_periods_[a][s]) & all_pass_bitmask_;
+          mopo_float read = all_pass[2 * spot + s];
+          all_pass_row[s] = wet[s] + read * ALL_PASS_FEEDBACK;
+          wet[s] = read - wet[s];
+        }
+      }
+
+      dest_left[i] = wet[0];
+      dest_right[i] = wet[1];
+      offset_++;
+    }
+
+    for (int c = 0; c < COMB_LANES; ++c)
+      filtered_samples_[c] = filtered[c];
+  }
+} // namespace mopo
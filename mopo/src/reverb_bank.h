@@ -0,0 +1,79 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * mopo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mopo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mopo.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef REVERB_BANK_H
+#define REVERB_BANK_H
+
+#include "lazy_memory.h"
+#include "processor.h"
+#include "reverb_tuning.h"
+
+namespace mopo {
+
+  // All the comb and all-pass filters of a stereo reverb in one processor.
+  // The combs share their input and a write position, so their delay lines
+  // are interleaved into one block and every comb updates per sample side
+  // by side. The left and right all-pass chains run as a stereo pair.
+  class ReverbBank : public Processor {
+    public:
+      enum Inputs {
+        kAudio,
+        kFeedback,
+        kDamping,
+        kNumInputs
+      };
+
+      ReverbBank(std::shared_ptr<LazyMemory::Registry> effect_memory = nullptr);
+      ReverbBank(const ReverbBank& other);
+      virtual ~ReverbBank();
+
+      virtual Processor* clone() const override {
+        return new ReverbBank(*this);
+      }
+
+      virtual void process() override;
+      virtual void setSampleRate(int sample_rate) override;
+
+      // Called instead of process() while the reverb is silent.
+      void rest() { lazy_memory_.rest(); }
+
+    protected:
+      static const int COMB_LANES = 2 * NUM_COMB;
+
+      void computeSizes();
+      void computePeriods();
+      void setMemory(Memory* memory);
+
+      LazyMemory lazy_memory_;
+      Memory* memory_;
+      mopo_float* comb_memory_;
+      mopo_float* all_pass_memory_;
+
+      int required_size_;
+      unsigned int comb_size_;
+      unsigned int comb_bitmask_;
+      unsigned int all_pass_size_;
+      unsigned int all_pass_bitmask_;
+      unsigned int offset_;
+
+      int comb_periods_[COMB_LANES];
+      int all_pass_periods_[NUM_ALL_PASS][2];
+      mopo_float filtered_samples_[COMB_LANES];
+  };
+} // namespace mopo
+
+#endif // REVERB_BANK_H
@@ -43,7 +43,19 @@ namespace mopo {
     const mopo_float* feedback_buffer = input(kFeedback)->source->buffer;
     const mopo_float* damping_buffer = input(kDamping)->source->buffer;
 
-    for (int i = 0; i < buffer_size_; ++i)
-      tick(i, dest, period, audio_buffer, feedback_buffer, damping_buffer);
+    if (period + 1 < buffer_size_) {
+      for (int i = 0; i < buffer_size_; ++i)
+        tick(i, dest, period, audio_buffer, feedback_buffer, damping_buffer);
+      return;
+    }
+
+    // The delay is longer than the block so read it all before writing.
+    mopo_float values[MAX_BUFFER_SIZE];
+    memory_->readBlock(dest, period, buffer_size_);
+    for (int i = 0; i < buffer_size_; ++i) {
+      filtered_sample_ = utils::interpolate(dest[i], filtered_sample_, damping_buffer[i]);
+      values[i] = audio_buffer[i] + filtered_sample_ * feedback_buffer[i];
+    }
+    memory_->pushBlock(values, buffer_size_);
   }
 } // namespace mopo
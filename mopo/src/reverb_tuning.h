@@ -23,6 +23,7 @@ namespace mopo {
   const int REVERB_MAX_MEMORY = 7192;
   const int NUM_COMB = 8;
   const int NUM_ALL_PASS = 4;
+  const mopo_float ALL_PASS_FEEDBACK = 0.5;
   const mopo_float FIXED_GAIN = 0.015f;
   const float scalewet = 3.0f;
   const float scaledry = 2.0f;
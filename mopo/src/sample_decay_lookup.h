@@ -27,38 +27,40 @@ namespace mopo {
 
   namespace {
     const int SAMPLE_DECAY_LOOKUP_RESOLUTION = 2046;
-    const mopo_float CLOSE_ENOUGH = 1.0 / 256.0;
+    const double CLOSE_ENOUGH = 1.0 / 256.0;
   } // namespace
 
+  // Per sample decays sit within a hair of 1.0 so they're kept in double
+  // precision even when mopo_float is float.
   class SampleDecayLookupSingleton {
     public:
       SampleDecayLookupSingleton() {
         for (int i = 0; i < SAMPLE_DECAY_LOOKUP_RESOLUTION + 3; ++i) {
-          mopo_float percent = (1.0 * i) / SAMPLE_DECAY_LOOKUP_RESOLUTION;
+          double percent = (1.0 * i) / SAMPLE_DECAY_LOOKUP_RESOLUTION;
           sample_decay_lookup_[i] = pow(CLOSE_ENOUGH, percent);
         }
       }
 
-      mopo_float sampleDecayLookup(mopo_float sample_length) const {
+      double sampleDecayLookup(double sample_length) const {
         if (sample_length <= 1.0)
           return 0.0;
 
-        mopo_float percent = 1.0 / sample_length;
-        mopo_float index = SAMPLE_DECAY_LOOKUP_RESOLUTION * percent;
+        double percent = 1.0 / sample_length;
+        double index = SAMPLE_DECAY_LOOKUP_RESOLUTION * percent;
         int int_index = index;
-        mopo_float fraction = index - int_index;
+        double fraction = index - int_index;
 
         return utils::interpolate(sample_decay_lookup_[int_index],
                                   sample_decay_lookup_[int_index + 1], fraction);
       }
 
     private:
-      mopo_float sample_decay_lookup_[SAMPLE_DECAY_LOOKUP_RESOLUTION + 3];
+      double sample_decay_lookup_[SAMPLE_DECAY_LOOKUP_RESOLUTION + 3];
   };
 
   class SampleDecayLookup {
     public:
-      static mopo_float sampleDecayLookup(mopo_float sample_length) {
+      static double sampleDecayLookup(double sample_length) {
         return lookup_.sampleDecayLookup(sample_length);
       }
 
@@ -20,18 +20,32 @@
 
 namespace mopo {
 
-  SimpleDelay::SimpleDelay(int size) : Processor(SimpleDelay::kNumInputs, 1) {
-    memory_ = new Memory(size);
+  SimpleDelay::SimpleDelay(mopo_float max_seconds) : Processor(SimpleDelay::kNumInputs, 1) {
+    max_seconds_ = max_seconds;
+    memory_ = new Memory(max_seconds_ * sample_rate_);
   }
 
   SimpleDelay::SimpleDelay(const SimpleDelay& other) : Processor(other) {
     this->memory_ = new Memory(*other.memory_);
+    this->max_seconds_ = other.max_seconds_;
   }
 
   SimpleDelay::~SimpleDelay() {
     delete memory_;
   }
 
+  void SimpleDelay::setSampleRate(int sample_rate) {
+    Processor::setSampleRate(sample_rate);
+
+    // Every note can need this right away so it stays allocated. Sample rate
+    // changes happen with audio stopped so it can be resized here.
+    int size = utils::nextPowerOfTwo(max_seconds_ * sample_rate_);
+    if (size != memory_->getSize()) {
+      delete memory_;
+      memory_ = new Memory(size);
+    }
+  }
+
   void SimpleDelay::process() {
     MOPO_ASSERT(inputMatchesBufferSize(kAudio));
     MOPO_ASSERT(inputMatchesBufferSize(kFeedback));
@@ -47,6 +61,8 @@ namespace mopo {
     }
 
     const mopo_float* period = input(kSampleDelay)->source->buffer;
+    if (!input(kReset)->source->triggered && processBlock(dest, audio, period, feedback))
+      return;
 
     int i = 0;
     if (input(kReset)->source->triggered) {
@@ -62,4 +78,25 @@ namespace mopo {
     for (int i = 0; i < buffer_size_; ++i)
       tick(i, dest, audio, period, feedback);
   }
+
+  bool SimpleDelay::processBlock(mopo_float* dest, const mopo_float* audio,
+                                 const mopo_float* period, const mopo_float* feedback) {
+    // A fixed period longer than the block never reads this block's writes.
+    mopo_float block_period = period[0];
+    if (block_period < buffer_size_)
+      return false;
+    for (int i = 1; i < buffer_size_; ++i) {
+      if (period[i] != block_period)
+        return false;
+    }
+
+    memory_->readInterpolated(dest, block_period, -1.0, buffer_size_);
+    VECTORIZE_LOOP
+    for (int i = 0; i < buffer_size_; ++i) {
+      dest[i] = audio[i] + dest[i] * feedback[i];
+      MOPO_ASSERT(std::isfinite(dest[i]));
+    }
+    memory_->pushBlock(dest, buffer_size_);
+    return true;
+  }
 } // namespace mopo
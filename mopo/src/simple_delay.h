@@ -35,7 +35,7 @@ namespace mopo {
         kNumInputs
       };
 
-      SimpleDelay(int size);
+      SimpleDelay(mopo_float max_seconds);
       SimpleDelay(const SimpleDelay& other);
       virtual ~SimpleDelay();
 
@@ -44,6 +44,7 @@ namespace mopo {
       }
 
       virtual void process() override;
+      virtual void setSampleRate(int sample_rate) override;
 
       inline void tick(int i, mopo_float* dest,
                        const mopo_float* audio,
@@ -57,7 +58,11 @@ namespace mopo {
       }
 
     protected:
+      bool processBlock(mopo_float* dest, const mopo_float* audio,
+                        const mopo_float* period, const mopo_float* feedback);
+
       Memory* memory_;
+      mopo_float max_seconds_;
   };
 } // namespace mopo
 
@@ -21,6 +21,7 @@
 #include "utils.h"
 
 #define SMOOTH_CUTOFF 3.0
+#define SMOOTH_SNAP 1e-5
 
 namespace mopo {
 
@@ -63,7 +64,14 @@ namespace mopo {
     }
 
     void SmoothValue::process() {
+      if (value_ == target_value_ && output()->buffer[0] == value_)
+        return;
+
+      // Snap once close enough or the value never quite arrives and this
+      // keeps running for parameters that aren't moving.
       value_ = utils::interpolate(value_, target_value_, decay_);
+      if (std::abs(target_value_ - value_) <= SMOOTH_SNAP * (1.0 + std::abs(target_value_)))
+        value_ = target_value_;
       output()->buffer[0] = value_;
     }
 
@@ -35,7 +35,7 @@ namespace mopo {
       virtual void setSampleRate(int sample_rate) override;
 
       void set(mopo_float value) override { target_value_ = value; }
-      void setHard(mopo_float value) {
+      void setHard(mopo_float value) override {
         Value::set(value);
         target_value_ = value;
       }
@@ -64,7 +64,7 @@ namespace mopo {
         virtual void setBufferSize(int buffer_size) override;
 
         void set(mopo_float value) override { target_value_ = value; }
-        void setHard(mopo_float value) {
+        void setHard(mopo_float value) override {
           Value::set(value);
           target_value_ = value;
         }
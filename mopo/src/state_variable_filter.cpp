@@ -25,6 +25,169 @@
 
 namespace mopo {
 
+  namespace {
+    // Twice as many single precision voices fit in a vector register.
+    const int BANK_LANES = MOPO_FLOAT ? 8 : 4;
+  } // namespace
+
+  // Filter state for up to BANK_LANES voices laid out side by side. Unused
+  // lanes run silence with zeroed coefficients and are never written back.
+  struct FilterLanes {
+    StateVariableFilter* filters[BANK_LANES];
+    int num;
+
+    mopo_float a1[BANK_LANES], a2[BANK_LANES], a3[BANK_LANES];
+    mopo_float m0[BANK_LANES], m1[BANK_LANES], m2[BANK_LANES];
+    mopo_float delta_m0[BANK_LANES], delta_m1[BANK_LANES], delta_m2[BANK_LANES];
+    mopo_float drive[BANK_LANES], delta_drive[BANK_LANES];
+
+    mopo_float ic1eq_a[BANK_LANES], ic2eq_a[BANK_LANES];
+    mopo_float ic1eq_b[BANK_LANES], ic2eq_b[BANK_LANES];
+
+    void load(int lane, bool smooth) {
+      StateVariableFilter* filter = filters[lane];
+      a1[lane] = filter->a1_;
+      a2[lane] = filter->a2_;
+      a3[lane] = filter->a3_;
+      m0[lane] = filter->m0_;
+      m1[lane] = filter->m1_;
+      m2[lane] = filter->m2_;
+      drive[lane] = filter->drive_;
+      ic1eq_a[lane] = filter->ic1eq_a_;
+      ic2eq_a[lane] = filter->ic2eq_a_;
+      ic1eq_b[lane] = filter->ic1eq_b_;
+      ic2eq_b[lane] = filter->ic2eq_b_;
+
+      if (smooth) {
+        delta_m0[lane] = (filter->target_m0_ - filter->m0_) / filter->buffer_size_;
+        delta_m1[lane] = (filter->target_m1_ - filter->m1_) / filter->buffer_size_;
+        delta_m2[lane] = (filter->target_m2_ - filter->m2_) / filter->buffer_size_;
+        delta_drive[lane] = (filter->target_drive_ - filter->drive_) / filter->buffer_size_;
+      }
+      else
+        delta_m0[lane] = delta_m1[lane] = delta_m2[lane] = delta_drive[lane] = 0.0;
+    }
+
+    void clear(int lane) {
+      a1[lane] = a2[lane] = a3[lane] = 0.0;
+      m0[lane] = m1[lane] = m2[lane] = 0.0;
+      delta_m0[lane] = delta_m1[lane] = delta_m2[lane] = 0.0;
+      drive[lane] = delta_drive[lane] = 0.0;
+      ic1eq_a[lane] = ic2eq_a[lane] = ic1eq_b[lane] = ic2eq_b[lane] = 0.0;
+    }
+
+    void store(int lane, bool db24) {
+      StateVariableFilter* filter = filters[lane];
+      filter->m0_ = m0[lane];
+      filter->m1_ = db24 ? filter->target_m1_ : m1[lane];
+      filter->m2_ = m2[lane];
+      filter->drive_ = drive[lane];
+      filter->ic1eq_a_ = ic1eq_a[lane];
+      filter->ic2eq_a_ = ic2eq_a[lane];
+      filter->ic1eq_b_ = ic1eq_b[lane];
+      filter->ic2eq_b_ = ic2eq_b[lane];
+    }
+
+    // Same operations in the same order as tick and tick24db so banked
+    // voices sound exactly like voices processed one at a time.
+    template<bool db24>
+    void tick(const mopo_float (*audio)[BANK_LANES], mopo_float (*dest)[BANK_LANES],
+              int start, int end) {
+      for (int i = start; i < end; ++i) {
+        VECTORIZE_LOOP
+        for (int l = 0; l < BANK_LANES; ++l) {
+          m0[l] += delta_m0[l];
+          m1[l] += delta_m1[l];
+          m2[l] += delta_m2[l];
+          drive[l] += delta_drive[l];
+
+          mopo_float in = drive[l] * audio[i][l];
+          if (!db24)
+            in = utils::quickTanh(in);
+
+          mopo_float v3_a = in - ic2eq_a[l];
+          mopo_float v1_a = a1[l] * ic1eq_a[l] + a2[l] * v3_a;
+          mopo_float v2_a = ic2eq_a[l] + a2[l] * ic1eq_a[l] + a3[l] * v3_a;
+          ic1eq_a[l] = 2.0 * v1_a - ic1eq_a[l];
+          ic2eq_a[l] = 2.0 * v2_a - ic2eq_a[l];
+          mopo_float out = m0[l] * in + m1[l] * v1_a + m2[l] * v2_a;
+
+          if (db24) {
+            mopo_float distort = utils::quickTanh(out);
+
+            mopo_float v3_b = distort - ic2eq_b[l];
+            mopo_float v1_b = a1[l] * ic1eq_b[l] + a2[l] * v3_b;
+            mopo_float v2_b = ic2eq_b[l] + a2[l] * ic1eq_b[l] + a3[l] * v3_b;
+            ic1eq_b[l] = 2.0 * v1_b - ic1eq_b[l];
+            ic2eq_b[l] = 2.0 * v2_b - ic2eq_b[l];
+            out = m0[l] * distort + m1[l] * v1_b + m2[l] * v2_b;
+          }
+
+          dest[i][l] = out;
+        }
+      }
+    }
+
+    void process(bool db24) {
+      int buffer_size = filters[0]->buffer_size_;
+      int reset_offsets[BANK_LANES];
+      mopo_float audio[MAX_BUFFER_SIZE][BANK_LANES];
+      mopo_float dest[MAX_BUFFER_SIZE][BANK_LANES];
+
+      for (int l = 0; l < BANK_LANES; ++l) {
+        if (l < num) {
+          MOPO_ASSERT(filters[l]->buffer_size_ == buffer_size);
+          load(l, true);
+          reset_offsets[l] = filters[l]->getResetOffset();
+
+          const mopo_float* source =
+              filters[l]->input(StateVariableFilter::kAudio)->source->buffer;
+          for (int i = 0; i < buffer_size; ++i)
+            audio[i][l] = source[i];
+        }
+        else {
+          clear(l);
+          reset_offsets[l] = -1;
+          for (int i = 0; i < buffer_size; ++i)
+            audio[i][l] = 0.0;
+        }
+      }
+
+      // Voice resets split the block. Lanes resetting at a sample drop their
+      // smoothing and continue from the targets like the scalar path does.
+      int start = 0;
+      while (start < buffer_size) {
+        int end = buffer_size;
+        for (int l = 0; l < num; ++l) {
+          if (reset_offsets[l] == start) {
+            filters[l]->reset();
+            load(l, false);
+          }
+          else if (reset_offsets[l] > start)
+            end = utils::imin(end, reset_offsets[l]);
+        }
+
+        if (db24)
+          tick<true>(audio, dest, start, end);
+        else
+          tick<false>(audio, dest, start, end);
+        start = end;
+      }
+
+      for (int l = 0; l < num; ++l) {
+        if (reset_offsets[l] >= buffer_size) {
+          filters[l]->reset();
+          load(l, false);
+        }
+
+        mopo_float* out = filters[l]->output()->buffer;
+        for (int i = 0; i < buffer_size; ++i)
+          out[i] = dest[i][l];
+        store(l, db24);
+      }
+    }
+  };
+
   StateVariableFilter::StateVariableFilter() : Processor(StateVariableFilter::kNumInputs, 1) {
     a1_ = a2_ = a3_ = 0.0;
     m0_ = m1_ = m2_ = 0.0;
@@ -44,11 +207,21 @@ namespace mopo {
     const mopo_float* audio_buffer = input(kAudio)->source->buffer;
     mopo_float* dest = output()->buffer;
 
-    if (input(kOn)->at(0) == 0.0) {
+    if (!updateCoefficients()) {
       processAllPass(audio_buffer, dest);
       return;
     }
 
+    if (last_style_ == k24dB)
+      process24db(audio_buffer, dest);
+    else
+      process12db(audio_buffer, dest);
+  }
+
+  bool StateVariableFilter::updateCoefficients() {
+    if (input(kOn)->at(0) == 0.0)
+      return false;
+
     Styles style = static_cast<Styles>(static_cast<int>(input(kStyle)->at(0)));
     bool db24 = style == k24dB;
 
@@ -70,11 +243,14 @@ namespace mopo {
       reset();
       last_style_ = style;
     }
+    return true;
+  }
 
-    if (db24)
-      process24db(audio_buffer, dest);
-    else
-      process12db(audio_buffer, dest);
+  int StateVariableFilter::getResetOffset() {
+    const Output* reset_source = input(kReset)->source;
+    if (reset_source->triggered && reset_source->trigger_value == kVoiceReset)
+      return reset_source->trigger_offset;
+    return -1;
   }
 
   void StateVariableFilter::process12db(const mopo_float* audio_buffer, mopo_float* dest) {
@@ -148,6 +324,37 @@ namespace mopo {
     m1_ = target_m1_;
   }
 
+  void StateVariableFilter::processBank(Processor* const* filters, int num) {
+    // 12dB and shelf filters share a recurrence. 24dB filters run another.
+    FilterLanes lanes[2];
+    lanes[0].num = 0;
+    lanes[1].num = 0;
+
+    for (int f = 0; f < num; ++f) {
+      StateVariableFilter* filter = static_cast<StateVariableFilter*>(filters[f]);
+      MOPO_ASSERT(filter->inputMatchesBufferSize(kAudio));
+
+      if (!filter->updateCoefficients()) {
+        filter->processAllPass(filter->input(kAudio)->source->buffer,
+                               filter->output()->buffer);
+        continue;
+      }
+
+      bool db24 = filter->last_style_ == k24dB;
+      FilterLanes& group = lanes[db24];
+      group.filters[group.num++] = filter;
+      if (group.num == BANK_LANES) {
+        group.process(db24);
+        group.num = 0;
+      }
+    }
+
+    for (int db24 = 0; db24 < 2; ++db24) {
+      if (lanes[db24].num)
+        lanes[db24].process(db24);
+    }
+  }
+
   void StateVariableFilter::processAllPass(const mopo_float* audio_buffer, mopo_float* dest) {
     reset();
     utils::copyBuffer(dest, audio_buffer, buffer_size_);
@@ -60,6 +60,11 @@ namespace mopo {
 
       virtual Processor* clone() const { return new StateVariableFilter(*this); }
       virtual void process();
+
+      // Processes _num_ filters from different voices with their state side
+      // by side so the per sample recurrence runs across voices.
+      static void processBank(Processor* const* filters, int num);
+
       void process12db(const mopo_float* audio_buffer, mopo_float* dest);
       void process24db(const mopo_float* audio_buffer, mopo_float* dest);
       void processAllPass(const mopo_float* audio_buffer, mopo_float* dest);
@@ -77,6 +82,9 @@ namespace mopo {
       inline void tick24db(int i, mopo_float* dest, const mopo_float* audio_buffer);
 
     private:
+      // Reads this block's controls. Returns false if the filter is off.
+      bool updateCoefficients();
+      int getResetOffset();
       void reset();
 
       mopo_float a1_, a2_, a3_;
@@ -90,6 +98,8 @@ namespace mopo {
       mopo_float last_in_, last_distort_;
       Styles last_style_;
       Shelves last_shelf_;
+
+      friend struct FilterLanes;
   };
 } // namespace mopo
 
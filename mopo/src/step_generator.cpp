@@ -26,7 +26,7 @@ namespace mopo {
       offset_(0.0), current_step_(0) { }
 
   void StepGenerator::process() {
-    static mopo_float integral;
+    double integral;
     unsigned int num_steps = static_cast<int>(input(kNumSteps)->at(0));
     num_steps = utils::iclamp(num_steps, 1, max_steps_);
 
@@ -37,7 +37,7 @@ namespace mopo {
       i = input(kReset)->source->trigger_offset;
     }
 
-    offset_ += samples_to_process_ * input(kFrequency)->at(0) / sample_rate_;
+    offset_ += (1.0 * samples_to_process_) * input(kFrequency)->at(0) / sample_rate_;
     offset_ = utils::mod(offset_, &integral);
     current_step_ += integral;
     current_step_ = (current_step_ + num_steps) % num_steps;
@@ -46,8 +46,8 @@ namespace mopo {
     output(kStep)->buffer[0] = current_step_;
   }
 
-  void StepGenerator::correctToTime(mopo_float samples) {
-    static mopo_float integral;
+  void StepGenerator::correctToTime(double samples) {
+    double integral;
 
     unsigned int num_steps = static_cast<int>(input(kNumSteps)->at(0));
     num_steps = utils::iclamp(num_steps, 1, max_steps_);
@@ -47,11 +47,11 @@ namespace mopo {
       }
 
       void process() override;
-      void correctToTime(mopo_float samples);
+      void correctToTime(double samples);
 
     protected:
       unsigned int max_steps_;
-      mopo_float offset_;
+      double offset_;
       unsigned int current_step_;
   };
 } // namespace mopo
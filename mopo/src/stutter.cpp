@@ -30,18 +30,19 @@ namespace mopo {
     }
   } // namespace
 
-  Stutter::Stutter(int size) : Processor(Stutter::kNumInputs, 1),
-      memory_(nullptr), size_(size), offset_(0.0), memory_offset_(0.0), resample_countdown_(0.0),
-      last_stutter_period_(0.0), last_amplitude_(0.0), resampling_(true) {
+  Stutter::Stutter(mopo_float max_seconds, std::shared_ptr<LazyMemory::Registry> effect_memory) :
+      Processor(Stutter::kNumInputs, 1), lazy_memory_(effect_memory), memory_(nullptr), max_seconds_(max_seconds), offset_(0.0), memory_offset_(0.0),
+      resample_countdown_(0.0), last_stutter_period_(0.0), last_amplitude_(0.0),
+      resampling_(true) {
+    lazy_memory_.setSize(max_seconds_ * sample_rate_);
   }
 
-  Stutter::~Stutter() {
-    delete memory_;
-  }
+  Stutter::~Stutter() { }
 
-  Stutter::Stutter(const Stutter& other) : Processor(other) {
+  Stutter::Stutter(const Stutter& other) : Processor(other), lazy_memory_(other.lazy_memory_) {
     this->memory_ = nullptr;
-    this->size_ = other.size_;
+    this->tail_ = TailTracker();
+    this->max_seconds_ = other.max_seconds_;
     this->offset_ = other.offset_;
     this->memory_offset_ = 0.0;
     this->resample_countdown_ = other.resample_countdown_;
@@ -50,18 +51,38 @@ namespace mopo {
     this->resampling_ = other.resampling_;
   }
 
+  void Stutter::setSampleRate(int sample_rate) {
+    Processor::setSampleRate(sample_rate);
+    lazy_memory_.setSize(max_seconds_ * sample_rate_);
+  }
+
   void Stutter::process() {
     MOPO_ASSERT(inputMatchesBufferSize(kAudio));
 
-    // A hack to save memory until stutter is used.
-    if (memory_ == nullptr)
-      memory_ = new Memory(size_);
-
-    mopo_float max_memory_write = memory_->getSize();
     const mopo_float* audio = input(kAudio)->source->buffer;
     mopo_float* dest = output()->buffer;
 
     mopo_float sample_period = sample_rate_ / input(kResampleFrequency)->at(0);
+
+    // Nothing stored can be heard once a full memory of silence went by.
+    bool silent = tail_.update(audio, buffer_size_, 0.0, max_seconds_ * sample_rate_);
+    if (silent)
+      lazy_memory_.rest();
+    else
+      memory_ = lazy_memory_.get();
+
+    // Pass audio through until memory is handed over and then start fresh.
+    if (silent || memory_ == nullptr) {
+      utils::copyBuffer(dest, audio, buffer_size_);
+      startResampling(sample_period);
+      last_amplitude_ = 1.0;
+      return;
+    }
+
+    mopo_float max_memory_write = memory_->getSize();
+    if (memory_offset_ > max_memory_write)
+      startResampling(sample_period);
+
     mopo_float end_stutter_period = sample_rate_ / input(kStutterFrequency)->at(0);
     end_stutter_period = utils::min(sample_period, end_stutter_period);
     end_stutter_period = utils::min(max_memory_write, end_stutter_period);
@@ -125,9 +146,10 @@ namespace mopo {
       }
       else {
         mopo_float* playback_dest = dest + i;
+        memory_->readInterpolated(playback_dest, memory_offset_ - offset_, -1.0, num_samples);
         for (int s = 0; s < num_samples; ++s) {
           amplitude += amplitude_diff;
-          playback_dest[s] = amplitude * memory_->get(memory_offset_ - offset_ - s);
+          playback_dest[s] *= amplitude;
         }
       }
 
@@ -18,8 +18,10 @@
 #ifndef STUTTER_H
 #define STUTTER_H
 
+#include "lazy_memory.h"
 #include "memory.h"
 #include "processor.h"
+#include "tail_tracker.h"
 #include "utils.h"
 
 namespace mopo {
@@ -37,12 +39,13 @@ namespace mopo {
         kNumInputs
       };
 
-      Stutter(int size);
+      Stutter(mopo_float max_seconds, std::shared_ptr<LazyMemory::Registry> effect_memory = nullptr);
       Stutter(const Stutter& other);
       virtual ~Stutter();
 
       virtual Processor* clone() const override { return new Stutter(*this); }
       virtual void process() override;
+      virtual void setSampleRate(int sample_rate) override;
 
     protected:
       void startResampling(mopo_float sample_period) {
@@ -52,8 +55,10 @@ namespace mopo {
         memory_offset_ = 0.0;
       }
 
+      LazyMemory lazy_memory_;
       Memory* memory_;
-      int size_;
+      TailTracker tail_;
+      mopo_float max_seconds_;
       mopo_float offset_;
       mopo_float memory_offset_;
       mopo_float resample_countdown_;
@@ -0,0 +1,69 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * mopo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mopo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mopo.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tail_tracker.h"
+
+#include "utils.h"
+
+#include <limits>
+
+#define SILENCE_THRESHOLD 0.00001
+#define MAX_TAIL_FEEDBACK 0.9999
+
+namespace mopo {
+
+  TailTracker::TailTracker() : level_(0.0), quiet_samples_(0.0), silent_(true) { }
+
+  bool TailTracker::update(const mopo_float* audio, int samples,
+                           mopo_float feedback, mopo_float period, mopo_float smear) {
+    mopo_float peak = utils::peak(audio, samples, 1);
+    if (peak > SILENCE_THRESHOLD) {
+      level_ = utils::max(level_, peak);
+      quiet_samples_ = 0.0;
+      silent_ = false;
+      return false;
+    }
+
+    if (silent_)
+      return true;
+
+    // Feedback is read every block so turning it up keeps the tail going.
+    quiet_samples_ += samples;
+    if (quiet_samples_ > tailSamples(level_, feedback, period) + smear) {
+      level_ = 0.0;
+      silent_ = true;
+    }
+    return silent_;
+  }
+
+  mopo_float TailTracker::tailSamples(mopo_float level, mopo_float feedback,
+                                      mopo_float period) {
+    mopo_float gain = fabs(feedback);
+    if (gain >= MAX_TAIL_FEEDBACK)
+      return std::numeric_limits<mopo_float>::max();
+    if (gain <= SILENCE_THRESHOLD)
+      return period;
+
+    // The loop can build up to level / (1 - gain) before the input stops,
+    // then loses a factor of gain every trip around.
+    mopo_float loop_level = level / (1.0 - gain);
+    if (loop_level <= SILENCE_THRESHOLD)
+      return period;
+
+    mopo_float trips = log(SILENCE_THRESHOLD / loop_level) / log(gain);
+    return period * (trips + 1.0);
+  }
+} // namespace mopo
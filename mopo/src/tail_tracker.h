@@ -0,0 +1,51 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * mopo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mopo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mopo.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef TAIL_TRACKER_H
+#define TAIL_TRACKER_H
+
+#include "common.h"
+
+namespace mopo {
+
+  // Follows how long a feedback effect keeps ringing once its input goes
+  // quiet so the effect can stop processing when what's left can't be heard.
+  class TailTracker {
+    public:
+      TailTracker();
+
+      // Call once a block with the effect's input. _feedback_ is the gain of
+      // one trip around the effect's loop and _period_ its length in samples.
+      // _smear_ is how long anything after the loop keeps ringing. Returns
+      // true if the effect is silent and can skip the block.
+      bool update(const mopo_float* audio, int samples,
+                  mopo_float feedback, mopo_float period, mopo_float smear = 0.0);
+
+      bool isSilent() const { return silent_; }
+
+      // Samples until input at _level_ decays out of the loop.
+      static mopo_float tailSamples(mopo_float level, mopo_float feedback,
+                                    mopo_float period);
+
+    protected:
+      mopo_float level_;
+      mopo_float quiet_samples_;
+      bool silent_;
+  };
+} // namespace mopo
+
+#endif // TAIL_TRACKER_H
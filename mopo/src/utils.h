@@ -137,7 +137,34 @@ namespace mopo {
       return fmaf(t, to - from, from);
     }
 
-    inline mopo_float mod(double value, double* integral) {
+#if MOPO_FLOAT
+    // Double literals and integer sample rates get mixed with float samples
+    // all over the graph. Route those calls to the mopo_float versions
+    // instead of leaving them ambiguous.
+    template<class A, class B>
+    inline mopo_float min(A one, B two) {
+      return min(static_cast<mopo_float>(one), static_cast<mopo_float>(two));
+    }
+
+    template<class A, class B>
+    inline mopo_float max(A one, B two) {
+      return max(static_cast<mopo_float>(one), static_cast<mopo_float>(two));
+    }
+
+    template<class A, class B, class C>
+    inline mopo_float clamp(A value, B min, C max) {
+      return clamp(static_cast<mopo_float>(value),
+                   static_cast<mopo_float>(min), static_cast<mopo_float>(max));
+    }
+
+    template<class A, class B, class C>
+    inline mopo_float interpolate(A from, B to, C t) {
+      return interpolate(static_cast<mopo_float>(from),
+                         static_cast<mopo_float>(to), static_cast<mopo_float>(t));
+    }
+#endif
+
+    inline double mod(double value, double* integral) {
       return modf(value, integral);
     }
 
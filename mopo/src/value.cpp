@@ -53,6 +53,9 @@ namespace mopo {
   }
 
   void Value::set(mopo_float value) {
+    if (output()->buffer[0] != value)
+      output()->markChanged();
+
     value_ = value;
     for (int i = 0; i < output()->buffer_size; ++i)
       output()->buffer[i] = value_;
@@ -33,10 +33,14 @@ namespace mopo {
 
       virtual Processor* clone() const override { return new Value(*this); }
       virtual void process() override;
+      virtual bool versionsOutputs() const override { return true; }
 
       virtual mopo_float value() const { return value_; }
       virtual void set(mopo_float value);
 
+      // Sets the value with no smoothing in subclasses that smooth.
+      virtual void setHard(mopo_float value) { set(value); }
+
     protected:
       mopo_float value_;
   };
@@ -16,12 +16,16 @@
 
 #include "voice_handler.h"
 
+#include "dsp_kernels.h"
+#include "graph_edit.h"
 #include "utils.h"
 
+#include <algorithm>
+
 namespace mopo {
 
-  Voice::Voice(Processor* processor) : event_sample_(-1),
-      aftertouch_sample_(-1), aftertouch_(0.0), processor_(processor) {
+  Voice::Voice(Processor* processor, ProcessorArena* arena) : event_sample_(-1),
+      aftertouch_sample_(-1), aftertouch_(0.0), processor_(processor), arena_(arena) {
     state_.event = kVoiceOff;
     state_.note = 0;
     state_.velocity = 0;
@@ -33,15 +37,72 @@ namespace mopo {
 
   Voice::~Voice() {
     delete processor_;
+
+    for (auto& output : isolated_shared_outputs_)
+      delete output.second;
+  }
+
+  void Voice::isolate(const std::vector<Output*>& shared,
+                      const std::vector<const Output*>& read) {
+    ProcessorArena::Scope scope(arena_);
+    buffer_pool_.release();
+    isolated_outputs_.clear();
+    for (Output* output : shared) {
+      if (isolated_shared_outputs_.count(output) == 0) {
+        Output* isolated = new Output(output->buffer_size);
+        isolated->owner = output->owner;
+        isolated_shared_outputs_[output] = isolated;
+      }
+      isolated_outputs_[output] = isolated_shared_outputs_[output];
+    }
+
+    processor_->isolateOutputs(isolated_outputs_);
+    processor_->isolateInputs(isolated_outputs_);
+    processor_->compilePlans();
+
+    std::set<const Output*> pinned;
+    for (const Output* output : read)
+      pinned.insert(isolatedOutput(output));
+    buffer_pool_.plan(static_cast<ProcessorRouter*>(processor_), pinned);
+    buffer_pool_.apply();
+  }
+
+  void Voice::prepareEdit(GraphEdit* edit, const std::vector<const Output*>& read) {
+    output_remap outputs = isolated_outputs_;
+    edit->isolateCopies(&outputs);
+    processor_->prepareEdit(edit);
+    edit->isolateCopies(nullptr);
+    processor_->prepareIsolatedInputs(edit, outputs);
+
+    std::set<const Output*> pinned;
+    for (const Output* output : read) {
+      auto mapped = outputs.find(output);
+      pinned.insert(mapped == outputs.end() ? output : mapped->second);
+    }
+
+    edit->replacePool(&buffer_pool_, static_cast<ProcessorRouter*>(processor_), pinned);
+    edit->replaceRemap(&isolated_outputs_, outputs);
   }
 
   VoiceHandler::VoiceHandler(size_t polyphony) :
       ProcessorRouter(kNumInputs, 0), polyphony_(0), sustain_(false),
-      legato_(false), voice_killer_(0), last_played_note_(-1.0) {
+      legato_(false), voice_killer_(0), last_played_note_(-1.0),
+      voice_workers_(nullptr), voice_task_(this),
+      bank_processor_(nullptr), voice_bank_(nullptr) {
     pressed_notes_.reserve(MIDI_SIZE);
     all_voices_.reserve(MAX_POLYPHONY);
     free_voices_.reserve(MAX_POLYPHONY);
     active_voices_.reserve(MAX_POLYPHONY);
+    parallel_voices_.reserve(MAX_POLYPHONY);
+    bank_processors_.reserve(MAX_POLYPHONY);
+
+    trigger_outputs_.push_back(&voice_event_);
+    trigger_outputs_.push_back(&note_);
+    trigger_outputs_.push_back(&last_note_);
+    trigger_outputs_.push_back(&note_pressed_);
+    trigger_outputs_.push_back(&channel_);
+    trigger_outputs_.push_back(&velocity_);
+    trigger_outputs_.push_back(&aftertouch_);
 
     setPolyphony(polyphony);
     voice_router_.router(this);
@@ -49,6 +110,7 @@ namespace mopo {
 }
 
   VoiceHandler::~VoiceHandler() {
+    delete voice_workers_;
     voice_router_.destroy();
     global_router_.destroy();
 
@@ -63,28 +125,36 @@ namespace mopo {
   }
 
   void VoiceHandler::prepareVoiceTriggers(Voice* voice) {
-    note_.clearTrigger();
-    last_note_.clearTrigger();
-    note_pressed_.clearTrigger();
-    channel_.clearTrigger();
-    velocity_.clearTrigger();
-    voice_event_.clearTrigger();
-    aftertouch_.clearTrigger();
-    channel_.buffer[0] = voice->state().channel;
+    Output* voice_event = voice->isolatedOutput(&voice_event_);
+    Output* note = voice->isolatedOutput(&note_);
+    Output* last_note = voice->isolatedOutput(&last_note_);
+    Output* note_pressed = voice->isolatedOutput(&note_pressed_);
+    Output* channel = voice->isolatedOutput(&channel_);
+    Output* velocity = voice->isolatedOutput(&velocity_);
+    Output* aftertouch = voice->isolatedOutput(&aftertouch_);
+
+    note->clearTrigger();
+    last_note->clearTrigger();
+    note_pressed->clearTrigger();
+    channel->clearTrigger();
+    velocity->clearTrigger();
+    voice_event->clearTrigger();
+    aftertouch->clearTrigger();
+    channel->buffer[0] = voice->state().channel;
 
     if (voice->hasNewEvent()) {
-      voice_event_.trigger(voice->state().event, voice->event_sample());
+      voice_event->trigger(voice->state().event, voice->event_sample());
       if (voice->state().event == kVoiceOn) {
-        note_.trigger(voice->state().note, 0);
-        last_note_.trigger(voice->state().last_note, 0);
-        velocity_.trigger(voice->state().velocity, 0);
-        note_pressed_.trigger(voice->state().note_pressed, 0);
-        channel_.trigger(voice->state().channel, 0);
+        note->trigger(voice->state().note, 0);
+        last_note->trigger(voice->state().last_note, 0);
+        velocity->trigger(voice->state().velocity, 0);
+        note_pressed->trigger(voice->state().note_pressed, 0);
+        channel->trigger(voice->state().channel, 0);
       }
     }
 
     if (voice->hasNewAftertouch())
-      aftertouch_.trigger(voice->aftertouch(), voice->aftertouch_sample());
+      aftertouch->trigger(voice->aftertouch(), voice->aftertouch_sample());
 
     voice->clearEvents();
   }
@@ -103,23 +173,21 @@ namespace mopo {
       utils::zeroBuffer(output.second->buffer, MAX_BUFFER_SIZE);
   }
 
-  void VoiceHandler::accumulateOutputs() {
+  void VoiceHandler::accumulateOutputs(Voice* voice) {
     for (auto& output : accumulated_outputs_) {
       int buffer_size = output.first->owner->getBufferSize();
       mopo_float* dest = output.second->buffer;
-      const mopo_float* source = output.first->buffer;
+      const mopo_float* source = voice->isolatedOutput(output.first)->buffer;
 
-      VECTORIZE_LOOP
-      for (int i = 0; i < buffer_size; ++i)
-        dest[i] += source[i];
+      kernels::accumulate(dest, source, buffer_size);
     }
   }
 
-  void VoiceHandler::writeNonaccumulatedOutputs() {
+  void VoiceHandler::writeNonaccumulatedOutputs(Voice* voice) {
     for (auto& output : last_voice_outputs_) {
       int buffer_size = output.first->owner->getBufferSize();
       mopo_float* dest = output.second->buffer;
-      const mopo_float* source = output.first->buffer;
+      const mopo_float* source = voice->isolatedOutput(output.first)->buffer;
 
       utils::copyBuffer(dest, source, buffer_size);
     }
@@ -130,6 +198,9 @@ namespace mopo {
   }
 
   void VoiceHandler::process() {
+#if MOPO_PROFILE
+    ProfileScope scope(profile_target_, profile_key_, true);
+#endif
     global_router_.process();
 
     int num_voices = active_voices_.size();
@@ -147,16 +218,30 @@ namespace mopo {
     setPolyphony(utils::iclamp(polyphony, 1, polyphony));
     clearAccumulatedOutputs();
 
+    if (voice_workers_) {
+      processVoicesInParallel();
+      last_num_voices_ = num_voices;
+      return;
+    }
+
+    if (voice_bank_) {
+      processVoicesInBank();
+      last_num_voices_ = num_voices;
+      return;
+    }
+
+    Voice* last_voice = nullptr;
     auto iter = active_voices_.begin();
     while (iter != active_voices_.end()) {
       Voice* voice = *iter;
       prepareVoiceTriggers(voice);
       processVoice(voice);
-      accumulateOutputs();
+      accumulateOutputs(voice);
+      last_voice = voice;
 
       // Remove voice if the right processor has a full silent buffer.
       if (voice_killer_ && voice->state().event != kVoiceOn &&
-          utils::isSilent(voice_killer_->buffer, buffer_size_)) {
+          utils::isSilent(voice->isolatedOutput(voice_killer_)->buffer, buffer_size_)) {
         free_voices_.push_back(voice);
         iter = active_voices_.erase(iter);
       }
@@ -165,11 +250,81 @@ namespace mopo {
     }
 
     if (active_voices_.size())
-      writeNonaccumulatedOutputs();
+      writeNonaccumulatedOutputs(last_voice);
 
     last_num_voices_ = num_voices;
   }
 
+  void VoiceHandler::processVoicesInParallel() {
+    parallel_voices_.clear();
+    for (Voice* voice : active_voices_) {
+      prepareVoiceTriggers(voice);
+      parallel_voices_.push_back(voice);
+    }
+
+    voice_workers_->run(&voice_task_, parallel_voices_.size());
+
+    // Sum in voice order so the output doesn't depend on thread timing.
+    finishVoiceBatch();
+  }
+
+  void VoiceHandler::processVoicesInBank() {
+    parallel_voices_.clear();
+    bank_processors_.clear();
+    for (Voice* voice : active_voices_) {
+      prepareVoiceTriggers(voice);
+
+      ProcessorRouter* router = static_cast<ProcessorRouter*>(voice->processor());
+      router->processBefore(bank_processor_);
+      Processor* banked = router->getLocalProcessor(bank_processor_);
+      if (banked->enabled())
+        bank_processors_.push_back(banked);
+      parallel_voices_.push_back(voice);
+    }
+
+    if (bank_processors_.size())
+      voice_bank_(bank_processors_.data(), bank_processors_.size());
+
+    for (Voice* voice : parallel_voices_)
+      static_cast<ProcessorRouter*>(voice->processor())->processAfter(bank_processor_);
+
+    finishVoiceBatch();
+  }
+
+  void VoiceHandler::finishVoiceBatch() {
+    for (Voice* voice : parallel_voices_) {
+      accumulateOutputs(voice);
+
+      if (voice_killer_ && voice->state().event != kVoiceOn &&
+          utils::isSilent(voice->isolatedOutput(voice_killer_)->buffer, buffer_size_)) {
+        free_voices_.push_back(voice);
+        active_voices_.remove(voice);
+      }
+    }
+
+    if (active_voices_.size())
+      writeNonaccumulatedOutputs(parallel_voices_.back());
+  }
+
+  void VoiceHandler::isolateVoice(Voice* voice) {
+    collectReadOutputs();
+    voice->isolate(trigger_outputs_, read_outputs_);
+  }
+
+  void VoiceHandler::collectReadOutputs() {
+    read_outputs_.clear();
+    for (auto& output : accumulated_outputs_)
+      read_outputs_.push_back(output.first);
+    for (auto& output : last_voice_outputs_)
+      read_outputs_.push_back(output.first);
+    if (voice_killer_)
+      read_outputs_.push_back(voice_killer_);
+  }
+
+  void VoiceHandler::VoiceTask::runTask(int index) {
+    handler_->processVoice(handler_->parallel_voices_[index]);
+  }
+
   void VoiceHandler::setSampleRate(int sample_rate) {
     ProcessorRouter::setSampleRate(sample_rate);
     voice_router_.setSampleRate(sample_rate);
@@ -186,6 +341,34 @@ namespace mopo {
       all_voices_[i]->processor()->setBufferSize(buffer_size);
   }
 
+  void VoiceHandler::prepareEdit(GraphEdit* edit) {
+    ProcessorRouter::prepareEdit(edit);
+    voice_router_.prepareEdit(edit);
+    global_router_.prepareEdit(edit);
+
+    collectReadOutputs();
+    for (int i = 0; i < all_voices_.size(); ++i) {
+      Voice* voice = all_voices_[i];
+      if (voice->isIsolated())
+        voice->prepareEdit(edit, read_outputs_);
+      else
+        voice->processor()->prepareEdit(edit);
+    }
+  }
+
+  void VoiceHandler::compilePlans() {
+    ProcessorRouter::compilePlans();
+    voice_router_.compilePlans();
+    global_router_.compilePlans();
+    for (int i = 0; i < all_voices_.size(); ++i) {
+      Voice* voice = all_voices_[i];
+      if (voice->isIsolated())
+        isolateVoice(voice);
+      else
+        voice->processor()->compilePlans();
+    }
+  }
+
   int VoiceHandler::getNumActiveVoices() {
     return active_voices_.size();
   }
@@ -412,7 +595,44 @@ namespace mopo {
     return processor == &voice_router_;
   }
 
+  void VoiceHandler::setNumVoiceThreads(int num_threads) {
+    // Once voices are isolated they stay isolated so keep a pool around.
+    if (voice_workers_ == nullptr && num_threads <= 1)
+      return;
+
+    delete voice_workers_;
+    voice_workers_ = new WorkerPool(std::max(num_threads, 1));
+    isolateVoices();
+  }
+
+  int VoiceHandler::getNumVoiceThreads() {
+    if (voice_workers_)
+      return voice_workers_->numThreads();
+    return 1;
+  }
+
+  void VoiceHandler::setVoiceBank(const Processor* processor, VoiceBank bank) {
+    bank_processor_ = processor;
+    voice_bank_ = bank;
+    if (bank)
+      isolateVoices();
+  }
+
+  void VoiceHandler::isolateVoices() {
+    for (int i = 0; i < all_voices_.size(); ++i) {
+      if (!all_voices_[i]->isIsolated())
+        isolateVoice(all_voices_[i]);
+    }
+  }
+
   Voice* VoiceHandler::createVoice() {
-    return new Voice(voice_router_.clone());
+    ProcessorArena::Scope scope(&voice_arena_);
+    voice_arena_.alignToCacheLine();
+    Processor* processor = voice_router_.clone();
+    processor->compilePlans();
+    Voice* voice = new Voice(processor, &voice_arena_);
+    if (isolatesVoices())
+      isolateVoice(voice);
+    return voice;
   }
 } // namespace mopo
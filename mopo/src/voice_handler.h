@@ -18,10 +18,12 @@
 #ifndef VOICE_HANDLER_H
 #define VOICE_HANDLER_H
 
+#include "buffer_pool.h"
 #include "circular_queue.h"
 #include "note_handler.h"
 #include "processor_router.h"
 #include "value.h"
+#include "worker_pool.h"
 
 #include <map>
 #include <list>
@@ -46,7 +48,7 @@ namespace mopo {
         kNumStates
       };
 
-      Voice(Processor* voice);
+      Voice(Processor* voice, ProcessorArena* arena = nullptr);
       virtual ~Voice();
 
       Processor* processor() { return processor_; }
@@ -105,6 +107,32 @@ namespace mopo {
         aftertouch_sample_ = -1;
       }
 
+      // Gives this voice private copies of every buffer it writes, including
+      // _shared_ outputs that live outside of the voice processor. Buffers
+      // that are only read while the voice runs come from a pool, except for
+      // the copies of _read_ outputs which are read after. Allocates so call
+      // it off the audio thread.
+      void isolate(const std::vector<Output*>& shared,
+                   const std::vector<const Output*>& read);
+      bool isIsolated() const { return processor_->isIsolated(); }
+
+      // Stages this voice's copy of the changes in _edit_ and the isolated
+      // state that goes with them so they are swapped in together.
+      void prepareEdit(GraphEdit* edit, const std::vector<const Output*>& read);
+
+      // Returns the private copy of _output_ if this voice is isolated.
+      const BufferPool& getBufferPool() const { return buffer_pool_; }
+
+      Output* isolatedOutput(Output* output) {
+        auto mapped = isolated_outputs_.find(output);
+        return mapped == isolated_outputs_.end() ? output : mapped->second;
+      }
+
+      const Output* isolatedOutput(const Output* output) {
+        auto mapped = isolated_outputs_.find(output);
+        return mapped == isolated_outputs_.end() ? output : mapped->second;
+      }
+
     private:
       Voice() { }
 
@@ -116,6 +144,11 @@ namespace mopo {
       mopo_float aftertouch_;
 
       Processor* processor_;
+      ProcessorArena* arena_;
+
+      output_remap isolated_outputs_;
+      output_remap isolated_shared_outputs_;
+      BufferPool buffer_pool_;
   };
 
   class VoiceHandler : public virtual ProcessorRouter, public NoteHandler {
@@ -125,6 +158,10 @@ namespace mopo {
         kNumInputs
       };
 
+      // Processes the voice copies of one processor together. _processors_
+      // holds one enabled copy per active voice in voice order.
+      typedef void (*VoiceBank)(Processor* const* processors, int num);
+
       VoiceHandler(size_t polyphony = 1);
 
       virtual ~VoiceHandler();
@@ -137,7 +174,10 @@ namespace mopo {
       virtual void process() override;
       virtual void setSampleRate(int sample_rate) override;
       virtual void setBufferSize(int buffer_size) override;
+      virtual void prepareEdit(GraphEdit* edit) override;
+      virtual void compilePlans() override;
       int getNumActiveVoices();
+      const CircularQueue<Voice*>& getAllVoices() const { return all_voices_; }
       CircularQueue<mopo_float>& getPressedNotes() { return pressed_notes_; }
       bool isNotePlaying(mopo_float note);
 
@@ -187,11 +227,34 @@ namespace mopo {
 
       bool isPolyphonic(const Processor* processor) const override;
 
+      // Renders voices on _num_threads_ threads including the audio thread.
+      // Each voice is isolated with its own buffers and summed in order at
+      // the end of the block. Don't call this while processing.
+      void setNumVoiceThreads(int num_threads);
+      int getNumVoiceThreads();
+
+      // Runs the voice copies of _processor_ through _bank_ together instead
+      // of one voice at a time. Every voice runs up to _processor_ first and
+      // finishes after the bank, so voices are isolated like they are for
+      // parallel rendering. _processor_ has to be a direct child of the
+      // voice router. Parallel rendering takes precedence when it's on.
+      void setVoiceBank(const Processor* processor, VoiceBank bank);
+
     protected:
       virtual bool shouldAccumulate(Output* output);
 
     private:
-      VoiceHandler() { }
+      class VoiceTask : public WorkerPool::Task {
+        public:
+          VoiceTask(VoiceHandler* handler) : handler_(handler) { }
+          void runTask(int index) override;
+
+        private:
+          VoiceHandler* handler_;
+      };
+
+      VoiceHandler() : voice_workers_(nullptr), voice_task_(this),
+                       bank_processor_(nullptr), voice_bank_(nullptr) { }
 
       Voice* grabVoice();
       Voice* getVoiceToKill();
@@ -200,14 +263,22 @@ namespace mopo {
       void processVoice(Voice* voice);
       void clearAccumulatedOutputs();
       void clearNonaccumulatedOutputs();
-      void accumulateOutputs();
-      void writeNonaccumulatedOutputs();
+      void accumulateOutputs(Voice* voice);
+      void writeNonaccumulatedOutputs(Voice* voice);
+      void processVoicesInParallel();
+      void processVoicesInBank();
+      void finishVoiceBatch();
+      void isolateVoice(Voice* voice);
+      void collectReadOutputs();
+      void isolateVoices();
+      bool isolatesVoices() const { return voice_workers_ || voice_bank_; }
 
       size_t polyphony_;
       bool sustain_;
       bool legato_;
       std::map<Output*, Output*> last_voice_outputs_;
       std::map<Output*, Output*> accumulated_outputs_;
+      std::vector<const Output*> read_outputs_;
       const Output* voice_killer_;
       mopo_float last_played_note_;
       int last_num_voices_;
@@ -223,11 +294,24 @@ namespace mopo {
       CircularQueue<mopo_float> pressed_notes_;
       CircularQueue<Voice*> all_voices_;
 
+      // Every voice's processors, ports and isolated buffers live here in
+      // the order they run. It's freed with all of the voices at once.
+      ProcessorArena voice_arena_;
+
       CircularQueue<Voice*> free_voices_;
       CircularQueue<Voice*> active_voices_;
 
       ProcessorRouter voice_router_;
       ProcessorRouter global_router_;
+
+      WorkerPool* voice_workers_;
+      VoiceTask voice_task_;
+      std::vector<Output*> trigger_outputs_;
+      std::vector<Voice*> parallel_voices_;
+
+      const Processor* bank_processor_;
+      VoiceBank voice_bank_;
+      std::vector<Processor*> bank_processors_;
   };
 } // namespace mopo
 
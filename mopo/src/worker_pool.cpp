@@ -0,0 +1,205 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * mopo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mopo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mopo.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "worker_pool.h"
+
+#include "utils.h"
+
+#if defined(_WIN32)
+  #include <windows.h>
+#elif defined(__APPLE__)
+  #include <dispatch/dispatch.h>
+#else
+  #include <semaphore.h>
+  #include <cerrno>
+#endif
+
+#define MAX_IDLE_SPINS 4096
+#define GENERATION_SHIFT 32
+#define OPEN_BIT (1ULL << 31)
+#define WORKER_MASK (OPEN_BIT - 1)
+
+namespace mopo {
+
+#if defined(_WIN32)
+  WorkerPool::Semaphore::Semaphore() {
+    handle_ = CreateSemaphore(nullptr, 0, MAXLONG, nullptr);
+  }
+
+  WorkerPool::Semaphore::~Semaphore() {
+    CloseHandle(handle_);
+  }
+
+  void WorkerPool::Semaphore::signal(int count) {
+    ReleaseSemaphore(handle_, count, nullptr);
+  }
+
+  void WorkerPool::Semaphore::wait() {
+    WaitForSingleObject(handle_, INFINITE);
+  }
+#elif defined(__APPLE__)
+  WorkerPool::Semaphore::Semaphore() {
+    handle_ = dispatch_semaphore_create(0);
+  }
+
+  WorkerPool::Semaphore::~Semaphore() {
+    dispatch_release(static_cast<dispatch_semaphore_t>(handle_));
+  }
+
+  void WorkerPool::Semaphore::signal(int count) {
+    for (int i = 0; i < count; ++i)
+      dispatch_semaphore_signal(static_cast<dispatch_semaphore_t>(handle_));
+  }
+
+  void WorkerPool::Semaphore::wait() {
+    dispatch_semaphore_wait(static_cast<dispatch_semaphore_t>(handle_), DISPATCH_TIME_FOREVER);
+  }
+#else
+  WorkerPool::Semaphore::Semaphore() {
+    sem_t* semaphore = new sem_t;
+    sem_init(semaphore, 0, 0);
+    handle_ = semaphore;
+  }
+
+  WorkerPool::Semaphore::~Semaphore() {
+    sem_t* semaphore = static_cast<sem_t*>(handle_);
+    sem_destroy(semaphore);
+    delete semaphore;
+  }
+
+  void WorkerPool::Semaphore::signal(int count) {
+    for (int i = 0; i < count; ++i)
+      sem_post(static_cast<sem_t*>(handle_));
+  }
+
+  void WorkerPool::Semaphore::wait() {
+    while (sem_wait(static_cast<sem_t*>(handle_)) && errno == EINTR)
+      ;
+  }
+#endif
+
+  WorkerPool::WorkerPool(int num_threads) : quit_(false), sleeping_(0), state_(0),
+                                            task_(nullptr), num_tasks_(0),
+                                            next_task_(0), finished_tasks_(0) {
+    for (int i = 1; i < num_threads; ++i)
+      threads_.push_back(std::thread(&WorkerPool::workerLoop, this));
+  }
+
+  WorkerPool::~WorkerPool() {
+    quit_ = true;
+    wakeSleeping();
+
+    for (std::thread& thread : threads_)
+      thread.join();
+  }
+
+  void WorkerPool::run(Task* task, int num_tasks) {
+    begin(task, num_tasks);
+    finish();
+  }
+
+  void WorkerPool::begin(Task* task, int num_tasks) {
+    // No worker can be inside a batch here so it's safe to set up the next.
+    task_ = task;
+    num_tasks_ = num_tasks;
+    next_task_ = 0;
+    finished_tasks_ = 0;
+
+    if (threads_.empty())
+      return;
+
+    unsigned long long generation = (state_ >> GENERATION_SHIFT) + 1;
+    state_ = (generation << GENERATION_SHIFT) | OPEN_BIT;
+
+    wakeSleeping();
+  }
+
+  void WorkerPool::finish() {
+    work();
+    if (threads_.empty())
+      return;
+
+    while (finished_tasks_ < num_tasks_)
+      std::this_thread::yield();
+
+    // Close the batch and wait for stragglers to leave before returning.
+    state_ &= ~OPEN_BIT;
+    while (state_ & WORKER_MASK)
+      std::this_thread::yield();
+  }
+
+  void WorkerPool::work() {
+    for (int i = next_task_++; i < num_tasks_; i = next_task_++) {
+      task_->runTask(i);
+      finished_tasks_++;
+    }
+  }
+
+  void WorkerPool::wakeSleeping() {
+    int sleeping = sleeping_.exchange(0);
+    if (sleeping)
+      wake_.signal(sleeping);
+  }
+
+  // Workers count themselves as sleeping before looking for work one last
+  // time. Anything published after that look sees the count and signals.
+  void WorkerPool::sleep(unsigned int generation) {
+    sleeping_++;
+    if (quit_ || hasNewBatch(generation)) {
+      // Take the count back unless someone already took it and will signal.
+      int sleeping = sleeping_;
+      while (sleeping > 0 && !sleeping_.compare_exchange_weak(sleeping, sleeping - 1))
+        ;
+      if (sleeping > 0)
+        return;
+    }
+    wake_.wait();
+  }
+
+  bool WorkerPool::hasNewBatch(unsigned int generation) {
+    unsigned long long state = state_;
+    return (state & OPEN_BIT) && (state >> GENERATION_SHIFT) != generation;
+  }
+
+  void WorkerPool::workerLoop() {
+    utils::enableDenormalFlushing(true);
+
+    unsigned int generation = 0;
+    int idle_spins = 0;
+
+    while (!quit_) {
+      unsigned long long state = state_;
+      bool open = state & OPEN_BIT;
+      unsigned int state_generation = state >> GENERATION_SHIFT;
+
+      if (open && state_generation != generation) {
+        // Only join if the batch is still open when we register.
+        if (state_.compare_exchange_weak(state, state + 1)) {
+          generation = state_generation;
+          work();
+          state_--;
+          idle_spins = 0;
+        }
+      }
+      else if (idle_spins++ < MAX_IDLE_SPINS)
+        std::this_thread::yield();
+      else {
+        sleep(generation);
+        idle_spins = 0;
+      }
+    }
+  }
+} // namespace mopo
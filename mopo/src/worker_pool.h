@@ -0,0 +1,96 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * mopo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mopo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mopo.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace mopo {
+
+  // A fixed set of threads that work through a batch of indexed tasks.
+  // The thread calling run() helps with the batch and returns once every
+  // task is finished. Batches are published through an atomic generation
+  // and sleeping workers are woken with a semaphore, so the calling thread
+  // never allocates or takes a lock.
+  class WorkerPool {
+    public:
+      class Task {
+        public:
+          virtual ~Task() { }
+          virtual void runTask(int index) = 0;
+      };
+
+      // _num_threads_ counts the calling thread, so a pool of 1 starts no
+      // extra threads and just runs the batch in place.
+      WorkerPool(int num_threads);
+      virtual ~WorkerPool();
+
+      int numThreads() const { return threads_.size() + 1; }
+
+      void run(Task* task, int num_tasks);
+
+      // run() split in two so the calling thread can do other work while the
+      // batch runs. finish() helps with any tasks no worker has picked up and
+      // returns once the batch is done. Every begin() needs a finish().
+      void begin(Task* task, int num_tasks);
+      void finish();
+
+    private:
+      // Counting semaphore from the OS. Signalling it doesn't lock.
+      class Semaphore {
+        public:
+          Semaphore();
+          ~Semaphore();
+
+          void signal(int count);
+          void wait();
+
+        private:
+          void* handle_;
+      };
+
+      WorkerPool() { }
+
+      void workerLoop();
+      void work();
+      void sleep(unsigned int generation);
+      void wakeSleeping();
+      bool hasNewBatch(unsigned int generation);
+
+      std::vector<std::thread> threads_;
+      Semaphore wake_;
+      std::atomic<bool> quit_;
+
+      // Workers that are about to wait on wake_. Whoever takes the count
+      // signals that many times.
+      std::atomic<int> sleeping_;
+
+      // Top 32 bits count batches, the next bit is set while a batch can be
+      // joined and the bottom bits count workers inside the current batch.
+      std::atomic<unsigned long long> state_;
+
+      Task* task_;
+      int num_tasks_;
+      std::atomic<int> next_task_;
+      std::atomic<int> finished_tasks_;
+  };
+} // namespace mopo
+
+#endif // WORKER_POOL_H
@@ -0,0 +1,442 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * helm is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * helm is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with helm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "JuceHeader.h"
+#include "helm_common.h"
+#include "synth_base.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#define DEFAULT_SAMPLE_RATE 44100
+#define DEFAULT_BUFFER_SIZE 256
+#define DEFAULT_SECONDS 10.0
+#define MIDI_TAIL_SECONDS 2.0
+#define PATTERN_BEAT_SECONDS 0.5
+#define PATTERN_GATE 0.75
+#define PATTERN_VELOCITY 0.8f
+#define LOADER_STOP_MILLISECONDS 2000
+#define DEFAULT_MAX_DRIFT_DB -60.0
+#define REFERENCE_BITS 32
+
+namespace {
+
+  const int PATTERN_ROOTS[] = { 48, 53, 55, 50, 45, 52, 57, 43 };
+  const int PATTERN_CHORD[] = { 0, 7, 12, 16 };
+
+  struct Options {
+    Options() : sample_rate(DEFAULT_SAMPLE_RATE), buffer_size(DEFAULT_BUFFER_SIZE),
+                seconds(DEFAULT_SECONDS), threads(0), filter_bank(false), pipeline_effects(false), max_drift_db(DEFAULT_MAX_DRIFT_DB) { }
+
+    int sample_rate;
+    int buffer_size;
+    double seconds;
+    int threads;
+    bool filter_bank;
+    bool pipeline_effects;
+    double max_drift_db;
+    File midi_file;
+    File write_reference;
+    File compare_reference;
+    Array<File> patches;
+  };
+
+  struct RenderResult {
+    double real_time_factor;
+    double block_micros[4];
+    int max_voices;
+    double average_voices;
+  };
+
+  // Runs the synth without audio devices or a GUI so it can be timed.
+  class HeadlessSynth : public SynthBase {
+    public:
+      HeadlessSynth() {
+        // Program changes aren't used so don't index the banks while timing.
+        patch_loader_->stopThread(LOADER_STOP_MILLISECONDS);
+      }
+
+      void prepare(const Options& options) {
+        engine_.setSampleRate(options.sample_rate);
+        engine_.setBufferSize(options.buffer_size);
+        engine_.updateAllModulationSwitches();
+        midi_manager_->setSampleRate(options.sample_rate);
+        if (options.threads > 0)
+          engine_.setNumVoiceThreads(options.threads);
+        if (options.filter_bank)
+          engine_.setFilterBank(true);
+        if (options.pipeline_effects)
+          engine_.setPipelinedEffects(true, options.buffer_size);
+      }
+
+      void renderBlock(AudioSampleBuffer* buffer, MidiBuffer& midi, int samples) {
+        processControlChanges();
+        processModulationChanges();
+        processAudioAndMidi(buffer, mopo::NUM_CHANNELS, samples, midi);
+      }
+
+      // Stands in for the timer that hands effects their memory in the
+      // plugin so renders don't depend on how long blocks take.
+      void updateEffectMemory() { mopo::LazyMemory::updateAll(); }
+
+      int getNumActiveVoices() { return engine_.getNumActiveVoices(); }
+
+#if MOPO_PROFILE
+      void getProfile(std::vector<mopo::Profiler::Stats>& stats) { engine_.getProfile(stats); }
+#endif
+
+    protected:
+      const CriticalSection& getCriticalSection() override { return critical_section_; }
+      SynthGuiInterface* getGuiInterface() override { return nullptr; }
+
+    private:
+      CriticalSection critical_section_;
+  };
+
+  void printUsage() {
+    std::cout << "Usage:" << std::endl;
+    std::cout << "  helm_bench [OPTION...] [PATCH_OR_FOLDER...]" << std::endl << std::endl;
+    std::cout << "Renders every patch offline and prints one tab separated line per patch." << std::endl;
+    std::cout << "Folders are searched for patches. With no patches the init patch is used." << std::endl << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  --sample-rate RATE    Sample rate to render at (default 44100)" << std::endl;
+    std::cout << "  --buffer-size SIZE    Samples per block (default 256)" << std::endl;
+    std::cout << "  --seconds SECONDS     Length of the synthetic note pattern (default 10)" << std::endl;
+    std::cout << "  --midi FILE           Play a MIDI file instead of the note pattern" << std::endl;
+    std::cout << "  --threads COUNT       Render voices on this many threads" << std::endl;
+    std::cout << "  --filter-bank         Run every voice's filter together in one bank" << std::endl;
+    std::cout << "  --pipeline-effects    Render effects a block behind on their own thread" << std::endl;
+    std::cout << "  --write-reference DIR Save each render to DIR as a 32 bit wav" << std::endl;
+    std::cout << "  --compare DIR         Report drift against the renders saved in DIR" << std::endl;
+    std::cout << "  --max-drift DB        Fail patches drifting more than this (default -60)" << std::endl;
+    std::cout << "  -h, --help            Show this help" << std::endl;
+  }
+
+  bool parseOptions(const StringArray& args, Options& options) {
+    for (int i = 0; i < args.size(); ++i) {
+      String arg = args[i];
+      bool has_value = i + 1 < args.size();
+
+      if (arg == "-h" || arg == "--help")
+        return false;
+      else if (arg == "--sample-rate" && has_value)
+        options.sample_rate = args[++i].getIntValue();
+      else if (arg == "--buffer-size" && has_value)
+        options.buffer_size = args[++i].getIntValue();
+      else if (arg == "--seconds" && has_value)
+        options.seconds = args[++i].getDoubleValue();
+      else if (arg == "--midi" && has_value)
+        options.midi_file = File::getCurrentWorkingDirectory().getChildFile(args[++i]);
+      else if (arg == "--threads" && has_value)
+        options.threads = args[++i].getIntValue();
+      else if (arg == "--filter-bank")
+        options.filter_bank = true;
+      else if (arg == "--pipeline-effects")
+        options.pipeline_effects = true;
+      else if (arg == "--write-reference" && has_value)
+        options.write_reference = File::getCurrentWorkingDirectory().getChildFile(args[++i]);
+      else if (arg == "--compare" && has_value)
+        options.compare_reference = File::getCurrentWorkingDirectory().getChildFile(args[++i]);
+      else if (arg == "--max-drift" && has_value)
+        options.max_drift_db = args[++i].getDoubleValue();
+      else if (arg.startsWith("-")) {
+        std::cerr << "Unknown option " << arg << std::endl;
+        return false;
+      }
+      else {
+        File file = File::getCurrentWorkingDirectory().getChildFile(arg);
+        if (file.isDirectory()) {
+          Array<File> patches;
+          file.findChildFiles(patches, File::findFiles, true,
+                              String("*.") + mopo::PATCH_EXTENSION);
+          patches.sort();
+          options.patches.addArray(patches);
+        }
+        else
+          options.patches.add(file);
+      }
+    }
+
+    options.buffer_size = mopo::utils::iclamp(options.buffer_size, 1, mopo::MAX_BUFFER_SIZE);
+    return options.sample_rate > 0 && options.seconds > 0.0;
+  }
+
+  // Timestamps of the returned sequence are in samples.
+  bool loadMidiFile(File file, int sample_rate, MidiMessageSequence& sequence) {
+    FileInputStream stream(file);
+    MidiFile midi_file;
+    if (!stream.openedOk() || !midi_file.readFrom(stream))
+      return false;
+
+    midi_file.convertTimestampTicksToSeconds();
+    for (int i = 0; i < midi_file.getNumTracks(); ++i)
+      sequence.addSequence(*midi_file.getTrack(i), 0.0);
+
+    for (int i = 0; i < sequence.getNumEvents(); ++i) {
+      MidiMessage& message = sequence.getEventPointer(i)->message;
+      message.setTimeStamp(message.getTimeStamp() * sample_rate);
+    }
+    sequence.updateMatchedPairs();
+    return true;
+  }
+
+  // Cycles through chords so voices keep starting, sustaining and releasing.
+  void createPattern(double seconds, int sample_rate, MidiMessageSequence& sequence) {
+    int num_beats = seconds / PATTERN_BEAT_SECONDS;
+    int num_roots = sizeof(PATTERN_ROOTS) / sizeof(int);
+    int chord_size = sizeof(PATTERN_CHORD) / sizeof(int);
+
+    for (int beat = 0; beat < num_beats; ++beat) {
+      double on_time = beat * PATTERN_BEAT_SECONDS * sample_rate;
+      double off_time = on_time + PATTERN_GATE * PATTERN_BEAT_SECONDS * sample_rate;
+      int root = PATTERN_ROOTS[beat % num_roots];
+
+      for (int i = 0; i < chord_size; ++i) {
+        int note = root + PATTERN_CHORD[i];
+        sequence.addEvent(MidiMessage::noteOn(1, note, PATTERN_VELOCITY), on_time);
+        sequence.addEvent(MidiMessage::noteOff(1, note), off_time);
+      }
+    }
+    sequence.updateMatchedPairs();
+  }
+
+  double getPercentile(const std::vector<double>& sorted, double percentile) {
+    int index = percentile * (sorted.size() - 1) + 0.5;
+    return sorted[index];
+  }
+
+  // Reference renders are named by position so patches with the same name in
+  // different folders don't collide. Run with the same arguments to compare.
+  File getReferenceFile(File directory, int index, const String& name) {
+    return directory.getChildFile(String(index) + "_" + File::createLegalFileName(name) + ".wav");
+  }
+
+  bool writeReference(File file, const AudioSampleBuffer& audio, int sample_rate) {
+    file.deleteFile();
+    ScopedPointer<FileOutputStream> stream(file.createOutputStream());
+    if (stream == nullptr)
+      return false;
+
+    WavAudioFormat format;
+    ScopedPointer<AudioFormatWriter> writer(
+        format.createWriterFor(stream, sample_rate, audio.getNumChannels(),
+                               REFERENCE_BITS, StringPairArray(), 0));
+    if (writer == nullptr)
+      return false;
+
+    stream.release();
+    return writer->writeFromAudioSampleBuffer(audio, 0, audio.getNumSamples());
+  }
+
+  bool readReference(File file, AudioSampleBuffer& audio) {
+    WavAudioFormat format;
+    ScopedPointer<AudioFormatReader> reader(
+        format.createReaderFor(file.createInputStream(), true));
+    if (reader == nullptr)
+      return false;
+
+    audio.setSize(reader->numChannels, reader->lengthInSamples);
+    reader->read(&audio, 0, reader->lengthInSamples, 0, true, true);
+    return true;
+  }
+
+  // Error energy relative to the reference energy in dB. Silent references
+  // are compared against full scale instead.
+  double getDriftDb(const AudioSampleBuffer& audio, const AudioSampleBuffer& reference) {
+    if (audio.getNumChannels() != reference.getNumChannels() ||
+        audio.getNumSamples() != reference.getNumSamples()) {
+      return 0.0;
+    }
+
+    double error = 0.0;
+    double signal = 0.0;
+    for (int channel = 0; channel < audio.getNumChannels(); ++channel) {
+      const float* samples = audio.getReadPointer(channel);
+      const float* expected = reference.getReadPointer(channel);
+      for (int i = 0; i < audio.getNumSamples(); ++i) {
+        double delta = 1.0 * samples[i] - expected[i];
+        error += delta * delta;
+        signal += 1.0 * expected[i] * expected[i];
+      }
+    }
+
+    if (signal <= 0.0)
+      signal = audio.getNumChannels() * audio.getNumSamples();
+    if (error <= 0.0)
+      return -INFINITY;
+    return 10.0 * log10(error / signal);
+  }
+
+  RenderResult render(HeadlessSynth& synth, const MidiMessageSequence& sequence,
+                int total_samples, const Options& options, AudioSampleBuffer* capture) {
+    AudioSampleBuffer buffer(mopo::NUM_CHANNELS, options.buffer_size);
+    MidiBuffer midi;
+    std::vector<double> block_times;
+    block_times.reserve(total_samples / options.buffer_size + 1);
+
+    RenderResult result;
+    result.max_voices = 0;
+    long long total_voices = 0;
+    int event_index = 0;
+    double total_seconds = 0.0;
+
+    for (int offset = 0; offset < total_samples; offset += options.buffer_size) {
+      int samples = std::min(options.buffer_size, total_samples - offset);
+
+      midi.clear();
+      for (; event_index < sequence.getNumEvents(); ++event_index) {
+        const MidiMessage& message = sequence.getEventPointer(event_index)->message;
+        int time = message.getTimeStamp();
+        if (time >= offset + samples)
+          break;
+        midi.addEvent(message, time - offset);
+      }
+
+      auto start = std::chrono::high_resolution_clock::now();
+      synth.renderBlock(&buffer, midi, samples);
+      auto end = std::chrono::high_resolution_clock::now();
+
+      double seconds = std::chrono::duration<double>(end - start).count();
+      total_seconds += seconds;
+      block_times.push_back(seconds * 1000000.0);
+      synth.updateEffectMemory();
+
+      if (capture) {
+        for (int channel = 0; channel < mopo::NUM_CHANNELS; ++channel)
+          capture->copyFrom(channel, offset, buffer, channel, 0, samples);
+      }
+
+      int voices = synth.getNumActiveVoices();
+      result.max_voices = std::max(result.max_voices, voices);
+      total_voices += voices;
+    }
+
+    std::sort(block_times.begin(), block_times.end());
+    result.real_time_factor = total_samples / (options.sample_rate * total_seconds);
+    result.block_micros[0] = getPercentile(block_times, 0.5);
+    result.block_micros[1] = getPercentile(block_times, 0.9);
+    result.block_micros[2] = getPercentile(block_times, 0.99);
+    result.block_micros[3] = block_times.back();
+    result.average_voices = (1.0 * total_voices) / block_times.size();
+    return result;
+  }
+} // namespace
+
+int main(int argc, char** argv) {
+  StringArray args;
+  for (int i = 1; i < argc; ++i)
+    args.add(argv[i]);
+
+  Options options;
+  if (!parseOptions(args, options)) {
+    printUsage();
+    return 1;
+  }
+
+  MidiMessageSequence sequence;
+  int total_samples = options.seconds * options.sample_rate;
+  if (options.midi_file != File()) {
+    if (!loadMidiFile(options.midi_file, options.sample_rate, sequence)) {
+      std::cerr << "Couldn't read MIDI file " << options.midi_file.getFullPathName() << std::endl;
+      return 1;
+    }
+    total_samples = sequence.getEndTime() + MIDI_TAIL_SECONDS * options.sample_rate;
+  }
+  else
+    createPattern(options.seconds, options.sample_rate, sequence);
+
+  if (options.patches.size() == 0)
+    options.patches.add(File());
+
+  bool capture = options.write_reference != File() || options.compare_reference != File();
+  if (options.write_reference != File() && !options.write_reference.createDirectory()) {
+    std::cerr << "Couldn't create " << options.write_reference.getFullPathName() << std::endl;
+    return 1;
+  }
+
+  std::cout << "patch\trtf\tp50_us\tp90_us\tp99_us\tmax_us\tmax_voices\tavg_voices";
+  if (options.compare_reference != File())
+    std::cout << "\tdrift_db";
+  std::cout << std::endl;
+
+  int failures = 0;
+  for (int index = 0; index < options.patches.size(); ++index) {
+    File patch = options.patches[index];
+    // Seed every random generator the synth creates so runs are repeatable.
+    mopo::RandomGenerator::seedAll(1);
+
+    HeadlessSynth synth;
+    synth.prepare(options);
+    String name = "init";
+    if (patch != File()) {
+      name = patch.getFullPathName();
+      if (!synth.loadFromFile(patch)) {
+        std::cerr << "Couldn't load patch " << name << std::endl;
+        failures++;
+        continue;
+      }
+    }
+
+    AudioSampleBuffer audio(mopo::NUM_CHANNELS, capture ? total_samples : 0);
+    RenderResult result = render(synth, sequence, total_samples, options,
+                                 capture ? &audio : nullptr);
+    std::cout << name << "\t" << String(result.real_time_factor, 2);
+    for (int i = 0; i < 4; ++i)
+      std::cout << "\t" << String(result.block_micros[i], 1);
+    std::cout << "\t" << result.max_voices << "\t" << String(result.average_voices, 2);
+
+    String reference_name = patch == File() ? name : patch.getFileNameWithoutExtension();
+    if (options.compare_reference != File()) {
+      AudioSampleBuffer reference;
+      File file = getReferenceFile(options.compare_reference, index, reference_name);
+      double drift = readReference(file, reference) ? getDriftDb(audio, reference) : 0.0;
+      std::cout << "\t" << String(drift, 1);
+      if (drift > options.max_drift_db)
+        failures++;
+    }
+    std::cout << std::endl;
+
+    if (options.write_reference != File()) {
+      File file = getReferenceFile(options.write_reference, index, reference_name);
+      if (!writeReference(file, audio, options.sample_rate)) {
+        std::cerr << "Couldn't write " << file.getFullPathName() << std::endl;
+        failures++;
+      }
+    }
+
+#if MOPO_PROFILE
+    // Averages per block, indented under the patch so the table still parses.
+    std::vector<mopo::Profiler::Stats> stats;
+    synth.getProfile(stats);
+    std::sort(stats.begin(), stats.end(),
+              [](const mopo::Profiler::Stats& a, const mopo::Profiler::Stats& b) {
+                return a.cycles > b.cycles;
+              });
+    for (const mopo::Profiler::Stats& stat : stats) {
+      if (stat.calls > 0.0) {
+        std::cout << "#\t" << (stat.module ? "module " : "") << stat.name << "\t"
+                  << String(stat.cycles, 0) << "\t" << String(stat.calls, 2) << std::endl;
+      }
+    }
+#endif
+  }
+
+  return failures ? 1 : 0;
+}
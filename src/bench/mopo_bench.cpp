@@ -0,0 +1,405 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * helm is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * helm is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with helm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "mopo.h"
+#include "fixed_point_oscillator.h"
+#include "helm_lfo.h"
+#include "helm_oscillators.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define DEFAULT_SECONDS 0.5
+#define DEFAULT_REPETITIONS 5
+#define WARMUP_BLOCKS 32
+#define TRIGGER_PERIOD_BLOCKS 64
+#define NOISE_SEED 1
+
+namespace {
+
+  using namespace mopo;
+
+  const int DEFAULT_SAMPLE_RATES[] = { 44100, 48000, 96000, 192000 };
+  const int DEFAULT_BUFFER_SIZES[] = { 16, 32, 64, 128, 256 };
+
+  struct Options {
+    Options() : seconds(DEFAULT_SECONDS), repetitions(DEFAULT_REPETITIONS) {
+      sample_rates.assign(std::begin(DEFAULT_SAMPLE_RATES), std::end(DEFAULT_SAMPLE_RATES));
+      buffer_sizes.assign(std::begin(DEFAULT_BUFFER_SIZES), std::end(DEFAULT_BUFFER_SIZES));
+    }
+
+    double seconds;
+    int repetitions;
+    std::vector<int> sample_rates;
+    std::vector<int> buffer_sizes;
+    std::vector<std::string> filters;
+  };
+
+  // Signals the processor under test reads from. Audio inputs get white
+  // noise, parameters get constant full buffers so both audio and control
+  // rate reads see the value, and envelopes get a note on and off each
+  // trigger period.
+  class Sources {
+    public:
+      Sources() {
+        RandomGenerator random;
+        for (int i = 0; i < MAX_BUFFER_SIZE; ++i)
+          noise_.buffer[i] = random.nextBipolar();
+      }
+
+      const Output* noise() const { return &noise_; }
+      const Output* trigger() const { return &trigger_; }
+
+      const Processor* value(mopo_float value) {
+        values_.push_back(std::unique_ptr<Value>(new Value(value)));
+        return values_.back().get();
+      }
+
+      void updateTrigger(int block) {
+        int phase = block % TRIGGER_PERIOD_BLOCKS;
+        if (phase == 0)
+          trigger_.trigger(kVoiceOn);
+        else if (phase == TRIGGER_PERIOD_BLOCKS / 2)
+          trigger_.trigger(kVoiceOff);
+        else
+          trigger_.clearTrigger();
+      }
+
+    private:
+      Output noise_;
+      Output trigger_;
+      std::vector<std::unique_ptr<Value>> values_;
+  };
+
+  struct Benchmark {
+    std::string module;
+    std::string variant;
+    std::function<Processor*(Sources&, int sample_rate)> create;
+  };
+
+  Processor* createStateVariableFilter(Sources& sources, int style) {
+    StateVariableFilter* filter = new StateVariableFilter();
+    filter->plug(sources.noise(), StateVariableFilter::kAudio);
+    filter->plug(sources.value(1.0), StateVariableFilter::kOn);
+    filter->plug(sources.value(style), StateVariableFilter::kStyle);
+    filter->plug(sources.value(0.5), StateVariableFilter::kPassBlend);
+    filter->plug(sources.value(StateVariableFilter::kBandShelf), StateVariableFilter::kShelfChoice);
+    filter->plug(sources.value(2000.0), StateVariableFilter::kCutoff);
+    filter->plug(sources.value(2.0), StateVariableFilter::kResonance);
+    filter->plug(sources.value(1.0), StateVariableFilter::kGain);
+    filter->plug(sources.value(1.0), StateVariableFilter::kDrive);
+    return filter;
+  }
+
+  Processor* createBiquadFilter(Sources& sources, int type) {
+    BiquadFilter* filter = new BiquadFilter();
+    filter->plug(sources.noise(), BiquadFilter::kAudio);
+    filter->plug(sources.value(type), BiquadFilter::kType);
+    filter->plug(sources.value(2000.0), BiquadFilter::kCutoff);
+    filter->plug(sources.value(2.0), BiquadFilter::kResonance);
+    filter->plug(sources.value(1.0), BiquadFilter::kGain);
+    return filter;
+  }
+
+  Processor* createFormantManager(Sources& sources) {
+    static const mopo_float cutoffs[] = { 700.0, 1200.0, 2600.0, 3500.0 };
+
+    FormantManager* formants = new FormantManager(4);
+    formants->plug(sources.noise(), FormantManager::kAudio);
+    for (int i = 0; i < formants->num_formants(); ++i) {
+      BiquadFilter* formant = formants->getFormant(i);
+      formant->plug(sources.value(BiquadFilter::kGainedBandPass), BiquadFilter::kType);
+      formant->plug(sources.value(cutoffs[i]), BiquadFilter::kCutoff);
+      formant->plug(sources.value(8.0), BiquadFilter::kResonance);
+      formant->plug(sources.value(0.5), BiquadFilter::kGain);
+    }
+    return formants;
+  }
+
+  Processor* createHelmOscillators(Sources& sources, int sample_rate, int voices) {
+    mopo_float phase_inc = 220.0 / sample_rate;
+
+    HelmOscillators* oscillators = new HelmOscillators();
+    oscillators->plug(sources.value(FixedPointWaveLookup::kDownSaw),
+                      HelmOscillators::kOscillator1Waveform);
+    oscillators->plug(sources.value(FixedPointWaveLookup::kSquare),
+                      HelmOscillators::kOscillator2Waveform);
+    oscillators->plug(sources.value(phase_inc), HelmOscillators::kOscillator1PhaseInc);
+    oscillators->plug(sources.value(1.5 * phase_inc), HelmOscillators::kOscillator2PhaseInc);
+    oscillators->plug(sources.value(0.5), HelmOscillators::kOscillator1Amplitude);
+    oscillators->plug(sources.value(0.5), HelmOscillators::kOscillator2Amplitude);
+    oscillators->plug(sources.value(voices), HelmOscillators::kUnisonVoices1);
+    oscillators->plug(sources.value(voices), HelmOscillators::kUnisonVoices2);
+    oscillators->plug(sources.value(20.0), HelmOscillators::kUnisonDetune1);
+    oscillators->plug(sources.value(20.0), HelmOscillators::kUnisonDetune2);
+    oscillators->plug(sources.value(0.0), HelmOscillators::kHarmonize1);
+    oscillators->plug(sources.value(0.0), HelmOscillators::kHarmonize2);
+    oscillators->plug(sources.value(0.1), HelmOscillators::kCrossMod);
+    return oscillators;
+  }
+
+  Processor* createFixedPointOscillator(Sources& sources, int sample_rate) {
+    FixedPointOscillator* oscillator = new FixedPointOscillator();
+    oscillator->plug(sources.value(FixedPointWaveLookup::kDownSaw),
+                     FixedPointOscillator::kWaveform);
+    oscillator->plug(sources.value(110.0 / sample_rate), FixedPointOscillator::kPhaseInc);
+    oscillator->plug(sources.value(0.0), FixedPointOscillator::kShuffle);
+    oscillator->plug(sources.value(0.5), FixedPointOscillator::kAmplitude);
+    oscillator->plug(sources.value(0.0), FixedPointOscillator::kLowOctave);
+    return oscillator;
+  }
+
+  Processor* createDelay(Sources& sources, int sample_rate) {
+    Delay* delay = new Delay(1.0);
+    delay->plug(sources.noise(), Delay::kAudio);
+    delay->plug(sources.value(0.5), Delay::kWet);
+    delay->plug(sources.value(0.3 * sample_rate), Delay::kSampleDelay);
+    delay->plug(sources.value(0.4), Delay::kFeedback);
+    return delay;
+  }
+
+  Processor* createReverb(Sources& sources) {
+    Reverb* reverb = new Reverb();
+    reverb->plug(sources.noise(), Reverb::kAudio);
+    reverb->plug(sources.value(0.8), Reverb::kFeedback);
+    reverb->plug(sources.value(0.5), Reverb::kDamping);
+    reverb->plug(sources.value(0.5), Reverb::kStereoWidth);
+    reverb->plug(sources.value(0.5), Reverb::kWet);
+    return reverb;
+  }
+
+  Processor* createStutter(Sources& sources) {
+    Stutter* stutter = new Stutter(1.0);
+    stutter->plug(sources.noise(), Stutter::kAudio);
+    stutter->plug(sources.value(8.0), Stutter::kStutterFrequency);
+    stutter->plug(sources.value(2.0), Stutter::kResampleFrequency);
+    stutter->plug(sources.value(0.5), Stutter::kWindowSoftness);
+    return stutter;
+  }
+
+  Processor* createDistortion(Sources& sources, int type) {
+    Distortion* distortion = new Distortion();
+    distortion->plug(sources.noise(), Distortion::kAudio);
+    distortion->plug(sources.value(1.0), Distortion::kOn);
+    distortion->plug(sources.value(type), Distortion::kType);
+    distortion->plug(sources.value(4.0), Distortion::kDrive);
+    distortion->plug(sources.value(0.8), Distortion::kMix);
+    return distortion;
+  }
+
+  Processor* createEnvelope(Sources& sources) {
+    Envelope* envelope = new Envelope();
+    envelope->plug(sources.value(0.01), Envelope::kAttack);
+    envelope->plug(sources.value(0.1), Envelope::kDecay);
+    envelope->plug(sources.value(0.5), Envelope::kSustain);
+    envelope->plug(sources.value(0.2), Envelope::kRelease);
+    envelope->plug(sources.trigger(), Envelope::kTrigger);
+    return envelope;
+  }
+
+  Processor* createHelmLfo(Sources& sources, int waveform) {
+    HelmLfo* lfo = new HelmLfo();
+    lfo->plug(sources.value(2.0), HelmLfo::kFrequency);
+    lfo->plug(sources.value(0.0), HelmLfo::kPhase);
+    lfo->plug(sources.value(waveform), HelmLfo::kWaveform);
+    return lfo;
+  }
+
+  std::vector<Benchmark> createBenchmarks() {
+    std::vector<Benchmark> benchmarks;
+
+    const char* filter_styles[] = { "12db", "24db", "shelf" };
+    for (int style = 0; style < StateVariableFilter::kNumStyles; ++style) {
+      benchmarks.push_back({ "StateVariableFilter", filter_styles[style],
+                             [style](Sources& s, int) { return createStateVariableFilter(s, style); } });
+    }
+
+    benchmarks.push_back({ "BiquadFilter", "low_pass",
+                           [](Sources& s, int) { return createBiquadFilter(s, BiquadFilter::kLowPass); } });
+    benchmarks.push_back({ "FormantManager", "4_formants",
+                           [](Sources& s, int) { return createFormantManager(s); } });
+
+    for (int voices = 1; voices <= HelmOscillators::MAX_UNISON; ++voices) {
+      benchmarks.push_back({ "HelmOscillators", std::to_string(voices) + "_voices",
+                             [voices](Sources& s, int rate) {
+                               return createHelmOscillators(s, rate, voices);
+                             } });
+    }
+
+    benchmarks.push_back({ "FixedPointOscillator", "saw", createFixedPointOscillator });
+    benchmarks.push_back({ "Delay", "feedback", createDelay });
+    benchmarks.push_back({ "Reverb", "stereo", [](Sources& s, int) { return createReverb(s); } });
+    benchmarks.push_back({ "Stutter", "resample", [](Sources& s, int) { return createStutter(s); } });
+
+    const char* distortion_types[] = { "soft_clip", "hard_clip", "linear_fold", "sin_fold" };
+    for (int type = 0; type < Distortion::kNumTypes; ++type) {
+      benchmarks.push_back({ "Distortion", distortion_types[type],
+                             [type](Sources& s, int) { return createDistortion(s, type); } });
+    }
+
+    benchmarks.push_back({ "Envelope", "adsr", [](Sources& s, int) { return createEnvelope(s); } });
+    benchmarks.push_back({ "HelmLfo", "sin",
+                           [](Sources& s, int) { return createHelmLfo(s, Wave::kSin); } });
+    benchmarks.push_back({ "HelmLfo", "smooth_random",
+                           [](Sources& s, int) { return createHelmLfo(s, Wave::kNumWaveforms); } });
+    return benchmarks;
+  }
+
+  void printUsage() {
+    std::cout << "Usage:" << std::endl;
+    std::cout << "  mopo_bench [OPTION...] [MODULE...]" << std::endl << std::endl;
+    std::cout << "Times each processor on its own and prints one tab separated line per" << std::endl;
+    std::cout << "module, sample rate and buffer size. MODULE limits the run to modules" << std::endl;
+    std::cout << "whose name contains it." << std::endl << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  --sample-rates LIST   Comma separated rates (default 44100,48000,96000,192000)" << std::endl;
+    std::cout << "  --buffer-sizes LIST   Comma separated sizes (default 16,32,64,128,256)" << std::endl;
+    std::cout << "  --seconds SECONDS     Audio rendered per repetition (default 0.5)" << std::endl;
+    std::cout << "  --repetitions COUNT   Timed repetitions per line (default 5)" << std::endl;
+    std::cout << "  -h, --help            Show this help" << std::endl;
+  }
+
+  bool parseList(const std::string& text, std::vector<int>& values) {
+    values.clear();
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+      int value = std::atoi(item.c_str());
+      if (value <= 0)
+        return false;
+      values.push_back(value);
+    }
+    return !values.empty();
+  }
+
+  bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+      std::string arg = argv[i];
+      bool has_value = i + 1 < argc;
+
+      if (arg == "-h" || arg == "--help")
+        return false;
+      else if (arg == "--sample-rates" && has_value) {
+        if (!parseList(argv[++i], options.sample_rates))
+          return false;
+      }
+      else if (arg == "--buffer-sizes" && has_value) {
+        if (!parseList(argv[++i], options.buffer_sizes))
+          return false;
+      }
+      else if (arg == "--seconds" && has_value)
+        options.seconds = std::atof(argv[++i]);
+      else if (arg == "--repetitions" && has_value)
+        options.repetitions = std::atoi(argv[++i]);
+      else if (arg.compare(0, 1, "-") == 0) {
+        std::cerr << "Unknown option " << arg << std::endl;
+        return false;
+      }
+      else
+        options.filters.push_back(arg);
+    }
+
+    for (int& buffer_size : options.buffer_sizes)
+      buffer_size = utils::iclamp(buffer_size, 1, MAX_BUFFER_SIZE);
+    return options.seconds > 0.0 && options.repetitions > 0;
+  }
+
+  bool isSelected(const Benchmark& benchmark, const Options& options) {
+    if (options.filters.empty())
+      return true;
+
+    for (const std::string& filter : options.filters) {
+      if (benchmark.module.find(filter) != std::string::npos)
+        return true;
+    }
+    return false;
+  }
+
+  // Returns the median and fastest nanoseconds per sample over the repetitions.
+  void run(const Benchmark& benchmark, int sample_rate, int buffer_size,
+           const Options& options, double* median, double* fastest) {
+    RandomGenerator::seedAll(NOISE_SEED);
+    Sources sources;
+    std::unique_ptr<Processor> processor(benchmark.create(sources, sample_rate));
+    processor->setSampleRate(sample_rate);
+    processor->setBufferSize(buffer_size);
+    processor->compilePlans();
+
+    // Effects get their memory off the audio thread, so hand it over before
+    // and after the first block like the plugin's timer would.
+    LazyMemory::updateAll();
+    int block = 0;
+    for (; block < WARMUP_BLOCKS; ++block) {
+      sources.updateTrigger(block);
+      processor->process();
+      LazyMemory::updateAll();
+    }
+
+    int num_blocks = std::max<int>(1, options.seconds * sample_rate / buffer_size);
+    std::vector<double> times;
+    for (int r = 0; r < options.repetitions; ++r) {
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < num_blocks; ++i, ++block) {
+        sources.updateTrigger(block);
+        processor->process();
+      }
+      auto end = std::chrono::steady_clock::now();
+
+      double nanos = std::chrono::duration<double, std::nano>(end - start).count();
+      times.push_back(nanos / (1.0 * num_blocks * buffer_size));
+    }
+
+    std::sort(times.begin(), times.end());
+    *median = times[times.size() / 2];
+    *fastest = times[0];
+  }
+} // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+
+  std::vector<Benchmark> benchmarks = createBenchmarks();
+  std::cout << "module\tvariant\tsample_rate\tbuffer_size\tns_per_sample\tmin_ns_per_sample" << std::endl;
+
+  for (const Benchmark& benchmark : benchmarks) {
+    if (!isSelected(benchmark, options))
+      continue;
+
+    for (int sample_rate : options.sample_rates) {
+      for (int buffer_size : options.buffer_sizes) {
+        double median = 0.0;
+        double fastest = 0.0;
+        run(benchmark, sample_rate, buffer_size, options, &median, &fastest);
+        std::cout << benchmark.module << "\t" << benchmark.variant << "\t" << sample_rate << "\t"
+                  << buffer_size << "\t" << median << "\t" << fastest << std::endl;
+      }
+    }
+  }
+
+  return 0;
+}
@@ -306,9 +306,9 @@ namespace mopo {
   }
 
   ValueDetailsLookup::ValueDetailsLookup() {
-    int num_parameters = sizeof(parameter_list) / sizeof(ValueDetails);
-    for (int i = 0; i < num_parameters; ++i) {
-      details_lookup_[parameter_list[i].name] = parameter_list[i];
+    num_parameters_ = sizeof(parameter_list) / sizeof(ValueDetails);
+    for (int i = 0; i < num_parameters_; ++i) {
+      id_lookup_[parameter_list[i].name] = i;
 
       MOPO_ASSERT(parameter_list[i].default_value <= parameter_list[i].max);
       MOPO_ASSERT(parameter_list[i].default_value >= parameter_list[i].min);
@@ -24,6 +24,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 namespace mopo {
 
@@ -173,7 +174,7 @@ namespace mopo {
   const int NUM_CHANNELS = 2;
   const int MEMORY_SAMPLE_RATE = 22000;
   const int MEMORY_RESOLUTION = 512;
-  const mopo_float STUTTER_MAX_SAMPLES = 96000.0;
+  const mopo_float STUTTER_MAX_SECONDS = 2.0;
   const int DEFAULT_MODULATION_CONNECTIONS = 256;
   const int DEFAULT_WINDOW_WIDTH = 992;
   const int DEFAULT_WINDOW_HEIGHT = 734;
@@ -186,6 +187,7 @@ namespace mopo {
   const std::string PATCH_EXTENSION = "helm";
 
   typedef std::map<std::string, Value*> control_map;
+  typedef std::vector<Value*> control_list;
   typedef std::pair<Value*, mopo_float> control_change;
   typedef std::pair<ModulationConnection*, mopo_float> modulation_change;
   typedef std::map<std::string, Processor*> input_map;
@@ -260,27 +262,45 @@ namespace mopo {
       int down_key_;
   };
 
+  // Every parameter has a dense id, its index in parameter_list. Ids stay the
+  // same for the life of the process so hot paths can index arrays with them
+  // and only use names when loading, saving or talking to the GUI.
   class ValueDetailsLookup {
     public:
       ValueDetailsLookup();
       const bool isParameter(const std::string& name) const {
-        return details_lookup_.count(name);
+        return id_lookup_.count(name);
+      }
+
+      int getId(const std::string& name) const {
+        auto id = id_lookup_.find(name);
+        MOPO_ASSERT(id != id_lookup_.end());
+        return id->second;
       }
 
       const ValueDetails& getDetails(const std::string& name) const {
-        auto details = details_lookup_.find(name);
-        MOPO_ASSERT(details != details_lookup_.end());
-        return details->second;
+        return parameter_list[getId(name)];
+      }
+
+      const ValueDetails& getDetails(int id) const {
+        MOPO_ASSERT(id >= 0 && id < num_parameters_);
+        return parameter_list[id];
       }
 
+      int getNumParameters() const { return num_parameters_; }
+
       std::map<std::string, ValueDetails> getAllDetails() const {
-        return details_lookup_;
+        std::map<std::string, ValueDetails> all_details;
+        for (int i = 0; i < num_parameters_; ++i)
+          all_details[parameter_list[i].name] = parameter_list[i];
+        return all_details;
       }
 
       static const ValueDetails parameter_list[];
 
     private:
-      std::map<std::string, ValueDetails> details_lookup_;
+      int num_parameters_;
+      std::map<std::string, int> id_lookup_;
   };
 
   class Parameters {
@@ -289,10 +309,22 @@ namespace mopo {
         return lookup_.getDetails(name);
       }
 
+      static const ValueDetails& getDetails(int id) {
+        return lookup_.getDetails(id);
+      }
+
       static const bool isParameter(const std::string& name) {
         return lookup_.isParameter(name);
       }
 
+      static int getId(const std::string& name) {
+        return lookup_.getId(name);
+      }
+
+      static int getNumParameters() {
+        return lookup_.getNumParameters();
+      }
+
       static ValueDetailsLookup lookup_;
   };
 } // namespace mopo
@@ -50,7 +50,7 @@ namespace {
 var LoadSave::stateToVar(SynthBase* synth,
                          std::map<std::string, String>& save_info,
                          const CriticalSection& critical_section) {
-  mopo::control_map controls = synth->getControls();
+  const mopo::control_map& controls = synth->getControls();
   DynamicObject* settings_object = new DynamicObject();
 
   ScopedLock lock(critical_section);
@@ -82,17 +82,19 @@ var LoadSave::stateToVar(SynthBase* synth,
 
 void LoadSave::loadControls(SynthBase* synth,
                             const NamedValueSet& properties) {
-  mopo::control_map controls = synth->getControls();
-  for (auto& control : controls) {
-    String name = control.first;
+  const mopo::control_list& controls = synth->getControlList();
+  for (int id = 0; id < controls.size(); ++id) {
+    if (controls[id] == nullptr)
+      continue;
+
+    const mopo::ValueDetails& details = mopo::Parameters::getDetails(id);
+    String name = details.name;
     if (properties.contains(name)) {
       mopo::mopo_float value = properties[name];
-      control.second->set(value);
-    }
-    else {
-      mopo::ValueDetails details = mopo::Parameters::getDetails(name.toStdString());
-      control.second->set(details.default_value);
+      controls[id]->set(value);
     }
+    else
+      controls[id]->set(details.default_value);
   }
 }
 
@@ -124,10 +126,10 @@ void LoadSave::loadSaveState(std::map<std::string, String>& state,
 void LoadSave::initSynth(SynthBase* synth, std::map<std::string, String>& save_info) {
   synth->clearModulations();
 
-  mopo::control_map controls = synth->getControls();
-  for (auto& control : controls) {
-    mopo::ValueDetails details = mopo::Parameters::getDetails(control.first);
-    control.second->set(details.default_value);
+  const mopo::control_list& controls = synth->getControlList();
+  for (int id = 0; id < controls.size(); ++id) {
+    if (controls[id])
+      controls[id]->set(mopo::Parameters::getDetails(id).default_value);
   }
 
   save_info["author"] = "";
@@ -138,11 +140,25 @@ void LoadSave::initSynth(SynthBase* synth, std::map<std::string, String>& save_i
 void LoadSave::varToState(SynthBase* synth,
                           std::map<std::string, String>& save_info,
                           var state) {
-  if (!state.isObject())
+  NamedValueSet properties;
+  NamedValueSet settings_properties;
+  Array<var>* modulations = nullptr;
+  if (!upgradeState(state, properties, settings_properties, modulations))
     return;
 
+  loadControls(synth, settings_properties);
+  loadModulations(synth, modulations);
+  loadSaveState(save_info, properties);
+}
+
+bool LoadSave::upgradeState(var state, NamedValueSet& properties,
+                            NamedValueSet& settings_properties,
+                            Array<var>*& modulations) {
+  if (!state.isObject())
+    return false;
+
   DynamicObject* object_state = state.getDynamicObject();
-  NamedValueSet properties = object_state->getProperties();
+  properties = object_state->getProperties();
 
   // Version 0.4.1 was the last build before we saved the version number.
   String version = "0.4.1";
@@ -158,8 +174,8 @@ void LoadSave::varToState(SynthBase* synth,
 
   var settings = properties["settings"];
   DynamicObject* settings_object = settings.getDynamicObject();
-  NamedValueSet settings_properties = settings_object->getProperties();
-  Array<var>* modulations = settings_properties["modulations"].getArray();
+  settings_properties = settings_object->getProperties();
+  modulations = settings_properties["modulations"].getArray();
 
   // After 0.5.0 mixer was added and osc_mix was removed. And scaling of oscillators was changed.
   if (compareVersionStrings(version, "0.5.0") <= 0) {
@@ -324,9 +340,7 @@ void LoadSave::varToState(SynthBase* synth,
     settings_properties.set("beats_per_minute", old_bpm / 60.0);
   }
 
-  loadControls(synth, settings_properties);
-  loadModulations(synth, modulations);
-  loadSaveState(save_info, properties);
+  return true;
 }
 
 String LoadSave::getAuthor(var state) {
@@ -501,7 +515,8 @@ void LoadSave::saveMidiMapConfig(MidiManager* midi_manager) {
     for (auto& midi_destination : midi_mapping.second) {
       DynamicObject* midi_destination_object = new DynamicObject();
 
-      midi_destination_object->setProperty("destination", String(midi_destination.first));
+      midi_destination_object->setProperty("destination",
+                                            String(midi_destination.second->name));
       midi_destination_object->setProperty("min_range", midi_destination.second->min);
       midi_destination_object->setProperty("max_range", midi_destination.second->max);
       midi_destinations_object.add(midi_destination_object);
@@ -551,7 +566,8 @@ void LoadSave::loadConfig(MidiManager* midi_manager, mopo::StringLayout* layout)
 
           String destination_name = destination_object->getProperty("destination").toString();
           std::string dest = destination_name.toStdString();
-          midi_learn_map[source][dest] = &mopo::Parameters::getDetails(dest);
+          int id = mopo::Parameters::getId(dest);
+          midi_learn_map[source][id] = &mopo::Parameters::getDetails(id);
         }
       }
     }
@@ -607,6 +623,18 @@ bool LoadSave::shouldAnimateWidgets() {
   return config_object->getProperty("animate_widgets");
 }
 
+bool LoadSave::shouldPipelineEffects() {
+  var config_state = getConfigVar();
+  DynamicObject* config_object = config_state.getDynamicObject();
+  if (!config_state.isObject())
+    return false;
+
+  if (!config_object->hasProperty("pipeline_effects"))
+    return false;
+
+  return config_object->getProperty("pipeline_effects");
+}
+
 float LoadSave::loadWindowSize() {
   var config_state = getConfigVar();
   DynamicObject* config_object = config_state.getDynamicObject();
@@ -64,6 +64,12 @@ class LoadSave {
                            std::map<std::string, String>& save_info,
                            var state);
 
+    // Brings a saved state up to the current version. Returns false if it
+    // isn't a saved state.
+    static bool upgradeState(var state, NamedValueSet& properties,
+                             NamedValueSet& settings_properties,
+                             Array<var>*& modulations);
+
     static String getAuthor(var state);
     static String getLicense(var state);
 
@@ -73,6 +79,7 @@ class LoadSave {
     static bool wasUpgraded();
     static bool shouldCheckForUpdates();
     static bool shouldAnimateWidgets();
+    static bool shouldPipelineEffects();
     static float loadWindowSize();
     static String loadVersion();
     static bool shouldAskForPayment();
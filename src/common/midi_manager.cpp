@@ -24,48 +24,56 @@
 #define BANK_SELECT_NUMBER 0
 #define FOLDER_SELECT_NUMBER 32
 #define MOD_WHEEL_CONTROL_NUMBER 1
+#define PATCH_CHANGE_POLL_MS 20
 
 MidiManager::MidiManager(SynthBase* synth, MidiKeyboardState* keyboard_state,
                          std::map<std::string, String>* gui_state, Listener* listener) :
     synth_(synth), keyboard_state_(keyboard_state), gui_state_(gui_state),
-    listener_(listener), armed_value_(nullptr) {
+    listener_(listener), patch_pending_(false), loaded_patch_(nullptr), armed_id_(-1) {
   engine_ = synth_->getEngine();
+  patch_loader_ = synth_->getPatchLoader();
+  startTimer(PATCH_CHANGE_POLL_MS);
 }
 
 MidiManager::~MidiManager() {
+  stopTimer();
+  if (loaded_patch_.exchange(nullptr))
+    patch_loader_->releasePatch();
 }
 
 void MidiManager::armMidiLearn(std::string name) {
   current_bank_ = -1;
   current_folder_ = -1;
   current_patch_ = -1;
-  armed_value_ = &mopo::Parameters::getDetails(name);
+  armed_id_ = mopo::Parameters::getId(name);
 }
 
 void MidiManager::cancelMidiLearn() {
-  armed_value_ = nullptr;
+  armed_id_ = -1;
 }
 
 void MidiManager::clearMidiLearn(const std::string& name) {
+  int id = mopo::Parameters::getId(name);
   for (auto& controls : midi_learn_map_) {
-    if (controls.second.count(name)) {
-      midi_learn_map_[controls.first].erase(name);
+    if (controls.second.count(id)) {
+      controls.second.erase(id);
       LoadSave::saveMidiMapConfig(this);
     }
   }
 }
 
 void MidiManager::midiInput(int midi_id, mopo::mopo_float value) {
-  if (armed_value_) {
-    midi_learn_map_[midi_id][armed_value_->name] = armed_value_;
-    armed_value_ = nullptr;
+  if (armed_id_ >= 0) {
+    midi_learn_map_[midi_id][armed_id_] = &mopo::Parameters::getDetails(armed_id_);
+    armed_id_ = -1;
 
     // TODO: Probably shouldn't write this config on the audio thread.
     LoadSave::saveMidiMapConfig(this);
   }
 
-  if (midi_learn_map_.count(midi_id)) {
-    for (auto& control : midi_learn_map_[midi_id]) {
+  auto mapping = midi_learn_map_.find(midi_id);
+  if (mapping != midi_learn_map_.end()) {
+    for (auto& control : mapping->second) {
       const mopo::ValueDetails* details = control.second;
       mopo::mopo_float percent = value / (mopo::MIDI_SIZE - 1);
       if (details->steps) {
@@ -80,8 +88,9 @@ void MidiManager::midiInput(int midi_id, mopo::mopo_float value) {
 }
 
 bool MidiManager::isMidiMapped(const std::string& name) const {
+  int id = mopo::Parameters::getId(name);
   for (auto& controls : midi_learn_map_) {
-    if (controls.second.count(name))
+    if (controls.second.count(id))
       return true;
   }
   return false;
@@ -98,35 +107,32 @@ void MidiManager::removeNextBlockOfMessages(MidiBuffer& buffer, int num_samples)
 void MidiManager::processMidiMessage(const MidiMessage& midi_message, int sample_position) {
   if (midi_message.isProgramChange()) {
     current_patch_ = midi_message.getProgramChangeNumber();
-    File patch = LoadSave::loadPatch(current_bank_, current_folder_, current_patch_,
-                                     synth_, *gui_state_);
-    PatchLoadedCallback* callback = new PatchLoadedCallback(listener_, patch);
-    callback->post();
+    requestPatch();
     return;
   }
 
   if (midi_message.isNoteOn()) {
     engine_->noteOn(midi_message.getNoteNumber(),
                     midi_message.getVelocity() / (mopo::MIDI_SIZE - 1.0),
-                    0, midi_message.getChannel() - 1);
+                    sample_position, midi_message.getChannel() - 1);
   }
   else if (midi_message.isNoteOff())
-    engine_->noteOff(midi_message.getNoteNumber());
+    engine_->noteOff(midi_message.getNoteNumber(), sample_position);
   else if (midi_message.isAllNotesOff())
-    engine_->allNotesOff();
+    engine_->allNotesOff(sample_position);
   else if (midi_message.isSustainPedalOn())
     engine_->sustainOn();
   else if (midi_message.isSustainPedalOff())
-    engine_->sustainOff();
+    engine_->sustainOff(sample_position);
   else if (midi_message.isAftertouch()) {
     mopo::mopo_float note = midi_message.getNoteNumber();
     mopo::mopo_float value = (1.0 * midi_message.getAfterTouchValue()) / mopo::MIDI_SIZE;
-    engine_->setAftertouch(note, value);
+    engine_->setAftertouch(note, value, sample_position);
   }
   else if (midi_message.isChannelPressure()) {
     int channel = midi_message.getChannel();
     mopo::mopo_float value = midi_message.getChannelPressureValue() / (mopo::MIDI_SIZE - 1.0f);
-    engine_->setChannelAftertouch(channel, value);
+    engine_->setChannelAftertouch(channel, value, sample_position);
   }
   else if (midi_message.isPitchWheel()) {
     double percent = (1.0 * midi_message.getPitchWheelValue()) / PITCH_WHEEL_RESOLUTION;
@@ -147,6 +153,33 @@ void MidiManager::processMidiMessage(const MidiMessage& midi_message, int sample
   }
 }
 
+void MidiManager::processPatchChanges() {
+  if (patch_pending_)
+    requestPatch();
+}
+
+// Program changes that come in before the banks are indexed are retried every
+// block. Controls and modulations are applied together in one graph edit so
+// the patch is left for the message thread to pick up and stage. A newer
+// program change replaces one it hasn't picked up yet.
+void MidiManager::requestPatch() {
+  const PatchLoader::Patch* patch = nullptr;
+  patch_pending_ = !patch_loader_->getPatch(current_bank_, current_folder_,
+                                            current_patch_, patch);
+  if (patch && loaded_patch_.exchange(patch))
+    patch_loader_->releasePatch();
+}
+
+void MidiManager::timerCallback() {
+  const PatchLoader::Patch* patch = loaded_patch_.exchange(nullptr);
+  if (patch == nullptr)
+    return;
+
+  if (listener_)
+    listener_->patchChangedThroughMidi(patch);
+  patch_loader_->releasePatch();
+}
+
 void MidiManager::handleIncomingMidiMessage(MidiInput *source,
                                             const MidiMessage &midi_message) {
   midi_collector_.addMessageToQueue(midi_message);
@@ -20,6 +20,8 @@
 #include "JuceHeader.h"
 #include "common.h"
 #include "helm_common.h"
+#include "patch_loader.h"
+#include <atomic>
 #include <string>
 #include <map>
 
@@ -29,16 +31,16 @@ namespace mopo {
   class HelmEngine;
 } // namespace mopo
 
-class MidiManager : public MidiInputCallback {
+class MidiManager : public MidiInputCallback, public Timer {
   public:
-    typedef std::map<int, std::map<std::string, const mopo::ValueDetails*>> midi_map;
+    // Midi control number to the parameter ids it's mapped to.
+    typedef std::map<int, std::map<int, const mopo::ValueDetails*>> midi_map;
 
     class Listener {
       public:
         virtual ~Listener() { }
-        virtual void valueChangedThroughMidi(const std::string& name,
-                                             mopo::mopo_float value) = 0;
-        virtual void patchChangedThroughMidi(File patch) = 0;
+        virtual void valueChangedThroughMidi(int id, mopo::mopo_float value) = 0;
+        virtual void patchChangedThroughMidi(const PatchLoader::Patch* patch) = 0;
     };
 
     MidiManager(SynthBase* synth, MidiKeyboardState* keyboard_state,
@@ -50,6 +52,7 @@ class MidiManager : public MidiInputCallback {
     void clearMidiLearn(const std::string& name);
     void midiInput(int control, mopo::mopo_float value);
     void processMidiMessage(const MidiMessage &midi_message, int sample_position = 0);
+    void processPatchChanges();
     bool isMidiMapped(const std::string& name) const;
 
     void setSampleRate(double sample_rate);
@@ -62,21 +65,15 @@ class MidiManager : public MidiInputCallback {
     // MidiInputCallback
     void handleIncomingMidiMessage(MidiInput *source, const MidiMessage &midi_message) override;
 
-    struct PatchLoadedCallback : public CallbackMessage {
-      PatchLoadedCallback(Listener* lis, File pat) : listener(lis), patch(pat) { }
-
-      void messageCallback() override {
-        if (listener)
-          listener->patchChangedThroughMidi(patch);
-      }
-
-      Listener* listener;
-      File patch;
-    };
+    // Timer
+    void timerCallback() override;
 
   protected:
+    void requestPatch();
+
     SynthBase* synth_;
     mopo::HelmEngine* engine_;
+    PatchLoader* patch_loader_;
     MidiKeyboardState* keyboard_state_;
     MidiMessageCollector midi_collector_;
     std::map<std::string, String>* gui_state_;
@@ -84,8 +81,12 @@ class MidiManager : public MidiInputCallback {
     int current_bank_;
     int current_folder_;
     int current_patch_;
+    bool patch_pending_;
+
+    // Set by the audio thread and taken by the message thread.
+    std::atomic<const PatchLoader::Patch*> loaded_patch_;
 
-    const mopo::ValueDetails* armed_value_;
+    int armed_id_;
     midi_map midi_learn_map_;
 };
 
@@ -0,0 +1,33 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * helm is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * helm is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with helm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "parameter_store.h"
+
+ParameterStore::ParameterStore(int num_parameters) {
+  num_words_ = (num_parameters + BITS_PER_WORD - 1) / BITS_PER_WORD;
+  values_.reset(new std::atomic<mopo::mopo_float>[num_parameters]);
+  audio_dirty_.reset(new std::atomic<uint64_t>[num_words_]);
+  automation_dirty_.reset(new std::atomic<uint64_t>[num_words_]);
+  gui_dirty_.reset(new std::atomic<uint64_t>[num_words_]);
+
+  for (int i = 0; i < num_parameters; ++i)
+    values_[i] = 0.0;
+  for (int w = 0; w < num_words_; ++w) {
+    audio_dirty_[w] = 0;
+    automation_dirty_[w] = 0;
+    gui_dirty_[w] = 0;
+  }
+}
@@ -0,0 +1,104 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * helm is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * helm is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with helm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PARAMETER_STORE_H
+#define PARAMETER_STORE_H
+
+#include "helm_common.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// Latest value of every parameter, one atomic slot per parameter id, with a
+// dirty bit per reader. Writers never allocate or block. The audio thread
+// and the GUI each take only the parameters that changed since they last
+// looked, and see just the newest value of each.
+class ParameterStore {
+  public:
+    ParameterStore(int num_parameters);
+
+    // Any thread. The audio thread picks the value up at its next block.
+    void setValue(int id, mopo::mopo_float value) {
+      values_[id].store(value, std::memory_order_relaxed);
+      markDirty(audio_dirty_.get(), id);
+    }
+
+    // Host automation. The audio thread ramps to the value over its next
+    // block and the GUI shows the change.
+    void setAutomatedValue(int id, mopo::mopo_float value) {
+      values_[id].store(value, std::memory_order_relaxed);
+      markDirty(automation_dirty_.get(), id);
+      markDirty(gui_dirty_.get(), id);
+    }
+
+    // Audio thread, for values it already applied itself.
+    void notifyGui(int id, mopo::mopo_float value) {
+      values_[id].store(value, std::memory_order_relaxed);
+      markDirty(gui_dirty_.get(), id);
+    }
+
+    // Calls _callback_ with (id, value) for each parameter changed since the
+    // last call. Returns true if anything changed.
+    template<class Callback>
+    bool takeAudioChanges(Callback callback) {
+      return takeChanges(audio_dirty_.get(), callback);
+    }
+
+    template<class Callback>
+    bool takeAutomationChanges(Callback callback) {
+      return takeChanges(automation_dirty_.get(), callback);
+    }
+
+    template<class Callback>
+    bool takeGuiChanges(Callback callback) {
+      return takeChanges(gui_dirty_.get(), callback);
+    }
+
+  private:
+    static const int BITS_PER_WORD = 64;
+
+    inline void markDirty(std::atomic<uint64_t>* dirty, int id) {
+      uint64_t bit = uint64_t(1) << (id % BITS_PER_WORD);
+      dirty[id / BITS_PER_WORD].fetch_or(bit, std::memory_order_release);
+    }
+
+    template<class Callback>
+    bool takeChanges(std::atomic<uint64_t>* dirty, Callback& callback) {
+      bool changed = false;
+      for (int w = 0; w < num_words_; ++w) {
+        if (dirty[w].load(std::memory_order_relaxed) == 0)
+          continue;
+
+        uint64_t bits = dirty[w].exchange(0, std::memory_order_acquire);
+        for (int b = 0; bits; ++b, bits >>= 1) {
+          if (bits & 1) {
+            int id = w * BITS_PER_WORD + b;
+            callback(id, values_[id].load(std::memory_order_relaxed));
+            changed = true;
+          }
+        }
+      }
+      return changed;
+    }
+
+    int num_words_;
+    std::unique_ptr<std::atomic<mopo::mopo_float>[]> values_;
+    std::unique_ptr<std::atomic<uint64_t>[]> audio_dirty_;
+    std::unique_ptr<std::atomic<uint64_t>[]> automation_dirty_;
+    std::unique_ptr<std::atomic<uint64_t>[]> gui_dirty_;
+};
+
+#endif // PARAMETER_STORE_H
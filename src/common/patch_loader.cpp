@@ -0,0 +1,186 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * helm is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * helm is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with helm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "patch_loader.h"
+
+#include "load_save.h"
+
+#define STOP_WAIT_MILLISECONDS 2000
+#define FREE_WAIT_MILLISECONDS 1000
+
+PatchLoader::PatchLoader() :
+    Thread("Helm Patch Loader"), index_(nullptr), needs_scan_(true), readers_(0) {
+  startThread();
+}
+
+PatchLoader::~PatchLoader() {
+  stopThread(STOP_WAIT_MILLISECONDS);
+}
+
+void PatchLoader::rescan() {
+  needs_scan_ = true;
+  notify();
+}
+
+bool PatchLoader::getPatch(int bank_index, int folder_index, int patch_index,
+                           const Patch*& patch) {
+  patch = nullptr;
+
+  // Counted in before index_ is read so the index can't be freed under us.
+  readers_++;
+  const Index* index = index_.load();
+  if (index)
+    patch = findPatch(index, bank_index, folder_index, patch_index);
+
+  if (patch == nullptr)
+    readers_--;
+  return index != nullptr;
+}
+
+void PatchLoader::run() {
+  while (!threadShouldExit()) {
+    if (needs_scan_.exchange(false)) {
+      Index* index = createIndex();
+      if (index == nullptr)
+        return;
+
+      indices_.add(index);
+      index_.store(index);
+    }
+
+    freeOldIndices();
+    wait(indices_.size() > 1 ? FREE_WAIT_MILLISECONDS : -1);
+  }
+}
+
+// Anyone reading index_ after the new index was stored gets the new one, so
+// once there are no readers nothing points into the old ones anymore.
+void PatchLoader::freeOldIndices() {
+  if (readers_.load() > 0)
+    return;
+
+  while (indices_.size() > 1)
+    indices_.remove(0);
+}
+
+PatchLoader::Index* PatchLoader::createIndex() {
+  static const FileSorterAscending file_sorter;
+
+  ScopedPointer<Index> index = new Index();
+  index->bank_starts.push_back(0);
+  index->folder_starts.push_back(0);
+
+  File bank_directory = LoadSave::getBankDirectory();
+  Array<File> banks;
+  bank_directory.findChildFiles(banks, File::findDirectories, false);
+  banks.sort(file_sorter);
+
+  for (File bank : banks) {
+    Array<File> folders;
+    bank.findChildFiles(folders, File::findDirectories, false);
+    folders.sort(file_sorter);
+
+    for (File folder : folders) {
+      Array<File> patches;
+      folder.findChildFiles(patches, File::findFiles, false,
+                            String("*.") + mopo::PATCH_EXTENSION);
+      patches.sort(file_sorter);
+
+      for (File file : patches) {
+        if (threadShouldExit())
+          return nullptr;
+
+        index->patches.push_back(Patch());
+        parsePatch(file, &index->patches.back());
+      }
+      index->folder_starts.push_back(index->patches.size());
+    }
+    index->bank_starts.push_back(index->folder_starts.size() - 1);
+  }
+
+  return index.release();
+}
+
+void PatchLoader::parsePatch(File file, Patch* patch) {
+  patch->file = file;
+
+  NamedValueSet properties;
+  NamedValueSet settings_properties;
+  Array<var>* modulations = nullptr;
+
+  var state;
+  if (!JSON::parse(file.loadFileAsString(), state).wasOk() ||
+      !LoadSave::upgradeState(state, properties, settings_properties, modulations)) {
+    return;
+  }
+
+  for (int id = 0; id < mopo::Parameters::getNumParameters(); ++id) {
+    const mopo::ValueDetails& details = mopo::Parameters::getDetails(id);
+    String name = details.name;
+    mopo::mopo_float value = details.default_value;
+    if (settings_properties.contains(name))
+      value = settings_properties[name];
+    patch->controls.push_back(std::make_pair(details.name, value));
+  }
+
+  if (modulations) {
+    for (var& modulation : *modulations) {
+      DynamicObject* mod = modulation.getDynamicObject();
+      Modulation patch_modulation;
+      patch_modulation.source = mod->getProperty("source").toString().toStdString();
+      patch_modulation.destination = mod->getProperty("destination").toString().toStdString();
+      patch_modulation.amount = mod->getProperty("amount");
+      patch->modulations.push_back(patch_modulation);
+    }
+  }
+
+  LoadSave::loadSaveState(patch->save_info, properties);
+}
+
+const PatchLoader::Patch* PatchLoader::findPatch(const Index* index, int bank_index,
+                                                 int folder_index, int patch_index) {
+  int num_banks = index->bank_starts.size() - 1;
+  if (num_banks == 0)
+    return nullptr;
+
+  int folder_start = 0;
+  int folder_end = index->folder_starts.size() - 1;
+  if (bank_index >= 0) {
+    int bank = std::min(bank_index, num_banks - 1);
+    folder_start = index->bank_starts[bank];
+    folder_end = index->bank_starts[bank + 1];
+  }
+
+  if (folder_start == folder_end)
+    return nullptr;
+
+  if (folder_index >= 0) {
+    folder_start += std::min(folder_index, folder_end - folder_start - 1);
+    folder_end = folder_start + 1;
+  }
+
+  int patch_start = index->folder_starts[folder_start];
+  int patch_end = index->folder_starts[folder_end];
+  if (patch_start == patch_end || patch_index < 0)
+    return nullptr;
+
+  // Patches that couldn't be parsed have no controls and load nothing.
+  const Patch* patch = &index->patches[patch_start + std::min(patch_index,
+                                                              patch_end - patch_start - 1)];
+  if (patch->controls.empty())
+    return nullptr;
+  return patch;
+}
@@ -0,0 +1,93 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * helm is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * helm is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with helm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PATCH_LOADER_H
+#define PATCH_LOADER_H
+
+#include "JuceHeader.h"
+
+#include "helm_common.h"
+#include <atomic>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Indexes the patch banks and parses every patch on its own thread so MIDI
+// program changes can be served on the audio thread without touching disk.
+// Every synth in the process shares one through a SharedResourcePointer.
+class PatchLoader : public Thread {
+  public:
+    struct Modulation {
+      std::string source;
+      std::string destination;
+      mopo::mopo_float amount;
+    };
+
+    // Everything needed to load a patch, already upgraded to this version.
+    // Controls are by name so any synth can look up its own values.
+    struct Patch {
+      File file;
+      std::vector<std::pair<std::string, mopo::mopo_float> > controls;
+      std::vector<Modulation> modulations;
+      std::map<std::string, String> save_info;
+    };
+
+    PatchLoader();
+    virtual ~PatchLoader();
+
+    // Rebuilds the index after patches were added or removed.
+    void rescan();
+
+    // Called on the audio thread. Follows the same bank, folder and patch
+    // rules as LoadSave::getPatchFile and sets _patch_ to nullptr if there's
+    // no patch to load. Returns false if the first index isn't finished yet.
+    // A patch that is handed out stays valid until releasePatch() is called
+    // for it from any thread.
+    bool getPatch(int bank_index, int folder_index, int patch_index,
+                  const Patch*& patch);
+    void releasePatch() { readers_--; }
+
+    void run() override;
+
+  private:
+    struct Index {
+      std::vector<Patch> patches;
+
+      // Where each folder's patches and each bank's folders start, with one
+      // extra entry at the end.
+      std::vector<int> folder_starts;
+      std::vector<int> bank_starts;
+    };
+
+    Index* createIndex();
+    void freeOldIndices();
+    void parsePatch(File file, Patch* patch);
+    const Patch* findPatch(const Index* index,
+                           int bank_index, int folder_index, int patch_index);
+
+    std::atomic<Index*> index_;
+    std::atomic<bool> needs_scan_;
+    std::atomic<int> readers_;
+
+    // The current index is last. Older ones are freed once no patch handed
+    // out from them is still held.
+    OwnedArray<Index> indices_;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PatchLoader)
+};
+
+#endif // PATCH_LOADER_H
@@ -21,10 +21,21 @@
 #include "synth_gui_interface.h"
 #include "utils.h"
 
-#define OUTPUT_WINDOW_MIN_NOTE 16.0
+#include <bitset>
 
-SynthBase::SynthBase() {
+#define OUTPUT_WINDOW_MIN_NOTE 16.0
+#define MIDI_EVENT_RESERVE 1024
+#define MIN_SUB_BLOCK_SAMPLES 32
+#define CONTROL_RAMP_SAMPLES 64
+#define SYSEX_START 0xf0
+
+SynthBase::SynthBase() : parameter_store_(mopo::Parameters::getNumParameters()),
+                         pending_graph_edit_(nullptr), committed_graph_edit_(nullptr),
+                         graph_edit_in_flight_(false) {
   controls_ = engine_.getControls();
+  control_list_.resize(mopo::Parameters::getNumParameters(), nullptr);
+  for (auto& control : controls_)
+    control_list_[mopo::Parameters::getId(control.first)] = control.second;
 
   keyboard_state_ = new MidiKeyboardState();
   midi_manager_ = new MidiManager(this, keyboard_state_, &save_info_, this);
@@ -36,27 +47,88 @@ SynthBase::SynthBase() {
   memory_reset_period_ = mopo::MEMORY_RESOLUTION;
   memory_input_offset_ = 0;
   memory_index_ = 0;
+  midi_events_.reserve(MIDI_EVENT_RESERVE);
+  control_ramps_.reserve(mopo::Parameters::getNumParameters());
 
   Startup::doStartupChecks(midi_manager_);
 }
 
+SynthBase::~SynthBase() {
+  // Audio has stopped by now. The engine has to match mod_connections_ when
+  // it disconnects everything on destruction.
+  mopo::GraphEdit* edit = pending_graph_edit_.exchange(nullptr);
+  if (edit)
+    edit->commit();
+  delete edit;
+  delete committed_graph_edit_.exchange(nullptr);
+}
+
+void SynthBase::valueChanged(int id, mopo::mopo_float value) {
+  parameter_store_.setValue(id, value);
+}
+
 void SynthBase::valueChanged(const std::string& name, mopo::mopo_float value) {
-  value_change_queue_.enqueue(mopo::control_change(controls_[name], value));
+  valueChanged(mopo::Parameters::getId(name), value);
 }
 
 void SynthBase::valueChangedInternal(const std::string& name, mopo::mopo_float value) {
-  valueChanged(name, value);
-  setValueNotifyHost(name, value);
+  int id = mopo::Parameters::getId(name);
+  valueChanged(id, value);
+  setValueNotifyHost(id, value);
 }
 
-void SynthBase::valueChangedThroughMidi(const std::string& name, mopo::mopo_float value) {
-  controls_[name]->set(value);
-  ValueChangedCallback* callback = new ValueChangedCallback(this, name, value);
-  setValueNotifyHost(name, value);
-  callback->post();
+void SynthBase::valueChangedThroughMidi(int id, mopo::mopo_float value) {
+  control_list_[id]->set(value);
+  engine_.wake();
+  parameter_store_.notifyGui(id, value);
+  setValueNotifyHost(id, value);
 }
 
-void SynthBase::patchChangedThroughMidi(File patch) {
+// Controls, modulation amounts and connections all go in one edit so the
+// audio thread never plays half of the old patch and half of the new one.
+void SynthBase::patchChangedThroughMidi(const PatchLoader::Patch* patch) {
+  for (auto& info : patch->save_info)
+    save_info_[info.first] = info.second;
+
+  // Staging reads the live graph so the last edit has to be in first.
+  settleGraphEdit();
+  mopo::GraphEdit* edit = new mopo::GraphEdit();
+
+  for (auto& control : patch->controls) {
+    auto value = controls_.find(control.first);
+    if (value == controls_.end())
+      continue;
+
+    edit->set(value->second, control.second);
+    parameter_store_.notifyGui(mopo::Parameters::getId(control.first), control.second);
+  }
+
+  std::set<mopo::ModulationConnection*> old_connections;
+  old_connections.swap(mod_connections_);
+  for (mopo::ModulationConnection* connection : old_connections) {
+    if (engine_.isModulationActive(connection))
+      engine_.disconnectModulation(connection, edit);
+  }
+
+  for (const PatchLoader::Modulation& modulation : patch->modulations) {
+    if (modulation.amount == 0.0)
+      continue;
+
+    mopo::ModulationConnection* connection =
+        modulation_bank_.get(modulation.source, modulation.destination);
+    edit->set(&connection->amount, modulation.amount);
+    engine_.connectModulation(connection, edit);
+    mod_connections_.insert(connection);
+  }
+
+  // Recycled only now so none of them is handed out again in the same edit.
+  for (mopo::ModulationConnection* connection : old_connections)
+    modulation_bank_.recycle(connection);
+
+  edit->prepare();
+  graph_edit_in_flight_ = true;
+  pending_graph_edit_.store(edit);
+
   SynthGuiInterface* gui_interface = getGuiInterface();
   if (gui_interface) {
     gui_interface->updateFullGui();
@@ -64,10 +136,8 @@ void SynthBase::patchChangedThroughMidi(File patch) {
   }
 }
 
-void SynthBase::valueChangedExternal(const std::string& name, mopo::mopo_float value) {
-  valueChanged(name, value);
-  ValueChangedCallback* callback = new ValueChangedCallback(this, name, value);
-  callback->post();
+void SynthBase::valueChangedExternal(int id, mopo::mopo_float value) {
+  parameter_store_.setAutomatedValue(id, value);
 }
 
 void SynthBase::changeModulationAmount(const std::string& source,
@@ -99,6 +169,43 @@ void SynthBase::setModulationAmount(mopo::ModulationConnection* connection,
   else if (mod_connections_.count(connection) == 0)
     mod_connections_.insert(connection);
   modulation_change_queue_.enqueue(mopo::modulation_change(connection, amount));
+
+  bool active = engine_.isModulationActive(connection);
+  if (active == (amount != 0.0))
+    return;
+
+  // Staging reads the live graph so the last edit has to be in first.
+  settleGraphEdit();
+
+  mopo::GraphEdit* edit = new mopo::GraphEdit();
+  if (active)
+    engine_.disconnectModulation(connection, edit);
+  else
+    engine_.connectModulation(connection, edit);
+  edit->prepare();
+
+  graph_edit_in_flight_ = true;
+  pending_graph_edit_.store(edit);
+}
+
+void SynthBase::settleGraphEdit() {
+  if (!graph_edit_in_flight_)
+    return;
+
+  mopo::GraphEdit* edit = pending_graph_edit_.exchange(nullptr);
+  if (edit) {
+    // The audio thread hasn't picked it up yet so commit it ourselves.
+    ScopedLock lock(getCriticalSection());
+    edit->commit();
+  }
+  else {
+    // The audio thread is committing it right now.
+    while ((edit = committed_graph_edit_.exchange(nullptr)) == nullptr)
+      Thread::yield();
+  }
+
+  delete edit;
+  graph_edit_in_flight_ = false;
 }
 
 void SynthBase::disconnectModulation(mopo::ModulationConnection* connection) {
@@ -207,6 +314,7 @@ bool SynthBase::saveToFile(File patch) {
 
   if (patch.replaceWithText(JSON::toString(saveToVar(save_info_["author"])))) {
     active_file_ = patch;
+    patch_loader_->rescan();
     return true;
   }
   return false;
@@ -243,49 +351,128 @@ void SynthBase::processAudio(AudioSampleBuffer* buffer, int channels, int sample
   updateMemoryOutput(samples, engine_output_left, engine_output_right);
 }
 
-void SynthBase::processMidi(MidiBuffer& midi_messages, int start_sample, int end_sample) {
+void SynthBase::processAudioAndMidi(AudioSampleBuffer* buffer, int channels, int samples,
+                                    MidiBuffer& midi_messages) {
+  midi_manager_->processPatchChanges();
+
+  // MidiBuffer keeps events in time order so one pass lines them up.
+  midi_events_.clear();
   MidiBuffer::Iterator midi_iter(midi_messages);
-  MidiMessage midi_message;
-  int midi_sample = 0;
-  bool process_all = end_sample == 0;
-  while (midi_iter.getNextEvent(midi_message, midi_sample)) {
-    if (process_all || (midi_sample >= start_sample && midi_sample < end_sample))
-      midi_manager_->processMidiMessage(midi_message, midi_sample - start_sample);
+  const uint8* data = nullptr;
+  int size = 0;
+  int sample = 0;
+  // Events past the reserved space are dropped so this never allocates.
+  while (midi_events_.size() < MIDI_EVENT_RESERVE &&
+         midi_iter.getNextEvent(data, size, sample)) {
+    // System exclusive messages aren't handled and copying them would allocate.
+    if (size > 0 && data[0] != SYSEX_START)
+      midi_events_.push_back({ data, size, std::min(std::max(sample, 0), samples - 1) });
   }
+
+  // Pipelined effects only have room for blocks up to their latency, which
+  // comes from the block size the host promised. Hosts can send more.
+  int max_samples = MAX_BUFFER_PROCESS;
+  if (engine_.getLatency())
+    max_samples = std::min(max_samples, engine_.getLatency());
+
+  int event_index = 0;
+  int num_events = midi_events_.size();
+  for (int offset = 0; offset < samples;) {
+    int end = getSubBlockEnd(event_index, offset, std::min(samples, offset + max_samples));
+    if (!control_ramps_.empty()) {
+      end = std::min(end, offset + CONTROL_RAMP_SAMPLES);
+      updateControlRamps(end, samples);
+    }
+    if (engine_.getBufferSize() != end - offset)
+      engine_.setBufferSize(end - offset);
+
+    for (; event_index < num_events && midi_events_[event_index].sample < end; ++event_index) {
+      const MidiEvent& event = midi_events_[event_index];
+      MidiMessage midi_message(event.data, event.size, event.sample);
+      midi_manager_->processMidiMessage(midi_message, std::max(event.sample - offset, 0));
+    }
+
+    processAudio(buffer, channels, end - offset, offset);
+    offset = end;
+  }
+  control_ramps_.clear();
+}
+
+// Envelopes and controls only change once per block so the block ends at the
+// next event. Events closer than MIN_SUB_BLOCK_SAMPLES to the start are
+// merged into the block instead, and note events among them still start on
+// their own sample. A voice only holds one event per block so a note that
+// repeats always ends it.
+int SynthBase::getSubBlockEnd(int event_index, int start, int end) {
+  std::bitset<mopo::MIDI_SIZE> notes;
+  for (int i = event_index; i < midi_events_.size() && midi_events_[i].sample < end; ++i) {
+    const MidiEvent& event = midi_events_[i];
+    int delay = event.sample - start;
+    if (delay >= MIN_SUB_BLOCK_SAMPLES)
+      return event.sample;
+
+    MidiMessage midi_message(event.data, event.size);
+    if (midi_message.isNoteOnOrOff()) {
+      int note = midi_message.getNoteNumber();
+      if (notes[note] && delay > 0)
+        return event.sample;
+      notes[note] = true;
+    }
+  }
+  return end;
 }
 
 void SynthBase::processKeyboardEvents(MidiBuffer& buffer, int num_samples) {
-  MidiBuffer keyboard_messages;
-  midi_manager_->replaceKeyboardMessages(keyboard_messages, num_samples);
   midi_manager_->replaceKeyboardMessages(buffer, num_samples);
-
-  processMidi(keyboard_messages);
 }
 
 void SynthBase::processControlChanges() {
-  mopo::control_change change;
-  while (getNextControlChange(change))
-    change.first->set(change.second);
+  bool changed = parameter_store_.takeAudioChanges([this](int id, mopo::mopo_float value) {
+    control_list_[id]->set(value);
+  });
+
+  // Stepped controls can't move in between steps so they change right away.
+  control_ramps_.clear();
+  changed |= parameter_store_.takeAutomationChanges([this](int id, mopo::mopo_float value) {
+    mopo::Value* control = control_list_[id];
+    mopo::mopo_float start = control->value();
+    if (mopo::Parameters::getDetails(id).steps || start == value)
+      control->set(value);
+    else
+      control_ramps_.push_back({ control, start, value });
+  });
+
+  if (changed)
+    engine_.wake();
+}
+
+// Ramped controls skip smoothing so automation lands where the host put it.
+// The control rate graph reads one value per sub-block so each takes the
+// value the ramp reaches at its end.
+void SynthBase::updateControlRamps(int sample, int samples) {
+  mopo::mopo_float t = (1.0 * sample) / samples;
+  for (ControlRamp& ramp : control_ramps_)
+    ramp.control->setHard(mopo::utils::interpolate(ramp.start, ramp.end, t));
 }
 
 void SynthBase::processModulationChanges() {
+  mopo::GraphEdit* edit = pending_graph_edit_.exchange(nullptr);
+  if (edit) {
+    edit->commit();
+    committed_graph_edit_.store(edit);
+    engine_.wake();
+  }
+
   mopo::modulation_change change;
   while (getNextModulationChange(change)) {
-    mopo::ModulationConnection* connection = change.first;
-    mopo::mopo_float amount = change.second;
-    connection->amount.set(amount);
-
-    bool active = engine_.isModulationActive(connection);
-    if (active && amount == 0.0)
-      engine_.disconnectModulation(connection);
-    else if (!active && amount)
-      engine_.connectModulation(connection);
+    change.first->amount.set(change.second);
+    engine_.wake();
   }
 }
 
 void SynthBase::updateMemoryOutput(int samples, const mopo::mopo_float* left,
                                                 const mopo::mopo_float* right) {
-  mopo::mopo_float last_played = std::max(engine_.getLastActiveNote(), OUTPUT_WINDOW_MIN_NOTE);
+  mopo::mopo_float last_played = std::max<mopo::mopo_float>(engine_.getLastActiveNote(), OUTPUT_WINDOW_MIN_NOTE);
   int num_pressed = engine_.getPressedNotes().size();
   int output_inc = std::max<int>(1, engine_.getSampleRate() / mopo::MEMORY_SAMPLE_RATE);
 
@@ -300,7 +487,7 @@ void SynthBase::updateMemoryOutput(int samples, const mopo::mopo_float* left,
     while (memory_reset_period_ < window_length)
       memory_reset_period_ += memory_reset_period_;
 
-    memory_reset_period_ = std::min(memory_reset_period_, 2.0 * window_length);
+    memory_reset_period_ = std::min<mopo::mopo_float>(memory_reset_period_, 2.0 * window_length);
     memory_index_ = 0;
     mopo::utils::copyBufferf(output_memory_, output_memory_write_, 2 * mopo::MEMORY_RESOLUTION);
   }
@@ -364,13 +551,3 @@ String SynthBase::getPatchName() {
 String SynthBase::getFolderName() {
   return save_info_["folder_name"];
 }
-
-void SynthBase::ValueChangedCallback::messageCallback() {
-  if (listener) {
-    SynthGuiInterface* gui_interface = listener->getGuiInterface();
-    if (gui_interface) {
-      gui_interface->updateGuiControl(control_name, value);
-      gui_interface->notifyChange();
-    }
-  }
-}
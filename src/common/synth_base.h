@@ -22,21 +22,41 @@
 
 #include "helm_common.h"
 #include "helm_engine.h"
+#include "lazy_memory.h"
 #include "memory.h"
 #include "midi_manager.h"
+#include "parameter_store.h"
+#include "patch_loader.h"
+#include <atomic>
 #include <string>
+#include <vector>
+
+#define MAX_BUFFER_PROCESS 256
+#define EFFECT_MEMORY_UPDATE_MS 50
 
 class SynthGuiInterface;
 
+// Allocates and frees effect memory for every synth in the process off the
+// audio thread. Synths share one through a SharedResourcePointer. When memory
+// is freed depends on samples processed, not on how often this runs.
+class EffectMemoryTimer : public Timer {
+  public:
+    EffectMemoryTimer() { startTimer(EFFECT_MEMORY_UPDATE_MS); }
+    ~EffectMemoryTimer() { stopTimer(); }
+
+    void timerCallback() override { mopo::LazyMemory::updateAll(); }
+};
+
 class SynthBase : public MidiManager::Listener {
   public:
     SynthBase();
-    virtual ~SynthBase() { }
+    virtual ~SynthBase();
 
+    void valueChanged(int id, mopo::mopo_float value);
     void valueChanged(const std::string& name, mopo::mopo_float value);
-    void valueChangedThroughMidi(const std::string& name, mopo::mopo_float value) override;
-    void patchChangedThroughMidi(File patch) override;
-    void valueChangedExternal(const std::string& name, mopo::mopo_float value);
+    void valueChangedThroughMidi(int id, mopo::mopo_float value) override;
+    void patchChangedThroughMidi(const PatchLoader::Patch* patch) override;
+    void valueChangedExternal(int id, mopo::mopo_float value);
     void valueChangedInternal(const std::string& name, mopo::mopo_float value);
     void changeModulationAmount(const std::string& source, const std::string& destination,
                                mopo::mopo_float amount);
@@ -60,7 +80,7 @@ class SynthBase : public MidiManager::Listener {
 
     virtual void beginChangeGesture(const std::string& name) { }
     virtual void endChangeGesture(const std::string& name) { }
-    virtual void setValueNotifyHost(const std::string& name, mopo::mopo_float value) { }
+    virtual void setValueNotifyHost(int id, mopo::mopo_float value) { }
 
     void armMidiLearn(const std::string& name);
     void cancelMidiLearn();
@@ -75,22 +95,15 @@ class SynthBase : public MidiManager::Listener {
     String getFolderName();
 
     mopo::control_map& getControls() { return controls_; }
+    const mopo::control_list& getControlList() { return control_list_; }
+    mopo::Value* getControl(int id) { return control_list_[id]; }
+    ParameterStore& getParameterStore() { return parameter_store_; }
     mopo::HelmEngine* getEngine() { return &engine_; }
+    PatchLoader* getPatchLoader() { return patch_loader_; }
     MidiKeyboardState* getKeyboardState() { return keyboard_state_; }
     const float* getOutputMemory() { return output_memory_; }
     mopo::ModulationConnectionBank& getModulationBank() { return modulation_bank_; }
 
-    struct ValueChangedCallback : public CallbackMessage {
-      ValueChangedCallback(SynthBase* listener, std::string name, mopo::mopo_float val) :
-          listener(listener), control_name(name), value(val) { }
-
-      void messageCallback() override;
-
-      SynthBase* listener;
-      std::string control_name;
-      mopo::mopo_float value;
-    };
-
   protected:
     virtual const CriticalSection& getCriticalSection() = 0;
     virtual SynthGuiInterface* getGuiInterface() = 0;
@@ -99,24 +112,26 @@ class SynthBase : public MidiManager::Listener {
     mopo::ModulationConnection* getConnection(const std::string& source,
                                               const std::string& destination);
 
-    inline bool getNextControlChange(mopo::control_change& change) {
-      return value_change_queue_.try_dequeue(change);
-    }
-
     inline bool getNextModulationChange(mopo::modulation_change& change) {
       return modulation_change_queue_.try_dequeue(change);
     }
 
     void processAudio(AudioSampleBuffer* buffer, int channels, int samples, int offset);
-    void processMidi(MidiBuffer& buffer, int start_sample = 0, int end_sample = 0);
+    void processAudioAndMidi(AudioSampleBuffer* buffer, int channels, int samples,
+                             MidiBuffer& midi_messages);
     void processKeyboardEvents(MidiBuffer& buffer, int num_samples);
     void processControlChanges();
     void processModulationChanges();
+    void settleGraphEdit();
+    void updateControlRamps(int sample, int samples);
+    int getSubBlockEnd(int event_index, int start, int end);
     void updateMemoryOutput(int samples, const mopo::mopo_float* left,
                                          const mopo::mopo_float* right);
 
     mopo::ModulationConnectionBank modulation_bank_;
     mopo::HelmEngine engine_;
+    SharedResourcePointer<EffectMemoryTimer> effect_memory_timer_;
+    SharedResourcePointer<PatchLoader> patch_loader_;
     ScopedPointer<MidiManager> midi_manager_;
     ScopedPointer<MidiKeyboardState> keyboard_state_;
 
@@ -131,9 +146,33 @@ class SynthBase : public MidiManager::Listener {
 
     std::map<std::string, String> save_info_;
     mopo::control_map controls_;
+    mopo::control_list control_list_;
+    ParameterStore parameter_store_;
+
+    // Automated controls move linearly from start to end over the host block.
+    struct ControlRamp {
+      mopo::Value* control;
+      mopo::mopo_float start;
+      mopo::mopo_float end;
+    };
+    std::vector<ControlRamp> control_ramps_;
     std::set<mopo::ModulationConnection*> mod_connections_;
-    moodycamel::ConcurrentQueue<mopo::control_change> value_change_queue_;
     moodycamel::ConcurrentQueue<mopo::modulation_change> modulation_change_queue_;
+
+    // Modulation connections are staged on the message thread and handed to
+    // the audio thread to commit. The audio thread hands them back to be
+    // freed so it never allocates or deletes anything.
+    std::atomic<mopo::GraphEdit*> pending_graph_edit_;
+    std::atomic<mopo::GraphEdit*> committed_graph_edit_;
+    bool graph_edit_in_flight_;
+
+    // Events of the host block being rendered. They point into its MidiBuffer.
+    struct MidiEvent {
+      const uint8* data;
+      int size;
+      int sample;
+    };
+    std::vector<MidiEvent> midi_events_;
 };
 
 #endif // SYNTH_BASE_H
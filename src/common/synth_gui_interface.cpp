@@ -20,6 +20,8 @@
 #include "load_save.h"
 #include "synth_base.h"
 
+#define FRAMES_PER_SECOND 30
+
 SynthGuiInterface::SynthGuiInterface(SynthBase* synth, bool use_gui) : synth_(synth) {
   if (use_gui) {
     gui_ = new FullInterface(synth->getControls(),
@@ -27,6 +29,7 @@ SynthGuiInterface::SynthGuiInterface(SynthBase* synth, bool use_gui) : synth_(sy
                              synth->getEngine()->getMonoModulations(),
                              synth->getEngine()->getPolyModulations(),
                              synth->getKeyboardState());
+    startTimerHz(FRAMES_PER_SECOND);
   }
 }
 
@@ -46,6 +49,16 @@ void SynthGuiInterface::updateGuiControl(const std::string& name, mopo::mopo_flo
   gui_->setValue(name, value, NotificationType::dontSendNotification);
 }
 
+void SynthGuiInterface::timerCallback() {
+  ParameterStore& parameters = synth_->getParameterStore();
+  bool changed = parameters.takeGuiChanges([this](int id, mopo::mopo_float value) {
+    updateGuiControl(mopo::Parameters::getDetails(id).name, value);
+  });
+
+  if (changed)
+    notifyChange();
+}
+
 mopo::mopo_float SynthGuiInterface::getControlValue(const std::string& name) {
   return synth_->getControls()[name]->value();
 }
@@ -20,10 +20,12 @@
 #include "full_interface.h"
 #include "synth_base.h"
 
-class SynthGuiInterface {
+// Polls the synth's ParameterStore at frame rate for values the host or MIDI
+// changed instead of being sent a message for every change.
+class SynthGuiInterface : public Timer {
   public:
     SynthGuiInterface(SynthBase* synth, bool use_gui = true);
-    virtual ~SynthGuiInterface() { }
+    virtual ~SynthGuiInterface() { stopTimer(); }
 
     virtual AudioDeviceManager* getAudioDeviceManager() { return nullptr; }
 
@@ -37,6 +39,9 @@ class SynthGuiInterface {
     void externalPatchLoaded(File patch);
     void setGuiSize(int width, int height);
 
+    // Timer
+    void timerCallback() override;
+
   protected:
     SynthBase* synth_;
     ScopedPointer<FullInterface> gui_;
@@ -20,7 +20,6 @@
 #include "load_save.h"
 
 #define PITCH_WHEEL_RESOLUTION 0x3fff
-#define MAX_BUFFER_PROCESS 256
 #define SET_PROGRAM_WAIT_MILLISECONDS 500
 
 HelmPlugin::HelmPlugin() {
@@ -30,10 +29,13 @@ HelmPlugin::HelmPlugin() {
 
   loadPatches();
 
+  // Host parameter indices follow the names so saved automation keeps working.
+  bridge_lookup_.resize(mopo::Parameters::getNumParameters(), nullptr);
   for (auto control : controls_) {
-    ValueBridge* bridge = new ValueBridge(control.first, control.second);
+    int id = mopo::Parameters::getId(control.first);
+    ValueBridge* bridge = new ValueBridge(id, control.second);
     bridge->setListener(this);
-    bridge_lookup_[control.first] = bridge;
+    bridge_lookup_[id] = bridge;
     addParameter(bridge);
   }
 }
@@ -51,16 +53,16 @@ SynthGuiInterface* HelmPlugin::getGuiInterface() {
 }
 
 void HelmPlugin::beginChangeGesture(const std::string& name) {
-  bridge_lookup_[name]->beginChangeGesture();
+  bridge_lookup_[mopo::Parameters::getId(name)]->beginChangeGesture();
 }
 
 void HelmPlugin::endChangeGesture(const std::string& name) {
-  bridge_lookup_[name]->endChangeGesture();
+  bridge_lookup_[mopo::Parameters::getId(name)]->endChangeGesture();
 }
 
-void HelmPlugin::setValueNotifyHost(const std::string& name, mopo::mopo_float value) {
-  mopo::mopo_float plugin_value =  bridge_lookup_[name]->convertToPluginValue(value);
-  bridge_lookup_[name]->setValueNotifyHost(plugin_value);
+void HelmPlugin::setValueNotifyHost(int id, mopo::mopo_float value) {
+  mopo::mopo_float plugin_value =  bridge_lookup_[id]->convertToPluginValue(value);
+  bridge_lookup_[id]->setValueNotifyHost(plugin_value);
 }
 
 const CriticalSection& HelmPlugin::getCriticalSection() {
@@ -150,8 +152,12 @@ void HelmPlugin::changeProgramName(int index, const String& new_name) {
 }
 
 void HelmPlugin::prepareToPlay(double sample_rate, int buffer_size) {
+  int max_buffer_size = std::min<int>(buffer_size, MAX_BUFFER_PROCESS);
+  engine_.setPipelinedEffects(LoadSave::shouldPipelineEffects(), max_buffer_size);
+  setLatencySamples(engine_.getLatency());
+
   engine_.setSampleRate(sample_rate);
-  engine_.setBufferSize(std::min<int>(buffer_size, MAX_BUFFER_PROCESS));
+  engine_.setBufferSize(max_buffer_size);
   midi_manager_->setSampleRate(sample_rate);
 }
 
@@ -173,17 +179,16 @@ void HelmPlugin::processBlock(AudioSampleBuffer& buffer, MidiBuffer& midi_messag
   processControlChanges();
   processModulationChanges();
 
-  MidiBuffer keyboard_messages = midi_messages;
-  processKeyboardEvents(keyboard_messages, total_samples);
-
-  for (int sample_offset = 0; sample_offset < total_samples;) {
-    int num_samples = std::min<int>(total_samples - sample_offset, MAX_BUFFER_PROCESS);
+  processKeyboardEvents(midi_messages, total_samples);
+  processAudioAndMidi(&buffer, num_channels, total_samples, midi_messages);
 
-    processMidi(midi_messages, sample_offset, sample_offset + num_samples);
-    processAudio(&buffer, num_channels, num_samples, sample_offset);
+  // Offline renders can outrun the timer. Nothing here is real time then so
+  // effect memory is handed over right away.
+  if (isNonRealtime())
+    mopo::LazyMemory::updateAll();
 
-    sample_offset += num_samples;
-  }
+  // Helm doesn't send MIDI so nothing we added should reach the host.
+  midi_messages.clear();
 }
 
 bool HelmPlugin::hasEditor() const {
@@ -194,8 +199,8 @@ AudioProcessorEditor* HelmPlugin::createEditor() {
   return new HelmEditor(*this);
 }
 
-void HelmPlugin::parameterChanged(std::string name, mopo::mopo_float value) {
-  valueChangedExternal(name, value);
+void HelmPlugin::parameterChanged(int id, mopo::mopo_float value) {
+  valueChangedExternal(id, value);
 }
 
 void HelmPlugin::loadPatches() {
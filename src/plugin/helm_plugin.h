@@ -33,7 +33,7 @@ class HelmPlugin : public SynthBase, public AudioProcessor, public ValueBridge::
     SynthGuiInterface* getGuiInterface() override;
     void beginChangeGesture(const std::string& name) override;
     void endChangeGesture(const std::string& name) override;
-    void setValueNotifyHost(const std::string& name, mopo::mopo_float value) override;
+    void setValueNotifyHost(int id, mopo::mopo_float value) override;
     const CriticalSection& getCriticalSection() override;
 
     // AudioProcessor
@@ -66,7 +66,7 @@ class HelmPlugin : public SynthBase, public AudioProcessor, public ValueBridge::
     void setStateInformation(const void* data, int size_in_bytes) override;
 
     // ValueBridge::Listener
-    void parameterChanged(std::string name, mopo::mopo_float value) override;
+    void parameterChanged(int id, mopo::mopo_float value) override;
 
     void loadPatches();
 
@@ -77,7 +77,7 @@ class HelmPlugin : public SynthBase, public AudioProcessor, public ValueBridge::
     Array<File> all_patches_;
     AudioPlayHead::CurrentPositionInfo position_info_;
 
-    std::map<std::string, ValueBridge*> bridge_lookup_;
+    std::vector<ValueBridge*> bridge_lookup_;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(HelmPlugin)
 };
@@ -26,13 +26,14 @@ class ValueBridge : public AudioProcessorParameter {
     class Listener {
       public:
         virtual ~Listener() { }
-        virtual void parameterChanged(std::string name, mopo::mopo_float value) = 0;
+        virtual void parameterChanged(int id, mopo::mopo_float value) = 0;
     };
 
-    ValueBridge(std::string name, mopo::Value* value) :
-        AudioProcessorParameter(), name_(name), value_(value), listener_(nullptr),
+    ValueBridge(int id, mopo::Value* value) :
+        AudioProcessorParameter(), id_(id), value_(value), listener_(nullptr),
         source_changed_(false) {
-      details_ = mopo::Parameters::getDetails(name);
+      details_ = mopo::Parameters::getDetails(id);
+      name_ = details_.name;
       span_ = details_.max - details_.min;
     }
 
@@ -44,7 +45,7 @@ class ValueBridge : public AudioProcessorParameter {
       if (listener_ && !source_changed_) {
         source_changed_ = true;
         mopo::mopo_float synth_value = convertToSynthValue(value);
-        listener_->parameterChanged(name_.toStdString(), synth_value);
+        listener_->parameterChanged(id_, synth_value);
         source_changed_ = false;
       }
     }
@@ -113,6 +114,7 @@ class ValueBridge : public AudioProcessorParameter {
       }
     }
 
+    int id_;
     String name_;
     mopo::ValueDetails details_;
     mopo::mopo_float span_;
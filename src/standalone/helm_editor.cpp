@@ -24,7 +24,6 @@
 #include "utils.h"
 
 #define MAX_OUTPUT_MEMORY 1048576
-#define MAX_BUFFER_PROCESS 256
 
 HelmEditor::HelmEditor(bool use_gui) : SynthGuiInterface(this, use_gui) {
   computer_keyboard_ = new HelmComputerKeyboard(&engine_, keyboard_state_);
@@ -85,20 +84,13 @@ void HelmEditor::getNextAudioBlock(const AudioSourceChannelInfo& buffer) {
   ScopedLock lock(getCriticalSection());
 
   int num_samples = buffer.buffer->getNumSamples();
-  int synth_samples = std::min(num_samples, MAX_BUFFER_PROCESS);
 
   processControlChanges();
   processModulationChanges();
   MidiBuffer midi_messages;
   midi_manager_->removeNextBlockOfMessages(midi_messages, num_samples);
-  processMidi(midi_messages);
   processKeyboardEvents(midi_messages, num_samples);
-
-  for (int b = 0; b < num_samples; b += synth_samples) {
-    int current_samples = std::min<int>(synth_samples, num_samples - b);
-
-    processAudio(buffer.buffer, mopo::NUM_CHANNELS, current_samples, b);
-  }
+  processAudioAndMidi(buffer.buffer, mopo::NUM_CHANNELS, num_samples, midi_messages);
 }
 
 void HelmEditor::releaseResources() {
@@ -16,6 +16,8 @@
 
 #include "dc_filter.h"
 
+#include "utils.h"
+
 namespace mopo {
 
   DcFilter::DcFilter() : Processor(DcFilter::kNumInputs, 1) {
@@ -28,6 +30,11 @@ namespace mopo {
 
     const mopo_float* source = input(kAudio)->source->buffer;
     mopo_float* dest = output()->buffer;
+    if (tail_.update(source, buffer_size_, coefficient_, 1.0)) {
+      utils::zeroBuffer(dest, buffer_size_);
+      return;
+    }
+
     int i = 0;
     if (inputs_->at(kReset)->source->triggered &&
         inputs_->at(kReset)->source->trigger_value == kVoiceReset) {
@@ -19,6 +19,7 @@
 #define DC_FILTER_H
 
 #include "processor.h"
+#include "tail_tracker.h"
 
 #define COEFFICIENT_TO_SR_CONSTANT 25.0
 
@@ -38,6 +39,8 @@ namespace mopo {
       virtual Processor* clone() const { return new DcFilter(*this); }
       virtual void process();
 
+      bool isSilent() const { return tail_.isSilent(); }
+
       void computeCoefficients() {
         coefficient_ = 1.0 - COEFFICIENT_TO_SR_CONSTANT / getSampleRate();
       }
@@ -59,6 +62,8 @@ namespace mopo {
       // Past input and output values.
       mopo_float past_in_;
       mopo_float past_out_;
+
+      TailTracker tail_;
   };
 } // namespace mopo
 
@@ -39,7 +39,7 @@ namespace mopo {
 
     int waveform = static_cast<int>(input(kWaveform)->source->buffer[0] + 0.5);
     waveform = mopo::utils::iclamp(waveform, 0, FixedPointWaveLookup::kWhiteNoise - 1);
-    mopo_float* wave_buffer = FixedPointWave::getBuffer(waveform, 2.0 * phase_inc);
+    const float* wave_buffer = FixedPointWave::getBuffer(waveform, 2.0 * phase_inc);
 
     mopo_float first_adjust = bool(shuffle) * 2.0 / shuffle;
     mopo_float second_adjust = 1.0 / (1.0 - 0.5 * shuffle);
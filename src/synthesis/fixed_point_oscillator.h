@@ -39,6 +39,7 @@ namespace mopo {
       FixedPointOscillator();
 
       virtual void process();
+      virtual bool rewritesOutputs() const { return true; }
       virtual Processor* clone() const { return new FixedPointOscillator(*this); }
 
     protected:
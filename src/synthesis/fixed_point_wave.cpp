@@ -18,163 +18,168 @@
 
 namespace mopo {
 
-  FixedPointWaveLookup::FixedPointWaveLookup() {
-    preprocessSin();
-    preprocessTriangle();
-    preprocessSquare();
-    preprocessUpSaw();
-    preprocessDownSaw();
-    preprocessStep<3>(three_step_);
-    preprocessStep<4>(four_step_);
-    preprocessStep<8>(eight_step_);
-    preprocessPyramid<3>(three_pyramid_);
-    preprocessPyramid<5>(five_pyramid_);
-    preprocessPyramid<9>(nine_pyramid_);
-
-    wave_type waves[kNumFixedPointWaveforms] =
-        { sin_, triangle_, square_, down_saw_, up_saw_,
-          three_step_, four_step_, eight_step_,
-          three_pyramid_, five_pyramid_, nine_pyramid_ };
-
-    memcpy(waves_, waves, kNumFixedPointWaveforms * sizeof(wave_type));
-  }
-
-  void FixedPointWaveLookup::preprocessSin() {
-    for (int h = 0; h < HARMONICS + 1; ++h) {
-      for (int i = 0; i < FIXED_LOOKUP_SIZE; ++i)
-        sin_[h][i] = sin((2 * PI * i) / FIXED_LOOKUP_SIZE);
+  void FixedPointWaveLookup::generateLevel(int waveform, int level) {
+    std::atomic<int>& state = states_[waveform][level];
+    int expected = kEmpty;
+    if (!state.compare_exchange_strong(expected, kGenerating, std::memory_order_acquire)) {
+      // Another voice thread got here first. A level only takes microseconds.
+      while (state.load(std::memory_order_acquire) != kReady)
+        ;
+      return;
     }
 
-    preprocessDiffs(sin_);
-  }
-
-  void FixedPointWaveLookup::preprocessTriangle() {
-    for (int i = 0; i < FIXED_LOOKUP_SIZE; ++i) {
-      triangle_[0][i] = Wave::triangle((1.0 * i) / FIXED_LOOKUP_SIZE);
-
-      int p = i;
-      mopo_float scale = 8.0 / (PI * PI);
-      triangle_[HARMONICS][i] = scale * sin_[0][p];
+    double values[FIXED_LOOKUP_SIZE];
+    computeLevel(waveform, level, values);
 
-      for (int h = 1; h < HARMONICS; ++h) {
-        p = (p + i) % FIXED_LOOKUP_SIZE;
-        triangle_[HARMONICS - h][i] = triangle_[HARMONICS - h + 1][i];
-        mopo_float harmonic = scale * sin_[0][p] / ((h + 1) * (h + 1));
+    float* buffer = levels_[waveform][level];
+    for (int i = 0; i < FIXED_LOOKUP_SIZE; ++i)
+      buffer[2 * i] = values[i];
 
-        if (h % 4 == 0)
-          triangle_[HARMONICS - h][i] += harmonic;
-        else if (h % 2 == 0)
-          triangle_[HARMONICS - h][i] -= harmonic;
-      }
+    // Deltas come from the rounded values so segments still meet exactly.
+    for (int i = 0; i < FIXED_LOOKUP_SIZE; ++i) {
+      int next = (i + 1) % FIXED_LOOKUP_SIZE;
+      double delta = 1.0 * buffer[2 * next] - buffer[2 * i];
+      buffer[2 * i + 1] = FRACTIONAL_MULT * delta;
     }
 
-    preprocessDiffs(triangle_);
+    state.store(kReady, std::memory_order_release);
   }
 
-  void FixedPointWaveLookup::preprocessSquare() {
-    for (int i = 0; i < FIXED_LOOKUP_SIZE; ++i) {
-      square_[0][i] = Wave::square((1.0 * i) / FIXED_LOOKUP_SIZE);
-
-      int p = i;
-      mopo_float scale = 4.0 / PI;
-      square_[HARMONICS][i] = scale * sin_[0][p];
-
-      for (int h = 1; h < HARMONICS; ++h) {
-        p = (p + i) % FIXED_LOOKUP_SIZE;
-        square_[HARMONICS - h][i] = square_[HARMONICS - h + 1][i];
-
-        if (h % 2 == 0)
-          square_[HARMONICS - h][i] += scale * sin_[0][p] / (h + 1);
-      }
+  void FixedPointWaveLookup::computeLevel(int waveform, int level, double* values) {
+    switch (waveform) {
+      case kSin:
+        for (int i = 0; i < FIXED_LOOKUP_SIZE; ++i)
+          values[i] = sin((2.0 * PI * i) / FIXED_LOOKUP_SIZE);
+        break;
+      case kTriangle:
+      case kSquare:
+      case kUpSaw:
+        computeHarmonics(waveform, level, values);
+        break;
+      case kDownSaw:
+        computeHarmonics(kUpSaw, level, values);
+        for (int i = 0; i < FIXED_LOOKUP_SIZE; ++i)
+          values[i] = -values[i];
+        break;
+      case kThreeStep:
+        computeStep(3, level, values);
+        break;
+      case kFourStep:
+        computeStep(4, level, values);
+        break;
+      case kEightStep:
+        computeStep(8, level, values);
+        break;
+      case kThreePyramid:
+        computePyramid(3, level, values);
+        break;
+      case kFivePyramid:
+        computePyramid(5, level, values);
+        break;
+      case kNinePyramid:
+        computePyramid(9, level, values);
+        break;
+      default:
+        memset(values, 0, FIXED_LOOKUP_SIZE * sizeof(double));
     }
-
-    preprocessDiffs(square_);
   }
 
-  void FixedPointWaveLookup::preprocessDownSaw() {
-    for (int h = 0; h < HARMONICS + 1; ++h) {
-      for (int i = 0; i < FIXED_LOOKUP_SIZE; ++i)
-        down_saw_[h][i] = -up_saw_[h][i];
+  void FixedPointWaveLookup::computeHarmonics(int waveform, int level, double* values) {
+    if (level == 0) {
+      for (int i = 0; i < FIXED_LOOKUP_SIZE; ++i) {
+        mopo_float t = (1.0 * i) / FIXED_LOOKUP_SIZE;
+        if (waveform == kTriangle)
+          values[i] = Wave::triangle(t);
+        else if (waveform == kSquare)
+          values[i] = Wave::square(t);
+        else
+          values[i] = Wave::upsaw(t);
+      }
+      return;
     }
 
-    preprocessDiffs(down_saw_);
-  }
+    int num_harmonics = HARMONICS + 1 - level;
+    double scale = 2.0 / PI;
+    if (waveform == kTriangle)
+      scale = 8.0 / (PI * PI);
+    else if (waveform == kSquare)
+      scale = 4.0 / PI;
 
-  void FixedPointWaveLookup::preprocessUpSaw() {
     for (int i = 0; i < FIXED_LOOKUP_SIZE; ++i) {
-      up_saw_[0][i] = Wave::upsaw((1.0 * i) / FIXED_LOOKUP_SIZE);
-
-      int index = (i + (FIXED_LOOKUP_SIZE / 2)) % FIXED_LOOKUP_SIZE;
-      int p = i;
-      mopo_float scale = 2.0 / PI;
-      up_saw_[HARMONICS][index] = scale * sin_[0][p];
-
-      for (int h = 1; h < HARMONICS; ++h) {
-        p = (p + i) % FIXED_LOOKUP_SIZE;
-        mopo_float harmonic = scale * sin_[0][p] / (h + 1);
-
-        if (h % 2 == 0)
-          up_saw_[HARMONICS - h][index] = up_saw_[HARMONICS - h + 1][index] + harmonic;
+      // Steps through sin(k * x) with the Chebyshev recurrence instead of
+      // calling sin() for every harmonic.
+      double x = (2.0 * PI * i) / FIXED_LOOKUP_SIZE;
+      double twice_cos = 2.0 * cos(x);
+      double previous_sin = 0.0;
+      double harmonic_sin = sin(x);
+      double total = 0.0;
+
+      for (int k = 1; k <= num_harmonics; ++k) {
+        if (waveform == kTriangle) {
+          if (k % 4 == 1)
+            total += scale * harmonic_sin / (k * k);
+          else if (k % 4 == 3)
+            total -= scale * harmonic_sin / (k * k);
+        }
+        else if (waveform == kSquare) {
+          if (k % 2)
+            total += scale * harmonic_sin / k;
+        }
+        else if (k % 2)
+          total += scale * harmonic_sin / k;
         else
-          up_saw_[HARMONICS - h][index] = up_saw_[HARMONICS - h + 1][index] - harmonic;
+          total -= scale * harmonic_sin / k;
+
+        double next_sin = twice_cos * harmonic_sin - previous_sin;
+        previous_sin = harmonic_sin;
+        harmonic_sin = next_sin;
       }
-    }
 
-    preprocessDiffs(up_saw_);
+      if (waveform == kUpSaw)
+        values[(i + (FIXED_LOOKUP_SIZE / 2)) % FIXED_LOOKUP_SIZE] = total;
+      else
+        values[i] = total;
+    }
   }
 
-  template<size_t steps>
-  void FixedPointWaveLookup::preprocessStep(wave_type buffer) {
-    static int num_steps = steps;
-    static const mopo_float step_size = num_steps / (num_steps - 1.0);
+  void FixedPointWaveLookup::computeStep(int steps, int level, double* values) {
+    double step_size = steps / (steps - 1.0);
+    int base_num_harmonics = HARMONICS + 1 - level;
+    int harmony_num_harmonics = base_num_harmonics / steps;
+    int harmony_level = HARMONICS + 1 - harmony_num_harmonics;
 
-    for (int h = 0; h < HARMONICS + 1; ++h) {
-      int base_num_harmonics = HARMONICS + 1 - h;
-      int harmony_num_harmonics = base_num_harmonics / num_steps;
-      int harmony_h = HARMONICS + 1 - harmony_num_harmonics;
+    computeHarmonics(kUpSaw, level, values);
+    for (int i = 0; i < FIXED_LOOKUP_SIZE; ++i)
+      values[i] *= step_size;
 
-      for (int i = 0; i < FIXED_LOOKUP_SIZE; ++i) {
-        buffer[h][i] = step_size * up_saw_[h][i];
+    if (harmony_num_harmonics == 0)
+      return;
 
-        if (harmony_num_harmonics) {
-          int harm_index = (num_steps * i) % FIXED_LOOKUP_SIZE;
-          buffer[h][i] += step_size * down_saw_[harmony_h][harm_index] / num_steps;
-        }
-      }
+    double harmony[FIXED_LOOKUP_SIZE];
+    computeHarmonics(kUpSaw, harmony_level, harmony);
+    for (int i = 0; i < FIXED_LOOKUP_SIZE; ++i) {
+      int harmony_index = (steps * i) % FIXED_LOOKUP_SIZE;
+      values[i] -= step_size * harmony[harmony_index] / steps;
     }
-
-    preprocessDiffs(buffer);
   }
 
-  template<size_t steps>
-  void FixedPointWaveLookup::preprocessPyramid(wave_type buffer) {
-    static const int squares = steps - 1;
+  void FixedPointWaveLookup::computePyramid(int steps, int level, double* values) {
     static const int offset = 3 * FIXED_LOOKUP_SIZE / 4;
+    int squares = steps - 1;
 
-    for (int h = 0; h < HARMONICS + 1; ++h) {
-      for (int i = 0; i < FIXED_LOOKUP_SIZE; ++i) {
-        buffer[h][i] = 0;
-
-        for (size_t s = 0; s < squares; ++s) {
-          int square_offset = (s * FIXED_LOOKUP_SIZE) / (2 * squares);
-          int phase = (i + offset + square_offset) % FIXED_LOOKUP_SIZE;
-          buffer[h][i] += square_[h][phase] / squares;
-        }
-      }
-    }
-
-    preprocessDiffs(buffer);
-  }
+    double square[FIXED_LOOKUP_SIZE];
+    computeHarmonics(kSquare, level, square);
 
-  void FixedPointWaveLookup::preprocessDiffs(wave_type wave) {
-    for (int h = 0; h < HARMONICS + 1; ++h) {
-      for (int i = 0; i < FIXED_LOOKUP_SIZE - 1; ++i)
-        wave[h][i + FIXED_LOOKUP_SIZE] = FRACTIONAL_MULT * (wave[h][i + 1] - wave[h][i]);
+    for (int i = 0; i < FIXED_LOOKUP_SIZE; ++i) {
+      values[i] = 0.0;
 
-      mopo_float last_delta = wave[h][0] - wave[h][FIXED_LOOKUP_SIZE - 1];
-      wave[h][2 * FIXED_LOOKUP_SIZE - 1] = FRACTIONAL_MULT * last_delta;
+      for (int s = 0; s < squares; ++s) {
+        int square_offset = (s * FIXED_LOOKUP_SIZE) / (2 * squares);
+        int phase = (i + offset + square_offset) % FIXED_LOOKUP_SIZE;
+        values[i] += square[phase] / squares;
+      }
     }
   }
 
-  const FixedPointWaveLookup FixedPointWave::lookup_;
+  FixedPointWaveLookup FixedPointWave::lookup_;
 } // namespace mopo
@@ -21,6 +21,7 @@
 #include "common.h"
 #include "wave.h"
 #include "utils.h"
+#include <atomic>
 #include <climits>
 #include <cmath>
 #include <cstdlib>
@@ -28,6 +29,9 @@
 
 namespace mopo {
 
+  // Band limited wave tables shared by every synth in the process. Each
+  // harmonic level of each waveform is generated the first time it's read,
+  // so only the levels that are played take memory or cache space.
   class FixedPointWaveLookup {
     public:
       enum Type {
@@ -56,54 +60,43 @@ namespace mopo {
 
       static const int HARMONICS = 63;
 
-      typedef mopo_float (*wave_type)[2 * FIXED_LOOKUP_SIZE];
-
-      FixedPointWaveLookup();
-
-      void preprocessSin();
-      void preprocessTriangle();
-      void preprocessSquare();
-      void preprocessDownSaw();
-      void preprocessUpSaw();
-      template<size_t steps>
-      void preprocessStep(wave_type buffer);
-      template<size_t steps>
-      void preprocessPyramid(wave_type buffer);
-      void preprocessDiffs(wave_type wave);
-
-      mopo_float sin_[HARMONICS + 1][2 * FIXED_LOOKUP_SIZE];
-      mopo_float triangle_[HARMONICS + 1][2 * FIXED_LOOKUP_SIZE];
-      mopo_float square_[HARMONICS + 1][2 * FIXED_LOOKUP_SIZE];
-      mopo_float down_saw_[HARMONICS + 1][2 * FIXED_LOOKUP_SIZE];
-      mopo_float up_saw_[HARMONICS + 1][2 * FIXED_LOOKUP_SIZE];
-      mopo_float three_step_[HARMONICS + 1][2 * FIXED_LOOKUP_SIZE];
-      mopo_float four_step_[HARMONICS + 1][2 * FIXED_LOOKUP_SIZE];
-      mopo_float eight_step_[HARMONICS + 1][2 * FIXED_LOOKUP_SIZE];
-      mopo_float three_pyramid_[HARMONICS + 1][2 * FIXED_LOOKUP_SIZE];
-      mopo_float five_pyramid_[HARMONICS + 1][2 * FIXED_LOOKUP_SIZE];
-      mopo_float nine_pyramid_[HARMONICS + 1][2 * FIXED_LOOKUP_SIZE];
-
-      wave_type waves_[kNumFixedPointWaveforms];
-  };
+      // Interleaved value and delta pairs. Deltas are prescaled by
+      // FRACTIONAL_MULT so they multiply the raw fractional phase.
+      typedef float wave_level[2 * FIXED_LOOKUP_SIZE];
 
-  class FixedPointWave {
-    public:
-      static inline mopo_float harmonicWave(int waveform, unsigned int t, int harmonic) {
-        return lookup_.waves_[waveform][harmonic][getIndex(t)];
+      inline const float* getLevel(int waveform, int level) {
+        if (states_[waveform][level].load(std::memory_order_acquire) != kReady)
+          generateLevel(waveform, level);
+        return levels_[waveform][level];
       }
 
-      static inline mopo_float wave(int waveform, unsigned int t, int phase_inc) {
-        return lookup_.waves_[waveform][getHarmonicIndex(phase_inc)][getIndex(t)];
-      }
+    private:
+      enum LevelState {
+        kEmpty,
+        kGenerating,
+        kReady
+      };
 
-      static inline mopo_float wave(int waveform, unsigned int t) {
-        unsigned int index = getIndex(t);
-        return lookup_.waves_[waveform][0][index];
-      }
+      void generateLevel(int waveform, int level);
 
-      static inline mopo_float* getBuffer(int waveform, int phase_inc) {
+      // Level 0 is the naive waveform. Level l keeps the harmonics up to
+      // HARMONICS + 1 - l. Values are computed in double and rounded once.
+      static void computeLevel(int waveform, int level, double* values);
+      static void computeHarmonics(int waveform, int level, double* values);
+      static void computeStep(int steps, int level, double* values);
+      static void computePyramid(int steps, int level, double* values);
+
+      // No constructor so the tables are zero initialized without any work
+      // at load time.
+      std::atomic<int> states_[kNumFixedPointWaveforms][HARMONICS + 1];
+      wave_level levels_[kNumFixedPointWaveforms][HARMONICS + 1];
+  };
+
+  class FixedPointWave {
+    public:
+      static inline const float* getBuffer(int waveform, int phase_inc) {
         int clamped_inc = mopo::utils::iclamp(phase_inc, 1, INT_MAX);
-        return lookup_.waves_[waveform][getHarmonicIndex(clamped_inc)];
+        return lookup_.getLevel(waveform, getHarmonicIndex(clamped_inc));
       }
 
       static inline int getHarmonicIndex(int phase_inc) {
@@ -112,10 +105,10 @@ namespace mopo {
                                    0, FixedPointWaveLookup::HARMONICS - 1);
       }
 
-      static inline mopo_float interpretWave(const mopo_float* buffer, unsigned int t) {
-        int index = getIndex(t);
+      static inline mopo_float interpretWave(const float* buffer, unsigned int t) {
+        int index = 2 * getIndex(t);
         mopo_float mult = getFractional(t);
-        mopo_float inc = mult * buffer[index + FixedPointWaveLookup::FIXED_LOOKUP_SIZE];
+        mopo_float inc = mult * buffer[index + 1];
         return buffer[index] + inc;
       }
 
@@ -128,7 +121,7 @@ namespace mopo {
       }
 
     protected:
-      static const FixedPointWaveLookup lookup_;
+      static FixedPointWaveLookup lookup_;
   };
 } // namespace mopo
 
@@ -22,10 +22,12 @@ namespace mopo {
 
   Gate::Gate() : Processor(kNumInputs, 1) {
     original_buffer_ = output()->buffer;
+    original_buffer_size_ = output()->buffer_size;
   }
 
   void Gate::destroy() {
     output()->buffer = original_buffer_;
+    output()->buffer_size = original_buffer_size_;
     Processor::destroy();
   }
 
@@ -36,6 +38,8 @@ namespace mopo {
 
   inline void Gate::setSource(int source) {
     source = utils::iclamp(source, 0, numInputs() - kNumInputs - 1);
-    output()->buffer = input(kNumInputs + source)->source->buffer;
+    const Output* chosen = input(kNumInputs + source)->source;
+    output()->buffer = chosen->buffer;
+    output()->buffer_size = chosen->buffer_size;
   }
 } // namespace mopo
@@ -34,11 +34,13 @@ namespace mopo {
       virtual void destroy() override;
       virtual Processor* clone() const override { return new Gate(*this); }
       void process() override;
+      bool aliasesInputs() const override { return true; }
 
     private:
       void setSource(int source);
 
       mopo_float* original_buffer_;
+      int original_buffer_size_;
   };
 } // namespace mopo
 
@@ -19,20 +19,28 @@
 #include "dc_filter.h"
 #include "helm_lfo.h"
 #include "helm_voice_handler.h"
+#include "lazy_memory.h"
 #include "peak_meter.h"
+#include "pipeline_router.h"
 #include "value_switch.h"
 
 #ifdef __APPLE__
 #include <fenv.h>
 #endif
 
-#define MAX_DELAY_SAMPLES 300000
+#define MAX_DELAY_SECONDS 7.0
+#define IDLE_SETTLE_SECONDS 0.5
 
 namespace mopo {
 
-  HelmEngine::HelmEngine() : was_playing_arp_(false) {
+  HelmEngine::HelmEngine() : was_playing_arp_(false), settle_samples_(0),
+                             effect_memory_(std::make_shared<LazyMemory::Registry>()) {
+#if MOPO_PROFILE
+    setProfiler(&profile_);
+#endif
     init();
     bps_ = controls_["beats_per_minute"];
+    compilePlans();
   }
 
   HelmEngine::~HelmEngine() {
@@ -45,6 +53,8 @@ namespace mopo {
     fesetenv(FE_DFL_DISABLE_SSE_DENORMS_ENV);
 #endif
 
+    setProfileName("engine");
+
     Output* beats_per_second = createMonoModControl("beats_per_minute", true);
     cr::LowerBound* beats_per_second_clamped = new cr::LowerBound(0.0);
     beats_per_second_clamped->plug(beats_per_second);
@@ -53,7 +63,8 @@ namespace mopo {
     // Voice Handler.
     Output* polyphony = createMonoModControl("polyphony", true);
 
-    voice_handler_ = new HelmVoiceHandler(beats_per_second_clamped->output());
+    voice_handler_ = new HelmVoiceHandler(beats_per_second_clamped->output(), effect_memory_);
+    voice_handler_->setProfileName("voices");
     addSubmodule(voice_handler_);
     voice_handler_->setPolyphony(32);
     voice_handler_->plug(polyphony, VoiceHandler::kPolyphony);
@@ -165,6 +176,11 @@ namespace mopo {
 
     addProcessor(voice_handler_);
 
+    // Effects only read the rest of the engine through latches so they can
+    // run a block behind on another thread.
+    effects_ = new PipelineRouter(NUM_CHANNELS);
+    effects_->setProfileName("effects");
+
     // Distortion
     Distortion* distortion = new Distortion();
     Value* distortion_on = createBaseControl("distortion_on");
@@ -173,79 +189,84 @@ namespace mopo {
     Output* distortion_mix = createMonoModControl("distortion_mix", true);
     cr::MagnitudeScale* distortion_gain = new cr::MagnitudeScale();
     distortion_gain->plug(distortion_drive);
-
-    distortion->plug(voice_handler_, Distortion::kAudio);
-    distortion->plug(distortion_on, Distortion::kOn);
-    distortion->plug(distortion_type, Distortion::kType);
-    distortion->plug(distortion_gain, Distortion::kDrive);
-    distortion->plug(distortion_mix, Distortion::kMix);
-    addProcessor(distortion);
     addProcessor(distortion_gain);
 
+    distortion->plug(effects_->latch(voice_handler_->output()), Distortion::kAudio);
+    distortion->plug(effects_->latch(distortion_on->output()), Distortion::kOn);
+    distortion->plug(effects_->latch(distortion_type->output()), Distortion::kType);
+    distortion->plug(effects_->latch(distortion_gain->output()), Distortion::kDrive);
+    distortion->plug(effects_->latch(distortion_mix), Distortion::kMix);
+    effects_->addProcessor(distortion);
+
     // Delay effect.
     Output* delay_free_frequency = createMonoModControl("delay_frequency", true);
     Output* delay_frequency = createTempoSyncSwitch("delay", delay_free_frequency->owner,
                                                     beats_per_second_clamped->output(), false);
     Output* delay_feedback = createMonoModControl("delay_feedback", true);
     Output* delay_wet = createMonoModControl("delay_dry_wet", true);
-    Value* delay_on = createBaseControl("delay_on");
+    delay_on_ = createBaseControl("delay_on");
 
     cr::Clamp* delay_feedback_clamped = new cr::Clamp(-1, 1);
-    delay_feedback_clamped->plug(delay_feedback);
+    delay_feedback_clamped->plug(effects_->latch(delay_feedback));
 
     cr::SmoothFilter* delay_frequency_smoothed = new cr::SmoothFilter(1.0);
-    delay_frequency_smoothed->plug(delay_frequency, cr::SmoothFilter::kTarget);
+    delay_frequency_smoothed->plug(effects_->latch(delay_frequency), cr::SmoothFilter::kTarget);
     delay_frequency_smoothed->plug(&utils::value_fifth, cr::SmoothFilter::kHalfLife);
     cr::FrequencyToSamples* delay_samples = new cr::FrequencyToSamples();
     delay_samples->plug(delay_frequency_smoothed);
 
-    Delay* delay = new Delay(MAX_DELAY_SAMPLES);
-    delay->plug(distortion, Delay::kAudio);
-    delay->plug(delay_samples, Delay::kSampleDelay);
-    delay->plug(delay_feedback_clamped, Delay::kFeedback);
-    delay->plug(delay_wet, Delay::kWet);
+    delay_ = new Delay(MAX_DELAY_SECONDS, effect_memory_);
+    delay_->plug(distortion, Delay::kAudio);
+    delay_->plug(delay_samples, Delay::kSampleDelay);
+    delay_->plug(delay_feedback_clamped, Delay::kFeedback);
+    delay_->plug(effects_->latch(delay_wet), Delay::kWet);
 
     BypassRouter* delay_container = new BypassRouter();
-    delay_container->plug(delay_on, BypassRouter::kOn);
+    delay_container->setProfileName("delay");
+    delay_container->plug(effects_->latch(delay_on_->output()), BypassRouter::kOn);
     delay_container->plug(distortion, BypassRouter::kAudio);
     delay_container->addProcessor(delay_feedback_clamped);
     delay_container->addProcessor(delay_frequency_smoothed);
     delay_container->addProcessor(delay_samples);
-    delay_container->addProcessor(delay);
-    delay_container->registerOutput(delay->output());
+    delay_container->addProcessor(delay_);
+    delay_container->registerOutput(delay_->output());
 
-    addProcessor(delay_container);
+    effects_->addProcessor(delay_container);
 
     // DC Blocker.
-    DcFilter* dc_filter = new DcFilter();
-    dc_filter->plug(delay_container, DcFilter::kAudio);
+    dc_filter_ = new DcFilter();
+    dc_filter_->plug(delay_container, DcFilter::kAudio);
 
-    addProcessor(dc_filter);
+    effects_->addProcessor(dc_filter_);
 
     // Reverb Effect.
     Output* reverb_feedback = createMonoModControl("reverb_feedback", true);
     Output* reverb_damping = createMonoModControl("reverb_damping", true);
     Output* reverb_wet = createMonoModControl("reverb_dry_wet", true);
-    Value* reverb_on = createBaseControl("reverb_on");
+    reverb_on_ = createBaseControl("reverb_on");
 
     cr::Clamp* reverb_feedback_clamped = new cr::Clamp(-1, 1);
-    reverb_feedback_clamped->plug(reverb_feedback);
+    reverb_feedback_clamped->plug(effects_->latch(reverb_feedback));
 
-    Reverb* reverb = new Reverb();
-    reverb->plug(dc_filter, Reverb::kAudio);
-    reverb->plug(reverb_feedback_clamped, Reverb::kFeedback);
-    reverb->plug(reverb_damping, Reverb::kDamping);
-    reverb->plug(reverb_wet, Reverb::kWet);
+    reverb_ = new Reverb(effect_memory_);
+    reverb_->plug(dc_filter_, Reverb::kAudio);
+    reverb_->plug(reverb_feedback_clamped, Reverb::kFeedback);
+    reverb_->plug(effects_->latch(reverb_damping), Reverb::kDamping);
+    reverb_->plug(effects_->latch(reverb_wet), Reverb::kWet);
 
     BypassRouter* reverb_container = new BypassRouter();
-    reverb_container->plug(reverb_on, BypassRouter::kOn);
-    reverb_container->plug(dc_filter, BypassRouter::kAudio);
-    reverb_container->addProcessor(reverb);
+    reverb_container->setProfileName("reverb");
+    reverb_container->plug(effects_->latch(reverb_on_->output()), BypassRouter::kOn);
+    reverb_container->plug(dc_filter_, BypassRouter::kAudio);
+    reverb_container->addProcessor(reverb_);
     reverb_container->addProcessor(reverb_feedback_clamped);
-    reverb_container->registerOutput(reverb->output(0));
-    reverb_container->registerOutput(reverb->output(1));
+    reverb_container->registerOutput(reverb_->output(0));
+    reverb_container->registerOutput(reverb_->output(1));
 
-    addProcessor(reverb_container);
+    effects_->addProcessor(reverb_container);
+    effects_->setChainOutput(reverb_container->output(0), 0);
+    effects_->setChainOutput(reverb_container->output(1), 1);
+    addProcessor(effects_);
 
     // Volume.
     Output* volume = createMonoModControl("volume", true);
@@ -253,11 +274,11 @@ namespace mopo {
     smooth_volume->plug(volume);
 
     Multiply* scaled_audio_left = new Multiply();
-    scaled_audio_left->plug(reverb_container->output(0), 0);
+    scaled_audio_left->plug(effects_->output(0), 0);
     scaled_audio_left->plug(smooth_volume, 1);
 
     Multiply* scaled_audio_right = new Multiply();
-    scaled_audio_right->plug(reverb_container->output(1), 0);
+    scaled_audio_right->plug(effects_->output(1), 0);
     scaled_audio_right->plug(smooth_volume, 1);
 
     peak_meter_ = new PeakMeter();
@@ -286,6 +307,14 @@ namespace mopo {
   }
 
   void HelmEngine::connectModulation(ModulationConnection* connection) {
+    GraphEdit edit;
+    connectModulation(connection, &edit);
+    edit.prepare();
+    edit.commit();
+  }
+
+  void HelmEngine::connectModulation(ModulationConnection* connection,
+                                     GraphEdit* edit) {
     Output* source = getModulationSource(connection->source);
     bool source_poly = source->owner->isPolyphonic();
     MOPO_ASSERT(source != nullptr);
@@ -296,17 +325,19 @@ namespace mopo {
     ValueSwitch* mono_mod_switch = getMonoModulationSwitch(connection->destination);
     MOPO_ASSERT(mono_mod_switch != nullptr);
 
-    connection->modulation_scale.plug(source, 0);
-    connection->modulation_scale.plug(&connection->amount, 1);
-    source->owner->router()->addProcessor(&connection->modulation_scale);
-    destination->plugNext(&connection->modulation_scale);
+    Processor* scale = &connection->modulation_scale;
+    edit->plug(scale, source, 0);
+    edit->plug(scale, connection->amount.output(), 1);
+    edit->addProcessor(source->owner->router(), scale);
+    edit->plugNext(destination, scale->output());
 
-    mono_mod_switch->set(1);
+    edit->set(mono_mod_switch, 1);
     ValueSwitch* poly_mod_switch = getPolyModulationSwitch(connection->destination);
     if (poly_mod_switch)
-      poly_mod_switch->set(1);
+      edit->set(poly_mod_switch, 1);
 
     mod_connections_.insert(connection);
+    updateModulationScales(edit);
   }
 
   bool HelmEngine::isModulationActive(ModulationConnection* connection) {
@@ -320,6 +351,14 @@ namespace mopo {
   }
 
   void HelmEngine::disconnectModulation(ModulationConnection* connection) {
+    GraphEdit edit;
+    disconnectModulation(connection, &edit);
+    edit.prepare();
+    edit.commit();
+  }
+
+  void HelmEngine::disconnectModulation(ModulationConnection* connection,
+                                        GraphEdit* edit) {
     Output* source = getModulationSource(connection->source);
     bool source_poly = source->owner->isPolyphonic();
 
@@ -328,20 +367,29 @@ namespace mopo {
     Processor* poly_destination = getPolyModulationDestination(connection->destination);
     MOPO_ASSERT(destination != nullptr);
 
-    destination->unplug(&connection->modulation_scale);
+    Processor* scale = &connection->modulation_scale;
+    edit->unplug(destination, scale);
 
-    if (mono_destination->connectedInputs() == 1 &&
-        (poly_destination == nullptr || poly_destination->connectedInputs() == 0)) {
+    if (edit->connectedInputs(mono_destination) == 1 &&
+        (poly_destination == nullptr || edit->connectedInputs(poly_destination) == 0)) {
       ValueSwitch* mono_mod_switch = getMonoModulationSwitch(connection->destination);
-      mono_mod_switch->set(0);
+      edit->set(mono_mod_switch, 0);
 
       ValueSwitch* poly_mod_switch = getPolyModulationSwitch(connection->destination);
       if (poly_mod_switch)
-        poly_mod_switch->set(0);
+        edit->set(poly_mod_switch, 0);
     }
 
-    source->owner->router()->removeProcessor(&connection->modulation_scale);
+    edit->removeProcessor(source->owner->router(), scale);
     mod_connections_.erase(connection);
+    updateModulationScales(edit);
+  }
+
+  void HelmEngine::updateModulationScales(GraphEdit* edit) {
+    std::vector<Processor*> scales;
+    for (ModulationConnection* connection : mod_connections_)
+      scales.push_back(&connection->modulation_scale);
+    edit->replaceList(&modulation_scales_, scales);
   }
 
   int HelmEngine::getNumActiveVoices() {
@@ -352,19 +400,91 @@ namespace mopo {
     return voice_handler_->getLastActiveNote();
   }
 
+  const CircularQueue<Voice*>& HelmEngine::getAllVoices() const {
+    return voice_handler_->getAllVoices();
+  }
+
+  void HelmEngine::setNumVoiceThreads(int num_threads) {
+    voice_handler_->setNumVoiceThreads(num_threads);
+  }
+
+  void HelmEngine::setFilterBank(bool bank) {
+    voice_handler_->setFilterBank(bank);
+  }
+
+  void HelmEngine::setPipelinedEffects(bool pipelined, int max_buffer_size) {
+    effects_->setPipelined(pipelined, max_buffer_size);
+  }
+
+  int HelmEngine::getLatency() const {
+    return effects_->getLatency();
+  }
+
+  void HelmEngine::wake() {
+    settle_samples_ = IDLE_SETTLE_SECONDS * getSampleRate();
+  }
+
+  bool HelmEngine::isIdle() {
+    if (settle_samples_ > 0 || getNumActiveVoices() || arpeggiator_->getNumNotes())
+      return false;
+
+    // Bypassed effects keep whatever tail they had when they were turned off.
+    if (delay_on_->value() && !delay_->isSilent())
+      return false;
+    if (reverb_on_->value() && !reverb_->isSilent())
+      return false;
+
+    const mopo_float* peaks = peak_meter_->output()->buffer;
+    return dc_filter_->isSilent() && peaks[0] == 0.0 && peaks[1] == 0.0;
+  }
+
+  void HelmEngine::processIdle() {
+    // Nothing can be heard and nothing is moving so skip the whole graph.
+    // Mono LFOs and the step sequencer hold their phase until woken.
+    utils::zeroBuffer(output(0)->buffer, buffer_size_);
+    utils::zeroBuffer(output(1)->buffer, buffer_size_);
+  }
+
   void HelmEngine::process() {
+    effect_memory_->advance(buffer_size_);
+    if (isIdle()) {
+      processIdle();
+#if MOPO_PROFILE
+      profile_.endBlock();
+#endif
+      return;
+    }
+    settle_samples_ = std::max(settle_samples_ - buffer_size_, 0);
+
     bool playing_arp = arp_on_->value();
     if (was_playing_arp_ != playing_arp)
       arpeggiator_->allNotesOff();
 
     was_playing_arp_ = playing_arp;
     arpeggiator_->process();
-    ProcessorRouter::process();
+
+    if (effects_->isPipelined()) {
+      // Effects render last block while everything feeding them renders this.
+      effects_->startPipeline();
+      processBefore(effects_);
+      effects_->finishPipeline();
+      processAfter(effects_);
+    }
+    else
+      ProcessorRouter::process();
 
     if (getNumActiveVoices() == 0) {
-      for (auto& modulation : mod_connections_)
-        modulation->modulation_scale.process();
+      for (Processor* modulation_scale : modulation_scales_) {
+        mopo_float last_value = modulation_scale->output()->buffer[0];
+        modulation_scale->process();
+        if (modulation_scale->output()->buffer[0] != last_value)
+          modulation_scale->output()->markChanged();
+      }
     }
+
+#if MOPO_PROFILE
+    profile_.endBlock();
+#endif
   }
 
   void HelmEngine::setBufferSize(int buffer_size) {
@@ -416,7 +536,7 @@ namespace mopo {
       bps_->set(bps);
   }
 
-  void HelmEngine::correctToTime(mopo_float samples) {
+  void HelmEngine::correctToTime(double samples) {
     HelmModule::correctToTime(samples);
     if (lfo_1_retrigger_->value() == 2.0)
       lfo_1_->correctToTime(samples);
@@ -429,7 +549,7 @@ namespace mopo {
     voice_handler_->sustainOn();
   }
 
-  void HelmEngine::sustainOff() {
-    voice_handler_->sustainOff();
+  void HelmEngine::sustainOff(int sample) {
+    voice_handler_->sustainOff(sample);
   }
 } // namespace mopo
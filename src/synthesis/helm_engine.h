@@ -24,9 +24,11 @@
 
 namespace mopo {
   class Arpeggiator;
+  class DcFilter;
   class HelmVoiceHandler;
   class HelmLfo;
   class PeakMeter;
+  class PipelineRouter;
   class Value;
   class ValueSwitch;
 
@@ -39,6 +41,11 @@ namespace mopo {
       void init() override;
 
       void process() override;
+
+      // Parameter changes wake the engine so controls can settle before it
+      // goes idle again.
+      void wake();
+      bool isIdle();
       void setBufferSize(int buffer_size) override;
       void setSampleRate(int sample_rate) override;
 
@@ -47,8 +54,29 @@ namespace mopo {
       CircularQueue<mopo::mopo_float>& getPressedNotes();
       void connectModulation(ModulationConnection* connection);
       void disconnectModulation(ModulationConnection* connection);
+
+      // Stage the same changes into _edit_ instead of applying them. Nothing
+      // the audio thread reads is touched until the edit is committed.
+      void connectModulation(ModulationConnection* connection, GraphEdit* edit);
+      void disconnectModulation(ModulationConnection* connection, GraphEdit* edit);
+
       int getNumActiveVoices();
       mopo_float getLastActiveNote() const;
+      const CircularQueue<Voice*>& getAllVoices() const;
+      void setNumVoiceThreads(int num_threads);
+      void setFilterBank(bool bank);
+
+      // Pipelined effects run a block behind the voices on their own thread
+      // and delay the output by _max_buffer_size_ samples. Blocks can't be
+      // longer than getLatency() while pipelined. Call while audio isn't
+      // running.
+      void setPipelinedEffects(bool pipelined, int max_buffer_size);
+      int getLatency() const;
+
+#if MOPO_PROFILE
+      // Per block averages since the last call. Safe to call while audio runs.
+      void getProfile(std::vector<Profiler::Stats>& stats) { profile_.collect(stats); }
+#endif
 
       // Keyboard events.
       void allNotesOff(int sample = 0) override;
@@ -58,15 +86,18 @@ namespace mopo {
       void setModWheel(mopo_float value, int channel = 0);
       void setPitchWheel(mopo_float value, int channel = 0);
       void setBpm(mopo_float bpm);
-      void correctToTime(mopo_float samples) override;
+      void correctToTime(double samples) override;
       void setAftertouch(mopo_float note, mopo_float value, int sample = 0);
       void setChannelAftertouch(int channel, mopo_float value, int sample = 0);
 
       // Sustain pedal events.
       void sustainOn();
-      void sustainOff();
+      void sustainOff(int sample = 0);
 
     private:
+      void updateModulationScales(GraphEdit* edit);
+      void processIdle();
+
       HelmVoiceHandler* voice_handler_;
       Arpeggiator* arpeggiator_;
       ValueSwitch* arp_on_;
@@ -79,9 +110,27 @@ namespace mopo {
       HelmLfo* lfo_1_;
       HelmLfo* lfo_2_;
       PeakMeter* peak_meter_;
+      PipelineRouter* effects_;
+      Value* delay_on_;
+      Value* reverb_on_;
+      Delay* delay_;
+      DcFilter* dc_filter_;
+      Reverb* reverb_;
+      int settle_samples_;
       StepGenerator* step_sequencer_;
 
+      // Shared with the effects so their memory is freed after this engine
+      // has been silent long enough.
+      std::shared_ptr<LazyMemory::Registry> effect_memory_;
+
       std::set<ModulationConnection*> mod_connections_;
+
+      // Modulation scales of mod_connections_, swapped in by GraphEdits.
+      std::vector<Processor*> modulation_scales_;
+
+#if MOPO_PROFILE
+      Profiler profile_;
+#endif
   };
 } // namespace mopo
 
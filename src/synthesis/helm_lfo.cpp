@@ -22,13 +22,6 @@
 
 namespace mopo {
 
-  namespace {
-    mopo_float randomLfoValue() {
-      return 2.0 * rand() / RAND_MAX - 1.0;
-    }
-  } // namespace
-
-
   HelmLfo::HelmLfo() : Processor(kNumInputs, kNumOutputs, true), offset_(0.0),
                        last_random_value_(0.0), current_random_value_(0.0) { }
 
@@ -39,19 +32,19 @@ namespace mopo {
       num_samples = samples_to_process_ - input(kReset)->source->trigger_offset;
       offset_ = 0.0;
       last_random_value_ = current_random_value_;
-      current_random_value_ = randomLfoValue();
+      current_random_value_ = random_.nextBipolar();
     }
 
     Wave::Type waveform = static_cast<Wave::Type>(static_cast<int>(input(kWaveform)->at(0)));
     mopo_float frequency = input(kFrequency)->at(0);
     mopo_float phase = input(kPhase)->at(0);
 
-    offset_ += num_samples * frequency / sample_rate_;
+    offset_ += (1.0 * num_samples) * frequency / sample_rate_;
 
-    mopo_float offset_integral;
+    double offset_integral;
     offset_ = utils::mod(offset_, &offset_integral);
 
-    mopo_float phase_integral;
+    double phase_integral;
     mopo_float phased_offset = utils::mod(offset_ + phase, &phase_integral);
 
     output(kOscPhase)->buffer[0] = phased_offset;
@@ -61,7 +54,7 @@ namespace mopo {
     else {
       if (offset_integral) {
         last_random_value_ = current_random_value_;
-        current_random_value_ = randomLfoValue();
+        current_random_value_ = random_.nextBipolar();
       }
       if (waveform == Wave::kWhiteNoise)
         output(kValue)->buffer[0] = current_random_value_;
@@ -74,10 +67,10 @@ namespace mopo {
     }
   }
 
-  void HelmLfo::correctToTime(mopo_float samples) {
+  void HelmLfo::correctToTime(double samples) {
     mopo_float frequency = input(kFrequency)->at(0);
     offset_ = samples * frequency / sample_rate_;
-    mopo_float integral;
+    double integral;
     offset_ = utils::mod(offset_, &integral);
   }
 } // namespace mopo
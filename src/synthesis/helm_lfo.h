@@ -19,6 +19,7 @@
 #define HELM_LFO_H
 
 #include "processor.h"
+#include "random_generator.h"
 #include "wave.h"
 
 namespace mopo {
@@ -46,12 +47,14 @@ namespace mopo {
 
       virtual Processor* clone() const override { return new HelmLfo(*this); }
       void process() override;
-      void correctToTime(mopo_float samples);
+      void correctToTime(double samples);
 
     protected:
-      mopo_float offset_;
+      // Kept in double precision so the phase doesn't drift in float builds.
+      double offset_;
       mopo_float last_random_value_;
       mopo_float current_random_value_;
+      RandomGenerator random_;
   };
 } // namespace mopo
 
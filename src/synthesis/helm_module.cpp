@@ -371,7 +371,7 @@ namespace mopo {
     return all_readouts;
   }
 
-  void HelmModule::correctToTime(mopo_float samples) {
+  void HelmModule::correctToTime(double samples) {
     for (HelmModule* sub_module : sub_modules_)
       sub_module->correctToTime(samples);
   }
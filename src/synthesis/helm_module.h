@@ -50,7 +50,7 @@ namespace mopo {
       output_map& getModulationSources();
       virtual output_map& getMonoModulations();
       virtual output_map& getPolyModulations();
-      virtual void correctToTime(mopo_float samples);
+      virtual void correctToTime(double samples);
 
     protected:
       // Creates a basic linear non-scaled control.
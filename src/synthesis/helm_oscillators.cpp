@@ -16,11 +16,125 @@
 
 #include "helm_oscillators.h"
 
+#include "cpu_features.h"
 #include "detune_lookup.h"
 
+#if MOPO_X86
+#include <immintrin.h>
+#endif
+
 #define RAND_DECAY 0.999
 
 namespace mopo {
+
+  namespace {
+    void tickVoices(mopo_float* totals, const int* cross_mods,
+                    const int* phase_diffs, const float* wave_buffer,
+                    unsigned int start_phase, int detune, int start, int end) {
+      for (int i = start; i < end; ++i) {
+        int phase = cross_mods[i] + start_phase + i * detune + phase_diffs[i];
+        totals[i] += FixedPointWave::interpretWave(wave_buffer, phase);
+      }
+    }
+
+#if MOPO_X86
+    // Gathers the value and delta pairs for four phases in one load and
+    // splits them into values in the low half and deltas in the high half.
+    MOPO_TARGET_AVX2
+    inline __m256 gatherPairs(const float* wave_buffer, __m128i indices) {
+      const __m256i split = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+      __m256i pairs = _mm256_i32gather_epi64(reinterpret_cast<const long long*>(wave_buffer),
+                                             indices, 2 * sizeof(float));
+      return _mm256_permutevar8x32_ps(_mm256_castsi256_ps(pairs), split);
+    }
+#endif
+
+#if MOPO_X86 && MOPO_FLOAT
+    // Runs eight samples per step with the phase math in integer lanes and
+    // each table pair gathered at once. Adds in the same order as tickVoices.
+    // The two match exactly unless -ffast-math reorders the scalar loop.
+    MOPO_TARGET_AVX2
+    void tickVoicesAvx2(mopo_float* totals, const int* cross_mods,
+                        const int* phase_diffs, const float* wave_buffer,
+                        unsigned int start_phase, int detune, int start, int end) {
+      const __m256i fractional_mask =
+          _mm256_set1_epi32(FixedPointWaveLookup::FRACTIONAL_MASK);
+      const __m256i start_phases = _mm256_set1_epi32(start_phase);
+      const __m256i detune_step = _mm256_set1_epi32(8u * detune);
+
+      __m256i detunes = _mm256_mullo_epi32(_mm256_setr_epi32(start, start + 1, start + 2,
+                                                             start + 3, start + 4, start + 5,
+                                                             start + 6, start + 7),
+                                           _mm256_set1_epi32(detune));
+
+      int i = start;
+      for (; i + 8 <= end; i += 8) {
+        __m256i cross_mod = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cross_mods + i));
+        __m256i phase_diff = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(phase_diffs + i));
+        __m256i phases = _mm256_add_epi32(_mm256_add_epi32(cross_mod, start_phases), detunes);
+        phases = _mm256_add_epi32(phases, phase_diff);
+
+        __m256i indices = _mm256_srli_epi32(phases, FixedPointWaveLookup::FRACTIONAL_BITS);
+        __m256 fractions = _mm256_cvtepi32_ps(_mm256_and_si256(phases, fractional_mask));
+        __m256 low = gatherPairs(wave_buffer, _mm256_castsi256_si128(indices));
+        __m256 high = gatherPairs(wave_buffer, _mm256_extracti128_si256(indices, 1));
+        __m256 values = _mm256_permute2f128_ps(low, high, 0x20);
+        __m256 diffs = _mm256_permute2f128_ps(low, high, 0x31);
+
+        values = _mm256_add_ps(values, _mm256_mul_ps(fractions, diffs));
+        _mm256_storeu_ps(totals + i, _mm256_add_ps(_mm256_loadu_ps(totals + i), values));
+        detunes = _mm256_add_epi32(detunes, detune_step);
+      }
+
+      tickVoices(totals, cross_mods, phase_diffs, wave_buffer, start_phase, detune, i, end);
+    }
+#elif MOPO_X86
+    // Runs four samples per step with the phase math in integer lanes and
+    // each table pair gathered at once. Adds in the same order as tickVoices
+    // so the output matches it exactly.
+    MOPO_TARGET_AVX2
+    void tickVoicesAvx2(mopo_float* totals, const int* cross_mods,
+                        const int* phase_diffs, const float* wave_buffer,
+                        unsigned int start_phase, int detune, int start, int end) {
+      const __m128i fractional_mask =
+          _mm_set1_epi32(FixedPointWaveLookup::FRACTIONAL_MASK);
+      const __m128i start_phases = _mm_set1_epi32(start_phase);
+      const __m128i detune_step = _mm_set1_epi32(4u * detune);
+
+      __m128i detunes = _mm_mullo_epi32(_mm_setr_epi32(start, start + 1, start + 2, start + 3),
+                                        _mm_set1_epi32(detune));
+
+      int i = start;
+      for (; i + 4 <= end; i += 4) {
+        __m128i cross_mod = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cross_mods + i));
+        __m128i phase_diff = _mm_loadu_si128(reinterpret_cast<const __m128i*>(phase_diffs + i));
+        __m128i phases = _mm_add_epi32(_mm_add_epi32(cross_mod, start_phases), detunes);
+        phases = _mm_add_epi32(phases, phase_diff);
+
+        __m128i indices = _mm_srli_epi32(phases, FixedPointWaveLookup::FRACTIONAL_BITS);
+        __m256d fractions = _mm256_cvtepi32_pd(_mm_and_si128(phases, fractional_mask));
+        __m256 pairs = gatherPairs(wave_buffer, indices);
+        __m256d values = _mm256_cvtps_pd(_mm256_castps256_ps128(pairs));
+        __m256d diffs = _mm256_cvtps_pd(_mm256_extractf128_ps(pairs, 1));
+
+        values = _mm256_add_pd(values, _mm256_mul_pd(fractions, diffs));
+        _mm256_storeu_pd(totals + i, _mm256_add_pd(_mm256_loadu_pd(totals + i), values));
+        detunes = _mm_add_epi32(detunes, detune_step);
+      }
+
+      tickVoices(totals, cross_mods, phase_diffs, wave_buffer, start_phase, detune, i, end);
+    }
+#endif
+
+    HelmOscillators::VoiceKernel getVoiceKernel() {
+#if MOPO_X86
+      if (CpuFeatures::hasAvx2())
+        return tickVoicesAvx2;
+#endif
+      return tickVoices;
+    }
+  } // namespace
+
   const mopo_float HelmOscillators::scales[] = {
       1.0, 1.0,
       sqrt(1.0 / 2.0), sqrt(1.0 / 2.0),
@@ -32,7 +146,8 @@ namespace mopo {
       sqrt(1.0 / 8.0), sqrt(1.0 / 8.0),
   };
 
-  HelmOscillators::HelmOscillators() : Processor(kNumInputs, 1) {
+  HelmOscillators::HelmOscillators() : Processor(kNumInputs, 1),
+                                       voice_kernel_(getVoiceKernel()) {
     utils::zeroBuffer(oscillator1_cross_mods_, MAX_BUFFER_SIZE + 1);
     utils::zeroBuffer(oscillator2_cross_mods_, MAX_BUFFER_SIZE + 1);
 
@@ -66,8 +181,8 @@ namespace mopo {
     oscillator2_phases_[0] = 0;
 
     for (int u = 1; u < MAX_UNISON; ++u) {
-      oscillator1_phases_[u] = (UINT_MAX / RAND_MAX) * rand();
-      oscillator2_phases_[u] = (UINT_MAX / RAND_MAX) * rand();
+      oscillator1_phases_[u] = random_.next();
+      oscillator2_phases_[u] = random_.next();
     }
   }
 
@@ -110,7 +225,7 @@ namespace mopo {
     }
   }
 
-  void HelmOscillators::prepareBuffers(mopo_float** wave_buffers,
+  void HelmOscillators::prepareBuffers(const float** wave_buffers,
                                        const int* detune_diffs,
                                        const int* oscillator_phase_diffs,
                                        int waveform) {
@@ -188,55 +303,52 @@ namespace mopo {
     utils::zeroBuffer(oscillator1_totals_, buffer_size_);
     utils::zeroBuffer(oscillator2_totals_, buffer_size_);
 
+    // The first voice of each oscillator is cross modulated by the other.
     int j = 0;
     if (input(kReset)->source->triggered) {
-      int trigger_offset = input(kReset)->source->trigger_offset;
-      for (; j < trigger_offset; ++j)
-        tickInitialVoices(j);
+      j = input(kReset)->source->trigger_offset;
+      voice_kernel_(oscillator1_totals_, oscillator2_cross_mods_, oscillator1_phase_diffs_,
+                    wave_buffers1_[0], oscillator1_phases_[0], 0, 0, j);
+      voice_kernel_(oscillator2_totals_, oscillator1_cross_mods_, oscillator2_phase_diffs_,
+                    wave_buffers2_[0], oscillator2_phases_[0], 0, 0, j);
 
       oscillator1_phases_[0] = 0;
       oscillator2_phases_[0] = 0;
     }
 
-    for (; j < buffer_size_; ++j)
-      tickInitialVoices(j);
+    voice_kernel_(oscillator1_totals_, oscillator2_cross_mods_, oscillator1_phase_diffs_,
+                  wave_buffers1_[0], oscillator1_phases_[0], 0, j, buffer_size_);
+    voice_kernel_(oscillator2_totals_, oscillator1_cross_mods_, oscillator2_phase_diffs_,
+                  wave_buffers2_[0], oscillator2_phases_[0], 0, j, buffer_size_);
 
-    for (int v = 1; v < voices1; ++v) {
-      const mopo_float* wave_buffer = wave_buffers1_[v];
-      unsigned int start_phase = oscillator1_phases_[v];
-      int detune = detune_diffs1_[v];
-
-      int i = 0;
-      if (input(kReset)->source->triggered) {
-        int trigger_offset = input(kReset)->source->trigger_offset;
-        for (; i < trigger_offset; ++i)
-          tickVoice1(i, v, wave_buffer, start_phase, detune);
-
-        oscillator1_phases_[v] = (UINT_MAX / RAND_MAX) * rand();
-      }
+    processUnison(oscillator1_totals_, oscillator1_cross_mods_, oscillator1_phase_diffs_,
+                  wave_buffers1_, oscillator1_phases_, detune_diffs1_, voices1);
+    processUnison(oscillator2_totals_, oscillator2_cross_mods_, oscillator2_phase_diffs_,
+                  wave_buffers2_, oscillator2_phases_, detune_diffs2_, voices2);
 
-      for (; i < buffer_size_; ++i)
-        tickVoice1(i, v, wave_buffer, start_phase, detune);
-    }
+    finishVoices(voices1, voices2);
+  }
 
-    for (int v = 1; v < voices2; ++v) {
-      const mopo_float* wave_buffer = wave_buffers2_[v];
-      unsigned int start_phase = oscillator2_phases_[v];
-      int detune = detune_diffs2_[v];
+  void HelmOscillators::processUnison(mopo_float* totals, const int* cross_mods,
+                                      const int* phase_diffs, const float** wave_buffers,
+                                      unsigned int* phases, const int* detune_diffs,
+                                      int voices) {
+    for (int v = 1; v < voices; ++v) {
+      const float* wave_buffer = wave_buffers[v];
+      unsigned int start_phase = phases[v];
+      int detune = detune_diffs[v];
 
       int i = 0;
       if (input(kReset)->source->triggered) {
-        int trigger_offset = input(kReset)->source->trigger_offset;
-        for (; i < trigger_offset; ++i)
-          tickVoice2(i, v, wave_buffer, start_phase, detune);
+        i = input(kReset)->source->trigger_offset;
+        voice_kernel_(totals, cross_mods, phase_diffs, wave_buffer, start_phase, detune, 0, i);
 
-        oscillator2_phases_[v] = (UINT_MAX / RAND_MAX) * rand();
+        phases[v] = random_.next();
       }
-      for (; i < buffer_size_; ++i)
-        tickVoice2(i, v, wave_buffer, start_phase, detune);
-    }
 
-    finishVoices(voices1, voices2);
+      voice_kernel_(totals, cross_mods, phase_diffs, wave_buffer,
+                    start_phase, detune, i, buffer_size_);
+    }
   }
 
   void HelmOscillators::finishVoices(int voices1, int voices2) {
@@ -28,6 +28,13 @@ namespace mopo {
       static const int MAX_UNISON = 15;
       static const mopo_float scales[];
 
+      // Adds one unison voice into _totals_ for samples [start, end).
+      typedef void (*VoiceKernel)(mopo_float* totals, const int* cross_mods,
+                                  const int* phase_diffs,
+                                  const float* wave_buffer,
+                                  unsigned int start_phase, int detune,
+                                  int start, int end);
+
       enum Inputs {
         kOscillator1Waveform,
         kOscillator2Waveform,
@@ -61,7 +68,7 @@ namespace mopo {
                                int oscillator_diff,
                                bool harmonize, mopo_float detune,
                                int voices);
-      void prepareBuffers(mopo_float** wave_buffers,
+      void prepareBuffers(const float** wave_buffers,
                           const int* detune_diffs,
                           const int* oscillator_phase_diffs,
                           int waveform);
@@ -69,6 +76,10 @@ namespace mopo {
       void processInitial();
       void processCrossMod();
       void processVoices();
+      void processUnison(mopo_float* totals, const int* cross_mods,
+                         const int* phase_diffs, const float** wave_buffers,
+                         unsigned int* phases, const int* detune_diffs,
+                         int voices);
       void finishVoices(int voices1, int voices2);
 
       inline void tickCrossMod(int i, const mopo_float cross_mod,
@@ -84,28 +95,6 @@ namespace mopo {
         dest_cross_mod2[i + 1] = sin2 * cross_mod * INT_MAX;
       }
 
-      inline void tickInitialVoices(int i) {
-        int phase1 = oscillator2_cross_mods_[i] + oscillator1_phases_[0] + oscillator1_phase_diffs_[i];
-        int phase2 = oscillator1_cross_mods_[i] + oscillator2_phases_[0] + oscillator2_phase_diffs_[i];
-
-        oscillator1_totals_[i] += FixedPointWave::interpretWave(wave_buffers1_[0], phase1);
-        oscillator2_totals_[i] += FixedPointWave::interpretWave(wave_buffers2_[0], phase2);
-      }
-
-      inline void tickVoice1(int i, int voice, const mopo_float* wave_buffer,
-                             unsigned int start_phase, int detune) {
-        int phase = oscillator1_cross_mods_[i] + start_phase +
-                    i * detune + oscillator1_phase_diffs_[i];
-        oscillator1_totals_[i] += FixedPointWave::interpretWave(wave_buffer, phase);
-      }
-
-      inline void tickVoice2(int i, int voice, const mopo_float* wave_buffer,
-                             unsigned int start_phase, int detune) {
-        int phase = oscillator2_cross_mods_[i] + start_phase +
-                    i * detune + oscillator2_phase_diffs_[i];
-        oscillator2_totals_[i] += FixedPointWave::interpretWave(wave_buffer, phase);
-      }
-
       inline void tickOut(int i, mopo_float* dest,
                           const mopo_float* amp1, const mopo_float* amp2,
                           const mopo_float* oscillator1_totals,
@@ -128,12 +117,16 @@ namespace mopo {
       unsigned int oscillator1_phases_[MAX_UNISON];
       unsigned int oscillator2_phases_[MAX_UNISON];
 
-      mopo_float* wave_buffers1_[MAX_UNISON];
-      mopo_float* wave_buffers2_[MAX_UNISON];
+      const float* wave_buffers1_[MAX_UNISON];
+      const float* wave_buffers2_[MAX_UNISON];
       int detune_diffs1_[MAX_UNISON];
       int detune_diffs2_[MAX_UNISON];
       int oscillator1_phase_diffs_[MAX_BUFFER_SIZE];
       int oscillator2_phase_diffs_[MAX_BUFFER_SIZE];
+
+      RandomGenerator random_;
+
+      VoiceKernel voice_kernel_;
   };
 } // namespace mopo
 
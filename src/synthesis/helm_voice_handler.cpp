@@ -32,7 +32,7 @@
 #define MIN_GAIN_DB -24.0
 #define MAX_GAIN_DB 24.0
 
-#define MAX_FEEDBACK_SAMPLES 8000
+#define MAX_FEEDBACK_SECONDS 0.18
 
 namespace mopo {
 
@@ -92,9 +92,9 @@ namespace mopo {
     };
   } // namespace
 
-  HelmVoiceHandler::HelmVoiceHandler(Output* beats_per_second) :
+  HelmVoiceHandler::HelmVoiceHandler(Output* beats_per_second, std::shared_ptr<LazyMemory::Registry> effect_memory) :
       ProcessorRouter(VoiceHandler::kNumInputs, 0), VoiceHandler(MAX_POLYPHONY),
-      beats_per_second_(beats_per_second) {
+      beats_per_second_(beats_per_second), effect_memory_(effect_memory), filter_(nullptr) {
     output_ = new Multiply();
     registerOutput(output_->output());
   }
@@ -345,7 +345,7 @@ namespace mopo {
     osc_feedback_amount_audio->plug(osc_feedback_amount_clamped, LinearSmoothBuffer::kValue);
     osc_feedback_amount_audio->plug(reset, LinearSmoothBuffer::kTrigger);
 
-    osc_feedback_ = new SimpleDelay(MAX_FEEDBACK_SAMPLES);
+    osc_feedback_ = new SimpleDelay(MAX_FEEDBACK_SECONDS);
     osc_feedback_->plug(oscillator_noise_sum, SimpleDelay::kAudio);
     osc_feedback_->plug(osc_feedback_samples_audio, SimpleDelay::kSampleDelay);
     osc_feedback_->plug(osc_feedback_amount_audio, SimpleDelay::kFeedback);
@@ -476,6 +476,7 @@ namespace mopo {
      */
 
     StateVariableFilter* filter = new StateVariableFilter();
+    filter_ = filter;
     filter->plug(filter_on, StateVariableFilter::kOn);
     filter->plug(filter_style, StateVariableFilter::kStyle);
     filter->plug(filter_shelf, StateVariableFilter::kShelfChoice);
@@ -504,13 +505,14 @@ namespace mopo {
 
     // Stutter.
     BypassRouter* stutter_container = new BypassRouter();
+    stutter_container->setProfileName("stutter");
     addProcessor(stutter_container);
 
     ValueSwitch* stutter_on = createBaseSwitchControl("stutter_on");
     stutter_container->plug(stutter_on, BypassRouter::kOn);
     stutter_container->plug(filter, BypassRouter::kAudio);
 
-    Stutter* stutter = new Stutter(STUTTER_MAX_SAMPLES);
+    Stutter* stutter = new Stutter(STUTTER_MAX_SECONDS, effect_memory_);
     Output* stutter_free_frequency = createPolyModControl("stutter_frequency", true);
     Output* stutter_frequency = createTempoSyncSwitch("stutter", stutter_free_frequency->owner,
                                                       beats_per_second_, true, stutter_on);
@@ -532,6 +534,7 @@ namespace mopo {
 
     // Formant Filter.
     formant_container_ = new BypassRouter();
+    formant_container_->setProfileName("formant");
     addProcessor(formant_container_);
 
     ValueSwitch* formant_on = createBaseSwitchControl("formant_on");
@@ -751,8 +754,11 @@ namespace mopo {
     note_retriggered_.clearTrigger();
 
     if (getNumActiveVoices() == 0) {
-      for (auto& mod_source : mod_sources_)
+      for (auto& mod_source : mod_sources_) {
+        if (mod_source.second->buffer[0] != 0.0)
+          mod_source.second->markChanged();
         mod_source.second->buffer[0] = 0.0;
+      }
     }
   }
 
@@ -795,6 +801,13 @@ namespace mopo {
     pitch_wheel_amounts_[channel - 1]->set(value);
   }
 
+  void HelmVoiceHandler::setFilterBank(bool bank) {
+    if (bank)
+      setVoiceBank(filter_, StateVariableFilter::processBank);
+    else
+      setVoiceBank(nullptr, nullptr);
+  }
+
   output_map& HelmVoiceHandler::getPolyModulations() {
     return poly_readouts_;
   }
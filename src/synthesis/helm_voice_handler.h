@@ -22,6 +22,7 @@
 #include "helm_common.h"
 #include "helm_module.h"
 
+#include <memory>
 #include <vector>
 
 namespace mopo {
@@ -37,6 +38,7 @@ namespace mopo {
   class LinearSlope;
   class Oscillator;
   class SmoothValue;
+  class StateVariableFilter;
   class StepGenerator;
   class TriggerCombiner;
   class HelmOscillators;
@@ -46,7 +48,7 @@ namespace mopo {
   // contained in here.
   class HelmVoiceHandler : public virtual VoiceHandler, public virtual HelmModule {
     public:
-      HelmVoiceHandler(Output* beats_per_second);
+      HelmVoiceHandler(Output* beats_per_second, std::shared_ptr<LazyMemory::Registry> effect_memory);
       virtual ~HelmVoiceHandler() { } // Should probably delete things.
 
       void init() override;
@@ -60,6 +62,10 @@ namespace mopo {
       void setPitchWheel(mopo_float value, int channel = 0);
       Output* note_retrigger() { return &note_retriggered_; }
 
+      // Runs every voice's filter together through one bank. Voices get
+      // isolated so call this while audio isn't running.
+      void setFilterBank(bool bank);
+
       // HelmModule
       output_map& getPolyModulations() override;
 
@@ -80,6 +86,7 @@ namespace mopo {
       void setupPolyModulationReadouts();
 
       Output* beats_per_second_;
+      std::shared_ptr<LazyMemory::Registry> effect_memory_;
 
       Processor* note_from_center_;
       Gate* choose_pitch_wheel_;
@@ -97,6 +104,7 @@ namespace mopo {
       Distortion* distorted_filter_;
       FormantManager* formant_filter_;
       Envelope* filter_envelope_;
+      StateVariableFilter* filter_;
       BypassRouter* formant_container_;
       Output note_retriggered_;
       HelmLfo* poly_lfo_;
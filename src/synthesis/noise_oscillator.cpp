@@ -18,9 +18,7 @@
 
 namespace mopo {
 
-  NoiseOscillator::NoiseOscillator() : Processor(kNumInputs, 1) {
-    current_noise_value_ = NOISE_CONSTANT;
-  }
+  NoiseOscillator::NoiseOscillator() : Processor(kNumInputs, 1) { }
 
   void NoiseOscillator::process() {
     mopo_float amplitude = input(kAmplitude)->source->buffer[0];
@@ -32,15 +30,6 @@ namespace mopo {
       return;
     }
 
-    int i = 0;
-    if (input(kReset)->source->triggered) {
-      int trigger_offset = input(kReset)->source->trigger_offset;
-      for (; i < trigger_offset; ++i)
-        tick(i, dest, amplitude);
-
-      current_noise_value_ = rand() / mopo_float(RAND_MAX);
-    }
-    for (; i < buffer_size_; ++i)
-      tick(i, dest, amplitude);
+    random_.fillBipolar(dest, buffer_size_, amplitude);
   }
 } // namespace mopo
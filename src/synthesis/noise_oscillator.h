@@ -22,9 +22,6 @@
 
 namespace mopo {
 
-  const mopo_float NOISE_CONSTANT = 9.19191919191919191919191919191919191919191919;
-  const int NOISE_INT_CONSTANT = NOISE_CONSTANT;
-
   class NoiseOscillator : public Processor {
     public:
       enum Inputs {
@@ -39,16 +36,7 @@ namespace mopo {
       virtual Processor* clone() const { return new NoiseOscillator(*this); }
 
     protected:
-      inline void tick(int i, mopo_float* dest, mopo_float amplitude) {
-        current_noise_value_ *= current_noise_value_;
-        current_noise_value_ = current_noise_value_ - floor(current_noise_value_);
-
-        dest[i] = amplitude * (2.0 * current_noise_value_ - 1.0);
-
-        current_noise_value_ += NOISE_INT_CONSTANT;
-      }
-
-      mopo_float current_noise_value_;
+      RandomGenerator random_;
   };
 } // namespace mopo
 
@@ -34,6 +34,7 @@ namespace mopo {
       ResonanceCancel();
 
       virtual Processor* clone() const { return new ResonanceCancel(*this); }
+      bool isStateless() const { return true; }
 
       void process();
   };
@@ -16,15 +16,13 @@
 
 #include "trigger_random.h"
 
-#include <cstdlib>
-
 namespace mopo {
 
   TriggerRandom::TriggerRandom() : Processor(1, 1, true), value_(0.0) { }
 
   void TriggerRandom::process() {
     if (input()->source->triggered)
-      value_ = 2.0 * rand() / RAND_MAX - 1.0;
+      value_ = random_.nextBipolar();
 
     output()->buffer[0] = value_;
   }
@@ -19,6 +19,7 @@
 #define TRIGGER_RANDOM_H
 
 #include "processor.h"
+#include "random_generator.h"
 
 namespace mopo {
 
@@ -38,6 +39,7 @@ namespace mopo {
 
     private:
       mopo_float value_;
+      RandomGenerator random_;
   };
 } // namespace mopo
 
@@ -28,21 +28,49 @@ namespace mopo {
     enable(false);
   }
 
+  ValueSwitch::~ValueSwitch() {
+    if (isIsolated())
+      delete enabled_;
+  }
+
   void ValueSwitch::destroy() {
     output(kSwitch)->buffer = original_buffer_;
     cr::Value::destroy();
   }
 
+  void ValueSwitch::process() {
+    // Only copies in isolated voices run. They pick the same source as the
+    // original but point at the voice's own copy of it.
+    mopo_float value = shared_outputs_->at(kValue)->buffer[0];
+    output(kValue)->buffer[0] = value;
+    int source = utils::iclamp(static_cast<int>(value), 0, numInputs() - 1);
+    mopo_float* buffer = input(source)->source->buffer;
+    if (output(kSwitch)->buffer != buffer) {
+      output(kSwitch)->buffer = buffer;
+      output(kSwitch)->markChanged();
+    }
+  }
+
   void ValueSwitch::set(mopo_float value) {
     cr::Value::set(value);
     setSource(value);
   }
 
+  void ValueSwitch::isolateOutputs(output_remap& outputs) {
+    if (!isIsolated())
+      enabled_ = new bool(true);
+    cr::Value::isolateOutputs(outputs);
+  }
+
   inline void ValueSwitch::setSource(int source) {
     bool enable_processors = source != 0;
     source = utils::iclamp(source, 0, numInputs() - 1);
     output(kSwitch)->buffer = input(source)->source->buffer;
 
+    // Readers watch every source so flipping doesn't change the topology,
+    // but they need to know the value they read may have.
+    output(kSwitch)->markChanged();
+
     for (Processor* processor : processors_)
       processor->enable(enable_processors);
   }
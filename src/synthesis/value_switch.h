@@ -31,11 +31,14 @@ namespace mopo {
       };
 
       ValueSwitch(mopo_float value = 0.0);
+      virtual ~ValueSwitch();
       virtual void destroy() override;
 
       virtual Processor* clone() const override { return new ValueSwitch(*this); }
-      virtual void process() override { }
+      virtual void process() override;
       virtual void set(mopo_float value) override;
+      virtual void isolateOutputs(output_remap& outputs) override;
+      virtual bool aliasesInputs() const override { return true; }
 
       void addProcessor(Processor* processor) { processors_.push_back(processor); }
 
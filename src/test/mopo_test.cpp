@@ -0,0 +1,244 @@
+/* Copyright 2013-2017 Matt Tytel
+ *
+ * helm is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * helm is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with helm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "mopo.h"
+#include "graph_edit.h"
+#include "helm_engine.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#define SAMPLE_RATE 44100
+#define BUFFER_SIZE 256
+#define NOTE_PERIOD_BLOCKS 40
+#define NOTE_LENGTH_BLOCKS 30
+#define RENDER_BLOCKS 200
+#define VOICE_THREADS 2
+
+// Checks engine behavior that's hard to hear. Build with CONFIG=Debug so
+// MOPO_ASSERT runs too. Exits with the number of failed tests.
+
+namespace {
+
+  using namespace mopo;
+
+  struct Test {
+    std::string name;
+    std::function<void()> run;
+  };
+
+  int num_failures = 0;
+
+  void expect(bool passed, const std::string& message) {
+    if (passed)
+      return;
+
+    std::cout << "  FAILED: " << message << std::endl;
+    num_failures++;
+  }
+
+  void setUp(HelmEngine& engine) {
+    engine.setSampleRate(SAMPLE_RATE);
+    engine.setBufferSize(BUFFER_SIZE);
+    engine.updateAllModulationSwitches();
+    engine.getControls()["filter_on"]->set(1.0);
+  }
+
+  // Plays the same note pattern every time and returns every output sample.
+  std::vector<mopo_float> render(HelmEngine& engine) {
+    std::vector<mopo_float> samples;
+    for (int block = 0; block < RENDER_BLOCKS; ++block) {
+      int note = 48 + (block / NOTE_PERIOD_BLOCKS) % 12;
+      if (block % NOTE_PERIOD_BLOCKS == 0)
+        engine.noteOn(note, 0.8, block % 7);
+      else if (block % NOTE_PERIOD_BLOCKS == NOTE_LENGTH_BLOCKS)
+        engine.noteOff(note, 3);
+
+      engine.process();
+      const mopo_float* buffer = engine.output(0)->buffer;
+      samples.insert(samples.end(), buffer, buffer + BUFFER_SIZE);
+    }
+    return samples;
+  }
+
+  void connect(HelmEngine& engine, ModulationConnection* connection, bool add) {
+    GraphEdit edit;
+    if (add)
+      engine.connectModulation(connection, &edit);
+    else
+      engine.disconnectModulation(connection, &edit);
+    edit.prepare();
+    edit.commit();
+  }
+
+  // Voices rendered on several threads run private copies of the voice
+  // graph. Edits committed after the copies were made have to leave them
+  // the same as copies made after the edits.
+  void testIsolatedVoiceEdits() {
+    ModulationConnection staged_lfo("mono_lfo_1", "cutoff");
+    ModulationConnection staged_envelope("mod_envelope", "osc_1_tune");
+    ModulationConnection staged_poly_lfo("poly_lfo", "osc_feedback_amount");
+    ModulationConnection direct_lfo("mono_lfo_1", "cutoff");
+    ModulationConnection direct_envelope("mod_envelope", "osc_1_tune");
+    ModulationConnection direct_poly_lfo("poly_lfo", "osc_feedback_amount");
+    for (ModulationConnection* connection : { &staged_lfo, &direct_lfo })
+      connection->amount.set(0.5);
+    for (ModulationConnection* connection : { &staged_envelope, &staged_poly_lfo,
+                                              &direct_envelope, &direct_poly_lfo })
+      connection->amount.set(0.3);
+
+    HelmEngine staged;
+    setUp(staged);
+    staged.setNumVoiceThreads(VOICE_THREADS);
+    connect(staged, &staged_lfo, true);
+    connect(staged, &staged_envelope, true);
+    connect(staged, &staged_poly_lfo, true);
+
+    HelmEngine direct;
+    setUp(direct);
+    connect(direct, &direct_lfo, true);
+    connect(direct, &direct_envelope, true);
+    connect(direct, &direct_poly_lfo, true);
+    direct.setNumVoiceThreads(VOICE_THREADS);
+
+    expect(render(staged) == render(direct), "connecting changed isolated voices");
+
+    connect(staged, &staged_envelope, false);
+    connect(direct, &direct_envelope, false);
+    expect(render(staged) == render(direct), "disconnecting changed isolated voices");
+  }
+
+  // Patches change every control and modulation in one edit. Connecting and
+  // disconnecting several modulations together has to end up with the same
+  // graph as doing it one at a time.
+  void testBatchedModulationEdits() {
+    ModulationConnection batched_lfo("mono_lfo_1", "cutoff");
+    ModulationConnection batched_envelope("mod_envelope", "osc_1_tune");
+    ModulationConnection batched_poly_lfo("poly_lfo", "cutoff");
+    ModulationConnection single_lfo("mono_lfo_1", "cutoff");
+    ModulationConnection single_envelope("mod_envelope", "osc_1_tune");
+    ModulationConnection single_poly_lfo("poly_lfo", "cutoff");
+    for (ModulationConnection* connection : { &batched_lfo, &single_lfo })
+      connection->amount.set(0.5);
+    for (ModulationConnection* connection : { &batched_envelope, &batched_poly_lfo,
+                                              &single_envelope, &single_poly_lfo })
+      connection->amount.set(0.3);
+
+    HelmEngine batched;
+    setUp(batched);
+    batched.setNumVoiceThreads(VOICE_THREADS);
+    connect(batched, &batched_lfo, true);
+
+    HelmEngine single;
+    setUp(single);
+    single.setNumVoiceThreads(VOICE_THREADS);
+    connect(single, &single_lfo, true);
+
+    GraphEdit edit;
+    batched.disconnectModulation(&batched_lfo, &edit);
+    batched.connectModulation(&batched_envelope, &edit);
+    batched.connectModulation(&batched_poly_lfo, &edit);
+    edit.set(batched.getControls()["cutoff"], 60.0);
+    edit.prepare();
+    edit.commit();
+
+    connect(single, &single_lfo, false);
+    connect(single, &single_envelope, true);
+    connect(single, &single_poly_lfo, true);
+    single.getControls()["cutoff"]->set(60.0);
+
+    expect(render(batched) == render(single), "batched edit changed the graph");
+  }
+
+  // Isolated voices run their audio out of a BufferPool, including the
+  // outputs of routers nested in the voice. Most of them should share.
+  void testVoiceBufferSharing() {
+    HelmEngine engine;
+    setUp(engine);
+    engine.setNumVoiceThreads(VOICE_THREADS);
+
+    for (Voice* voice : engine.getAllVoices()) {
+      const BufferPool& pool = voice->getBufferPool();
+      expect(pool.getNumOutputs() > 0, "voice outputs weren't pooled");
+      expect(2 * pool.getNumBuffers() <= pool.getNumOutputs(),
+             "pooled voice outputs didn't share buffers");
+    }
+
+    bool finite = true;
+    for (mopo_float sample : render(engine))
+      finite = finite && std::isfinite(sample);
+    expect(finite, "pooled voices rendered bad samples");
+  }
+
+  // The guard after the ring has to match the start of it after every write,
+  // including when the ring is shorter than the guard.
+  void testMemoryGuard() {
+    for (int size : { 64, MEMORY_GUARD_SIZE }) {
+      Memory memory(size);
+      mopo_float samples[MAX_BUFFER_SIZE];
+      int mirrored = std::min(memory.getSize(), MEMORY_GUARD_SIZE);
+      bool matches = true;
+
+      for (int i = 0; i < 200; ++i) {
+        int num = 1 + (i * 37) % std::min(memory.getSize(), MAX_BUFFER_SIZE);
+        for (int s = 0; s < num; ++s)
+          samples[s] = i + s / 1000.0;
+
+        if (i % 5 == 0)
+          memory.pushZero(num);
+        else if (i % 7 == 0)
+          memory.push(samples[0]);
+        else
+          memory.pushBlock(samples, num);
+
+        const mopo_float* buffer = memory.getBuffer();
+        for (int s = 0; s < mirrored; ++s)
+          matches = matches && buffer[memory.getSize() + s] == buffer[s];
+      }
+
+      expect(matches, "guard of a " + std::to_string(size) + " sample ring went stale");
+    }
+  }
+
+  std::vector<Test> createTests() {
+    return {
+      { "isolated_voice_edits", testIsolatedVoiceEdits },
+      { "batched_modulation_edits", testBatchedModulationEdits },
+      { "voice_buffer_sharing", testVoiceBufferSharing },
+      { "memory_guard", testMemoryGuard },
+    };
+  }
+} // namespace
+
+int main(int argc, char** argv) {
+  std::vector<Test> tests = createTests();
+
+  for (const Test& test : tests) {
+    if (argc > 1 && test.name.find(argv[1]) == std::string::npos)
+      continue;
+
+    int failures = num_failures;
+    test.run();
+    std::cout << test.name << "\t" << (failures == num_failures ? "ok" : "FAILED") << std::endl;
+  }
+
+  return num_failures;
+}